@@ -10,12 +10,21 @@
 	local m = MappedFile::create_shared(filename)
 
 	local bs = binstream(m:getPointer(), #m)
-*/
-#include <SDKDDKVer.h>
 
-#define WIN32_LEAN_AND_MEAN
-#define NOMINMAX
-#include <windows.h>
+	There is a Windows implementation, using CreateFileMapping, and a
+	POSIX implementation, using mmap().  Both have the same basic interface
+	of create_shared(filename, hints), advise(hints), data(), size(), 
+	isValid(), and close().
+
+	The hints describe how the file is going to be accessed.  On POSIX
+	they are passed along to the kernel through mmap() flags and madvise().
+	On Windows, SEQUENTIAL and RANDOM become the matching CreateFile flags,
+	and the rest are ignored.  These are only hints, and are quietly 
+	ignored where not supported.
+
+	On Windows, create_shared_access() takes the CreateFile access, share
+	mode, and disposition directly, for when read only isn't what's wanted.
+*/
 
 #include <cstdio>
 #include <string>
@@ -23,6 +32,29 @@
 #include <memory>
 
 
+namespace waavs
+{
+    // Access pattern hints for a mapped file
+    enum MAPPED_FILE_HINT : uint32_t
+    {
+        MAPPED_FILE_HINT_NONE = 0x00,
+        MAPPED_FILE_HINT_SEQUENTIAL = 0x01,     // will be read front to back, read ahead aggressively
+        MAPPED_FILE_HINT_RANDOM = 0x02,         // will be read in random order, don't read ahead
+        MAPPED_FILE_HINT_WILLNEED = 0x04,       // start paging in the whole file now
+        MAPPED_FILE_HINT_POPULATE = 0x08,       // fault in all pages before returning from create_shared
+        MAPPED_FILE_HINT_HUGEPAGES = 0x10,      // back the mapping with huge pages where possible
+    };
+}
+
+#if defined(_WIN32)
+
+#include <SDKDDKVer.h>
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+
 namespace waavs
 {
     struct MappedFile
@@ -81,17 +113,50 @@ namespace waavs
 
 
 
+        // advise()
+        // The access pattern can only be given when the file is
+        // opened on Windows, so there's nothing to change here
+        bool advise(uint32_t hints)
+        {
+            return fData != nullptr;
+        }
+
+
+        // factory method
+        // The same form as the POSIX version.  SEQUENTIAL and RANDOM are 
+        // handed to CreateFile as FILE_FLAG_SEQUENTIAL_SCAN and 
+        // FILE_FLAG_RANDOM_ACCESS, the other hints are ignored.
+        static std::shared_ptr<MappedFile> create_shared(const std::string& filename,
+            uint32_t hints = MAPPED_FILE_HINT_SEQUENTIAL | MAPPED_FILE_HINT_WILLNEED)
+        {
+            uint32_t flagsAndAttributes = FILE_ATTRIBUTE_NORMAL;
+            if (hints & MAPPED_FILE_HINT_SEQUENTIAL)
+                flagsAndAttributes |= FILE_FLAG_SEQUENTIAL_SCAN;
+            else if (hints & MAPPED_FILE_HINT_RANDOM)
+                flagsAndAttributes |= FILE_FLAG_RANDOM_ACCESS;
+
+            return openMapping(filename, GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, flagsAndAttributes);
+        }
+
         // factory method
         // desiredAccess - GENERIC_READ, GENERIC_WRITE, GENERIC_EXECUTE
         // shareMode - FILE_SHARE_READ, FILE_SHARE_WRITE
         // creationDisposition - CREATE_ALWAYS, CREATE_NEW, OPEN_ALWAYS, OPEN_EXISTING, TRUNCATE_EXISTING
-        static std::shared_ptr<MappedFile> create_shared(const std::string& filename,
+        static std::shared_ptr<MappedFile> create_shared_access(const std::string& filename,
             uint32_t desiredAccess = GENERIC_READ,
             uint32_t shareMode = FILE_SHARE_READ,
             uint32_t disposition = OPEN_EXISTING)
         {
-            uint32_t flagsAndAttributes = (FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS);
+            return openMapping(filename, desiredAccess, shareMode, disposition, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS);
+        }
 
+    private:
+        static std::shared_ptr<MappedFile> openMapping(const std::string& filename,
+            uint32_t desiredAccess,
+            uint32_t shareMode,
+            uint32_t disposition,
+            uint32_t flagsAndAttributes)
+        {
             const char* fname = filename.c_str();
             HANDLE filehandle = ::CreateFileA(fname,
                 desiredAccess,
@@ -147,4 +212,147 @@ namespace waavs
             return std::make_shared<MappedFile>(filehandle, maphandle, data, size);
         }
     };
-}
\ No newline at end of file
+}
+
+#else
+
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace waavs
+{
+    struct MappedFile
+    {
+        void* fData{};
+        size_t fSize{};
+        bool fIsValid{};
+
+        int fFileHandle{ -1 };
+
+    public:
+        MappedFile(int filehandle, void* data, size_t length)
+            :fData(data)
+            , fSize(length)
+            , fFileHandle(filehandle)
+        {
+            fIsValid = true;
+        }
+
+
+        MappedFile()
+            : fData(nullptr)
+            , fSize(0)
+            , fIsValid(false)
+            , fFileHandle(-1)
+        {}
+
+        virtual ~MappedFile() { close(); }
+
+        bool isValid() const { return fIsValid; }
+        void* data() const { return fData; }
+        size_t size() const { return fSize; }
+
+        bool close()
+        {
+            if (fData != nullptr) {
+                ::munmap(fData, fSize);
+                fData = nullptr;
+            }
+
+            if (fFileHandle != -1) {
+                ::close(fFileHandle);
+                fFileHandle = -1;
+            }
+
+            fIsValid = false;
+
+            return true;
+        }
+
+        // advise()
+        // Change the access pattern hints after the file is mapped
+        // For example, switch from SEQUENTIAL to RANDOM once a document 
+        // has been parsed, and is being accessed during rendering
+        bool advise(uint32_t hints)
+        {
+            if (fData == nullptr)
+                return false;
+
+            return applyAdvice(fData, fSize, hints);
+        }
+
+
+        // factory method
+        // The default hints suit a file that is going to be parsed 
+        // from front to back, as soon as it's opened
+        static std::shared_ptr<MappedFile> create_shared(const std::string& filename,
+            uint32_t hints = MAPPED_FILE_HINT_SEQUENTIAL | MAPPED_FILE_HINT_WILLNEED)
+        {
+            const char* fname = filename.c_str();
+            int filehandle = ::open(fname, O_RDONLY);
+
+            if (filehandle == -1) {
+                // BUGBUG - do anything more than returning invalid?
+                printf("Could not create/open file for mmap: %d  %s", errno, fname);
+                return {};
+            }
+
+            struct stat st {};
+            if ((::fstat(filehandle, &st) != 0) || (st.st_size <= 0))
+            {
+                // Can't map a zero sized file
+                ::close(filehandle);
+                return {};
+            }
+
+            size_t size = (size_t)st.st_size;
+
+            int flags = MAP_PRIVATE;
+#if defined(MAP_POPULATE)
+            if (hints & MAPPED_FILE_HINT_POPULATE)
+                flags |= MAP_POPULATE;
+#endif
+
+            void* data = ::mmap(nullptr, size, PROT_READ, flags, filehandle, 0);
+
+            if (data == MAP_FAILED) {
+                ::close(filehandle);
+
+                return {};
+            }
+
+            applyAdvice(data, size, hints);
+
+            return std::make_shared<MappedFile>(filehandle, data, size);
+        }
+
+    private:
+        static bool applyAdvice(void* data, size_t size, uint32_t hints)
+        {
+            bool success = true;
+
+            if (hints & MAPPED_FILE_HINT_SEQUENTIAL)
+                success = (::madvise(data, size, MADV_SEQUENTIAL) == 0) && success;
+            
+            if (hints & MAPPED_FILE_HINT_RANDOM)
+                success = (::madvise(data, size, MADV_RANDOM) == 0) && success;
+            
+            if (hints & MAPPED_FILE_HINT_WILLNEED)
+                success = (::madvise(data, size, MADV_WILLNEED) == 0) && success;
+
+#if defined(MADV_HUGEPAGE)
+            // Only takes effect where the kernel supports transparent
+            // huge pages for file backed memory, otherwise harmless
+            if (hints & MAPPED_FILE_HINT_HUGEPAGES)
+                ::madvise(data, size, MADV_HUGEPAGE);
+#endif
+
+            return success;
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,837 @@
+#pragma once
+
+//
+// svgcompiled
+// A binary form of a document, that loads without parsing any XML.
+//
+// When the same documents are loaded every time a program starts, most
+// of the start up time goes to parsing the XML, the path data, the
+// styles, and then resolving all of that into things that can be
+// drawn.  The result is the same every time.
+//
+// What a document comes down to, once it is bound, is what its
+// SVGDisplayList holds: the transforms, resolved paints and gradients,
+// path vertices and commands, images, fonts, and text runs, along with
+// the commands that put them together.  SVGCompiledDocument writes that
+// out in a binary form, and reads it back into an SVGDisplayList, which
+// draws with replay(), just like one that was recorded.
+//
+// The file is laid out for being mapped into memory.  All the values
+// are little endian, and every array of numbers, matrices, vertices,
+// and pixels starts on an 8 byte boundary, so loading them is a copy
+// straight out of the mapped file, and not much else.  Fonts are kept
+// by family name, style, weight, stretch, and size, and looked up in
+// the FontHandler when loading.
+//
+// What's lost is the document itself.  There are no nodes to hit test,
+// change, or script.  This is for documents that are only drawn.
+//
+// Usage:
+//   std::vector<uint8_t> bytes;
+//   SVGCompiledDocument::compile(fh, doc.get(), bytes);
+//   SVGCompiledDocument::writeFile("tiger.svgc", bytes);
+//
+//   SVGDisplayList dl;
+//   SVGCompiledDocument::loadFile("tiger.svgc", fh, dl);
+//   dl.replay(ctx, viewTransform);
+//
+// The version is bumped whenever the layout, or the meaning of the
+// display list commands, changes.  Files of another version are
+// not loaded, they need to be compiled again.
+//
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "blend2d.h"
+#include "bithacks.h"
+#include "bstream.h"
+#include "mappedfile.h"
+#include "fonthandler.h"
+#include "svgdisplaylist.h"
+
+
+namespace waavs
+{
+    //=================================================
+    // SVGCompiledWriter
+    // Appends little endian values to a growing buffer
+    //=================================================
+    struct SVGCompiledWriter
+    {
+        std::vector<uint8_t>& fBytes;
+
+        SVGCompiledWriter(std::vector<uint8_t>& bytes) : fBytes(bytes) {}
+
+        void putBytes(const void* data, size_t sz)
+        {
+            const uint8_t* p = (const uint8_t*)data;
+            fBytes.insert(fBytes.end(), p, p + sz);
+        }
+
+        void putU8(uint8_t v) { fBytes.push_back(v); }
+        void putU32(uint32_t v) { putBytes(&v, 4); }
+        void putF64(double v) { putBytes(&v, 8); }
+
+        // Pad with zeros to the next multiple of 8
+        void align()
+        {
+            while (fBytes.size() % 8 != 0)
+                fBytes.push_back(0);
+        }
+    };
+
+
+    struct SVGCompiledDocument
+    {
+        static constexpr uint32_t kMagic = 0x43475653;      // "SVGC"
+        static constexpr uint32_t kVersion = 1;
+
+        // How paints are kept
+        enum StyleKind : uint8_t
+        {
+            STYLE_NONE = 0,
+            STYLE_RGBA32,
+            STYLE_RGBA64,
+            STYLE_GRADIENT,
+            STYLE_PATTERN,
+        };
+
+        static_assert(sizeof(DisplayListCommand) == 12, "DisplayListCommand is written as it is laid out in memory");
+
+
+        //=================================================
+        // Writing
+        //=================================================
+
+        // compile()
+        // Record the document, and write what was recorded
+        static bool compile(FontHandler* fh, SVGDocument* doc, std::vector<uint8_t>& out)
+        {
+            if (nullptr == doc)
+                return false;
+
+            SVGDisplayList dl{};
+            SVGDisplayListRecorder::record(fh, doc, dl);
+
+            return write(dl, out);
+        }
+
+        static bool write(const SVGDisplayList& dl, std::vector<uint8_t>& out)
+        {
+            if (!isLE())
+            {
+                printf("SVGCompiledDocument::write - only little endian is supported\n");
+                return false;
+            }
+
+            out.clear();
+            SVGCompiledWriter w(out);
+
+            w.putU32(kMagic);
+            w.putU32(kVersion);
+            w.putF64(dl.fFrame.x);
+            w.putF64(dl.fFrame.y);
+            w.putF64(dl.fFrame.w);
+            w.putF64(dl.fFrame.h);
+
+            // commands
+            w.putU32((uint32_t)dl.fCommands.size());
+            w.align();
+            for (const auto& cmd : dl.fCommands)
+            {
+                // field by field, so the padding is written as zeros
+                uint8_t rec[12]{};
+                rec[0] = cmd.fOp;
+                rec[1] = cmd.fImm;
+                memcpy(rec + 4, &cmd.fA, 4);
+                memcpy(rec + 8, &cmd.fB, 4);
+                w.putBytes(rec, 12);
+            }
+
+            // numbers
+            w.putU32((uint32_t)dl.fNumbers.size());
+            w.align();
+            w.putBytes(dl.fNumbers.data(), dl.fNumbers.size() * sizeof(double));
+
+            // matrices
+            w.putU32((uint32_t)dl.fMatrices.size());
+            w.align();
+            for (const auto& m : dl.fMatrices)
+                w.putBytes(m.m, 6 * sizeof(double));
+
+            // paths
+            w.putU32((uint32_t)dl.fPaths.size());
+            for (const auto& p : dl.fPaths)
+                writePath(w, p);
+
+            // styles
+            w.putU32((uint32_t)dl.fStyles.size());
+            for (const auto& s : dl.fStyles)
+            {
+                if (!writeStyle(w, s))
+                    return false;
+            }
+
+            // images
+            w.putU32((uint32_t)dl.fImages.size());
+            for (const auto& img : dl.fImages)
+            {
+                if (!writeImage(w, img))
+                    return false;
+            }
+
+            // fonts
+            w.putU32((uint32_t)dl.fFonts.size());
+            for (const auto& f : dl.fFonts)
+            {
+                const BLString& family = f.face().familyName();
+                w.putU32((uint32_t)family.size());
+                w.putBytes(family.data(), family.size());
+                w.putU32(f.style());
+                w.putU32(f.weight());
+                w.putU32(f.stretch());
+                w.putF64(f.size());
+            }
+
+            // texts
+            w.putU32((uint32_t)dl.fTexts.size());
+            for (const auto& t : dl.fTexts)
+            {
+                w.putU32((uint32_t)t.size());
+                w.putBytes(t.data(), t.size());
+            }
+
+            return true;
+        }
+
+        static bool writeFile(const char* filename, const std::vector<uint8_t>& bytes)
+        {
+            FILE* fp = fopen(filename, "wb");
+            if (nullptr == fp)
+            {
+                printf("SVGCompiledDocument::writeFile - could not open: %s\n", filename);
+                return false;
+            }
+
+            size_t written = fwrite(bytes.data(), 1, bytes.size(), fp);
+            fclose(fp);
+
+            return written == bytes.size();
+        }
+
+
+        //=================================================
+        // Loading
+        //=================================================
+
+        // load()
+        // Fill in 'dl' from the bytes of a compiled document.  Returns
+        // false if the bytes are not a compiled document of this
+        // version, are cut short, or don't hold together.  Nothing
+        // is sized from a count until the bytes for that many are
+        // known to be there, and every command's indices are checked
+        // against what was loaded, so replay() can trust them.
+        static bool load(const ByteSpan& bytes, FontHandler* fh, SVGDisplayList& dl)
+        {
+            dl.clear();
+
+            if (!isLE())
+            {
+                printf("SVGCompiledDocument::load - only little endian is supported\n");
+                return false;
+            }
+
+            BStream bs(bytes);
+
+            uint32_t magic = 0;
+            uint32_t version = 0;
+            if (!bs.read_u32_le(magic) || !bs.read_u32_le(version) || magic != kMagic)
+            {
+                printf("SVGCompiledDocument::load - not a compiled document\n");
+                return false;
+            }
+
+            if (version != kVersion)
+            {
+                printf("SVGCompiledDocument::load - version %u, expected %u\n", version, kVersion);
+                return false;
+            }
+
+            if (!bs.read_f64_le(dl.fFrame.x) || !bs.read_f64_le(dl.fFrame.y) ||
+                !bs.read_f64_le(dl.fFrame.w) || !bs.read_f64_le(dl.fFrame.h))
+                return false;
+
+            uint32_t count = 0;
+
+            // commands
+            if (!bs.read_u32_le(count) || !align(bs) || !fits(bs, count, sizeof(DisplayListCommand)))
+                return false;
+            dl.fCommands.resize(count);
+            if (!readArray(bs, dl.fCommands.data(), (size_t)count * sizeof(DisplayListCommand)))
+                return false;
+
+            // numbers
+            if (!bs.read_u32_le(count) || !align(bs) || !fits(bs, count, sizeof(double)))
+                return false;
+            dl.fNumbers.resize(count);
+            if (!readArray(bs, dl.fNumbers.data(), (size_t)count * sizeof(double)))
+                return false;
+
+            // matrices
+            if (!bs.read_u32_le(count) || !align(bs) || !fits(bs, count, 6 * sizeof(double)))
+                return false;
+            dl.fMatrices.resize(count);
+            for (auto& m : dl.fMatrices)
+            {
+                if (!readArray(bs, m.m, 6 * sizeof(double)))
+                    return false;
+            }
+
+            // paths, at least their size
+            if (!bs.read_u32_le(count) || !fits(bs, count, 4))
+                return false;
+            dl.fPaths.resize(count);
+            for (auto& p : dl.fPaths)
+            {
+                if (!readPath(bs, p))
+                    return false;
+            }
+
+            // styles, at least their kind
+            if (!bs.read_u32_le(count) || !fits(bs, count, 1))
+                return false;
+            dl.fStyles.resize(count);
+            for (auto& s : dl.fStyles)
+            {
+                if (!readStyle(bs, s))
+                    return false;
+            }
+
+            // images, at least their size and format
+            if (!bs.read_u32_le(count) || !fits(bs, count, 12))
+                return false;
+            dl.fImages.resize(count);
+            for (auto& img : dl.fImages)
+            {
+                if (!readImage(bs, img))
+                    return false;
+            }
+
+            // fonts, at least an empty name, style, weight, stretch, and size
+            if (!bs.read_u32_le(count) || !fits(bs, count, 24))
+                return false;
+            dl.fFonts.resize(count);
+            for (auto& f : dl.fFonts)
+            {
+                uint32_t len = 0;
+                uint32_t style = 0;
+                uint32_t weight = 0;
+                uint32_t stretch = 0;
+                double sz = 0;
+
+                if (!bs.read_u32_le(len) || bs.remaining() < len)
+                    return false;
+                ByteSpan family = bs.read(len);
+
+                if (!bs.read_u32_le(style) || !bs.read_u32_le(weight) || !bs.read_u32_le(stretch) || !bs.read_f64_le(sz))
+                    return false;
+
+                // A font that can't be found leaves its text undrawn
+                BLFontFace face{};
+                if (nullptr != fh && fh->selectFontFamily(family, face, style, weight, stretch))
+                    f.createFromFace(face, (float)sz);
+            }
+
+            // texts, at least their length
+            if (!bs.read_u32_le(count) || !fits(bs, count, 4))
+                return false;
+            dl.fTexts.resize(count);
+            for (auto& t : dl.fTexts)
+            {
+                uint32_t len = 0;
+                if (!bs.read_u32_le(len) || bs.remaining() < len)
+                    return false;
+
+                ByteSpan txt = bs.read(len);
+                t.assign((const char*)txt.data(), txt.size());
+            }
+
+            if (!validCommands(dl))
+            {
+                printf("SVGCompiledDocument::load - commands refer to things that aren't there\n");
+                dl.clear();
+                return false;
+            }
+
+            return true;
+        }
+
+        // loadFile()
+        // Map the file, and load from it
+        static bool loadFile(const char* filename, FontHandler* fh, SVGDisplayList& dl)
+        {
+            auto mapped = MappedFile::create_shared(filename);
+            if (nullptr == mapped)
+                return false;
+
+            ByteSpan bytes(mapped->data(), mapped->size());
+
+            return load(bytes, fh, dl);
+        }
+
+    private:
+        //=================================================
+        // The parts
+        //=================================================
+
+        // Paths are the count, the commands, then the vertices
+        static void writePath(SVGCompiledWriter& w, const BLPath& p)
+        {
+            size_t n = p.size();
+
+            w.putU32((uint32_t)n);
+            w.putBytes(p.commandData(), n);
+            w.align();
+            w.putBytes(p.vertexData(), n * sizeof(BLPoint));
+        }
+
+        static bool readPath(BStream& bs, BLPath& p)
+        {
+            uint32_t n = 0;
+            if (!bs.read_u32_le(n) || bs.remaining() < n)
+                return false;
+
+            ByteSpan cmds = bs.read(n);
+            if (!validPathCommands(cmds.data(), n))
+            {
+                printf("SVGCompiledDocument::load - bad path commands\n");
+                return false;
+            }
+
+            if (!align(bs) || bs.remaining() < (size_t)n * sizeof(BLPoint))
+                return false;
+
+            if (n == 0)
+                return true;
+
+            uint8_t* cmdOut = nullptr;
+            BLPoint* vtxOut = nullptr;
+            if (p.modifyOp(BL_MODIFY_OP_ASSIGN_FIT, n, &cmdOut, &vtxOut) != BL_SUCCESS)
+                return false;
+
+            memcpy(cmdOut, cmds.data(), n);
+
+            return readArray(bs, vtxOut, (size_t)n * sizeof(BLPoint));
+        }
+
+        // The kind is taken from type(), rather than isRgba32() and friends,
+        // which only test that the type's bits are set, so an odd
+        // numbered type, like a gradient, passes for an RGBA32.
+        static bool writeStyle(SVGCompiledWriter& w, const BLVar& s)
+        {
+            BLObjectType type = s.type();
+
+            if (type == BL_OBJECT_TYPE_RGBA32)
+            {
+                BLRgba32 c{};
+                s.toRgba32(&c);
+                w.putU8(STYLE_RGBA32);
+                w.putU32(c.value);
+            }
+            else if (type == BL_OBJECT_TYPE_GRADIENT)
+            {
+                const BLGradient& g = s.as<BLGradient>();
+
+                w.putU8(STYLE_GRADIENT);
+                w.putU8((uint8_t)g.type());
+                w.putU8((uint8_t)g.extendMode());
+
+                // all the values, whatever the type of gradient
+                w.putF64(g.x0());
+                w.putF64(g.y0());
+                w.putF64(g.x1());
+                w.putF64(g.y1());
+                w.putF64(g.r0());
+                w.putF64(g.r1());
+                w.putBytes(g.transform().m, 6 * sizeof(double));
+
+                w.putU32((uint32_t)g.size());
+                for (size_t i = 0; i < g.size(); i++)
+                {
+                    w.putF64(g.stops()[i].offset);
+                    uint64_t rgba = g.stops()[i].rgba.value;
+                    w.putBytes(&rgba, 8);
+                }
+            }
+            else if (type == BL_OBJECT_TYPE_PATTERN)
+            {
+                const BLPattern& pat = s.as<BLPattern>();
+                BLRectI area = pat.area();
+                BLMatrix2D m = pat.transform();
+
+                w.putU8(STYLE_PATTERN);
+                w.putU8((uint8_t)pat.extendMode());
+                w.putU32((uint32_t)area.x);
+                w.putU32((uint32_t)area.y);
+                w.putU32((uint32_t)area.w);
+                w.putU32((uint32_t)area.h);
+                w.putBytes(m.m, 6 * sizeof(double));
+
+                return writeImage(w, pat.getImage());
+            }
+            else if (type == BL_OBJECT_TYPE_RGBA || type == BL_OBJECT_TYPE_RGBA64)
+            {
+                // any other color
+                BLRgba64 c{};
+                s.toRgba64(&c);
+                w.putU8(STYLE_RGBA64);
+                w.putBytes(&c.value, 8);
+            }
+            else
+            {
+                w.putU8(STYLE_NONE);
+            }
+
+            return true;
+        }
+
+        static bool readStyle(BStream& bs, BLVar& s)
+        {
+            uint8_t kind = 0;
+            if (!bs.read_u8(kind))
+                return false;
+
+            switch (kind)
+            {
+            case STYLE_NONE:
+                s = BLVar::null();
+                return true;
+
+            case STYLE_RGBA32: {
+                uint32_t value = 0;
+                if (!bs.read_u32_le(value))
+                    return false;
+                s.assign(BLRgba32(value));
+            }
+                return true;
+
+            case STYLE_RGBA64: {
+                uint64_t value = 0;
+                if (!bs.read_u64_le(value))
+                    return false;
+                s.assign(BLRgba64(value));
+            }
+                return true;
+
+            case STYLE_GRADIENT: {
+                uint8_t type = 0;
+                uint8_t extend = 0;
+                double values[6]{};
+                BLMatrix2D m{};
+                uint32_t n = 0;
+
+                if (!bs.read_u8(type) || !bs.read_u8(extend))
+                    return false;
+                if (type > BL_GRADIENT_TYPE_MAX_VALUE || extend > BL_EXTEND_MODE_SIMPLE_MAX_VALUE)
+                    return false;
+                if (!readArray(bs, values, sizeof(values)) || !readArray(bs, m.m, 6 * sizeof(double)))
+                    return false;
+                if (!bs.read_u32_le(n) || bs.remaining() < (size_t)n * 16)
+                    return false;
+
+                std::vector<BLGradientStop> stops(n);
+                for (auto& stop : stops)
+                {
+                    uint64_t rgba = 0;
+                    bs.read_f64_le(stop.offset);
+                    bs.read_u64_le(rgba);
+                    stop.rgba = BLRgba64(rgba);
+                }
+
+                BLGradient g{};
+                if (blGradientCreate(&g, (BLGradientType)type, values, (BLExtendMode)extend, stops.data(), stops.size(), &m) != BL_SUCCESS)
+                    return false;
+                s.assign(g);
+            }
+                return true;
+
+            case STYLE_PATTERN: {
+                uint8_t extend = 0;
+                uint32_t area[4]{};
+                BLMatrix2D m{};
+                BLImage img{};
+
+                if (!bs.read_u8(extend) || extend > BL_EXTEND_MODE_MAX_VALUE)
+                    return false;
+                for (auto& a : area)
+                {
+                    if (!bs.read_u32_le(a))
+                        return false;
+                }
+                if (!readArray(bs, m.m, 6 * sizeof(double)) || !readImage(bs, img))
+                    return false;
+
+                BLPattern pat(img, BLRectI((int)area[0], (int)area[1], (int)area[2], (int)area[3]), (BLExtendMode)extend, m);
+                s.assign(pat);
+            }
+                return true;
+
+            default:
+                printf("SVGCompiledDocument::load - unknown style: %d\n", kind);
+                return false;
+            }
+        }
+
+        // Images are the size and format, then the rows of
+        // pixels, without any padding between them
+        static size_t bytesPerPixel(uint32_t format)
+        {
+            return (format == BL_FORMAT_A8) ? 1 : 4;
+        }
+
+        static bool writeImage(SVGCompiledWriter& w, const BLImage& img)
+        {
+            BLImageData data{};
+            if (img.empty() || img.getData(&data) != BL_SUCCESS)
+            {
+                w.putU32(0);
+                w.putU32(0);
+                w.putU32(0);
+                return true;
+            }
+
+            w.putU32((uint32_t)data.size.w);
+            w.putU32((uint32_t)data.size.h);
+            w.putU32(data.format);
+            w.align();
+
+            size_t rowBytes = (size_t)data.size.w * bytesPerPixel(data.format);
+            const uint8_t* row = (const uint8_t*)data.pixelData;
+            for (int y = 0; y < data.size.h; y++, row += data.stride)
+                w.putBytes(row, rowBytes);
+            w.align();
+
+            return true;
+        }
+
+        static bool readImage(BStream& bs, BLImage& img)
+        {
+            uint32_t width = 0;
+            uint32_t height = 0;
+            uint32_t format = 0;
+
+            if (!bs.read_u32_le(width) || !bs.read_u32_le(height) || !bs.read_u32_le(format))
+                return false;
+
+            if (width == 0 || height == 0)
+                return true;
+
+            if (width > BL_RUNTIME_MAX_IMAGE_SIZE || height > BL_RUNTIME_MAX_IMAGE_SIZE ||
+                format == BL_FORMAT_NONE || format > BL_FORMAT_MAX_VALUE)
+            {
+                printf("SVGCompiledDocument::load - bad image: %u x %u, format %u\n", width, height, format);
+                return false;
+            }
+
+            size_t rowBytes = (size_t)width * bytesPerPixel(format);
+            size_t paddedBytes = (rowBytes * height + 7) & ~(size_t)7;
+            if (!align(bs) || bs.remaining() < paddedBytes)
+                return false;
+
+            BLImageData data{};
+            if (img.create((int)width, (int)height, (BLFormat)format) != BL_SUCCESS || img.makeMutable(&data) != BL_SUCCESS)
+                return false;
+
+            uint8_t* row = (uint8_t*)data.pixelData;
+            for (uint32_t y = 0; y < height; y++, row += data.stride)
+                bs.read_copy(row, rowBytes);
+
+            return align(bs);
+        }
+
+        // Whether there are enough bytes left for 'count' records of
+        // at least 'recordSize' bytes each
+        static bool fits(BStream& bs, uint32_t count, size_t recordSize)
+        {
+            return (uint64_t)count * recordSize <= (uint64_t)bs.remaining();
+        }
+
+        // A path starts with a move, and each curve has all of its
+        // points, so blend2d never reads past the end of one.
+        static bool validPathCommands(const uint8_t* cmd, size_t n)
+        {
+            if (n > 0 && cmd[0] != BL_PATH_CMD_MOVE)
+                return false;
+
+            size_t i = 0;
+            while (i < n)
+            {
+                switch (cmd[i])
+                {
+                case BL_PATH_CMD_MOVE:
+                case BL_PATH_CMD_ON:
+                case BL_PATH_CMD_CLOSE:
+                    i += 1;
+                    break;
+
+                case BL_PATH_CMD_QUAD:
+                    if (i + 1 >= n || cmd[i + 1] != BL_PATH_CMD_ON)
+                        return false;
+                    i += 2;
+                    break;
+
+                case BL_PATH_CMD_CONIC:
+                    if (i + 2 >= n || cmd[i + 1] != BL_PATH_CMD_WEIGHT || cmd[i + 2] != BL_PATH_CMD_ON)
+                        return false;
+                    i += 3;
+                    break;
+
+                case BL_PATH_CMD_CUBIC:
+                    if (i + 2 >= n || cmd[i + 1] != BL_PATH_CMD_CUBIC || cmd[i + 2] != BL_PATH_CMD_ON)
+                        return false;
+                    i += 3;
+                    break;
+
+                default:
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        // Whether 'count' things starting at 'idx' are within 'size'
+        static bool inRange(uint32_t idx, size_t count, size_t size)
+        {
+            return (uint64_t)idx + count <= (uint64_t)size;
+        }
+
+        // validCommands()
+        // Every index a command has, into the numbers, matrices, paths,
+        // styles, images, fonts, and texts, has to be within what was 
+        // loaded, and pushes and pops have to match up.
+        static bool validCommands(const SVGDisplayList& dl)
+        {
+            size_t numbers = dl.fNumbers.size();
+            int depth = 0;
+
+            for (const auto& cmd : dl.fCommands)
+            {
+                bool valid = true;
+
+                switch (cmd.fOp)
+                {
+                case DL_PUSH: depth++; break;
+                case DL_POP: valid = (--depth >= 0); break;
+
+                case DL_SET_TRANSFORM:
+                case DL_APPLY_TRANSFORM:
+                    valid = inRange(cmd.fA, 1, dl.fMatrices.size());
+                    break;
+
+                case DL_TRANSLATE:
+                case DL_SCALE:
+                    valid = inRange(cmd.fA, 2, numbers);
+                    break;
+
+                case DL_ROTATE:
+                case DL_FILL_ALPHA:
+                case DL_STROKE_ALPHA:
+                case DL_GLOBAL_ALPHA:
+                case DL_STROKE_WIDTH:
+                case DL_STROKE_MITER_LIMIT:
+                    valid = inRange(cmd.fA, 1, numbers);
+                    break;
+
+                case DL_FILL_STYLE:
+                case DL_STROKE_STYLE:
+                case DL_FILL_ALL:
+                    valid = inRange(cmd.fA, 1, dl.fStyles.size());
+                    break;
+
+                case DL_STROKE_CAP:
+                    valid = (cmd.fB <= BL_STROKE_CAP_POSITION_MAX_VALUE);
+                    break;
+
+                case DL_NO_FILL:
+                case DL_NO_STROKE:
+                case DL_STROKE_JOIN:
+                case DL_STROKE_CAPS:
+                case DL_STROKE_TRANSFORM_ORDER:
+                case DL_FILL_RULE:
+                case DL_COMP_OP:
+                case DL_RESTORE_CLIPPING:
+                case DL_CLEAR_ALL:
+                    break;
+
+                case DL_CLIP_RECT:
+                case DL_FILL_RECT:
+                case DL_STROKE_RECT:
+                    valid = inRange(cmd.fA, 4, numbers);
+                    break;
+
+                case DL_FILL_PATH:
+                case DL_STROKE_PATH:
+                    valid = inRange(cmd.fA, 1, dl.fPaths.size());
+                    break;
+
+                case DL_FILL_GEOMETRY:
+                case DL_STROKE_GEOMETRY: {
+                    size_t count = SVGDisplayList::geometryDoubles((BLGeometryType)cmd.fImm);
+                    valid = (count > 0) && inRange(cmd.fA, count, numbers);
+                }
+                    break;
+
+                case DL_BLIT_IMAGE:
+                    valid = inRange(cmd.fA, 1, dl.fImages.size()) && inRange(cmd.fB, 8, numbers);
+                    break;
+
+                case DL_FILL_MASK:
+                    valid = inRange(cmd.fA, 1, dl.fImages.size()) && inRange(cmd.fB, 2, numbers);
+                    break;
+
+                case DL_FONT:
+                    valid = inRange(cmd.fA, 1, dl.fFonts.size());
+                    break;
+
+                case DL_FILL_TEXT:
+                case DL_STROKE_TEXT:
+                    valid = inRange(cmd.fA, 1, dl.fTexts.size()) && inRange(cmd.fB, 2, numbers);
+                    break;
+
+                default:
+                    valid = false;
+                    break;
+                }
+
+                if (!valid)
+                    return false;
+            }
+
+            return depth == 0;
+        }
+
+        // Move up to the next multiple of 8, from the start of the bytes
+        static bool align(BStream& bs)
+        {
+            size_t pad = (8 - bs.tell() % 8) % 8;
+            if (bs.remaining() < pad)
+                return false;
+
+            bs.skip(pad);
+            return true;
+        }
+
+        static bool readArray(BStream& bs, void* out, size_t sz)
+        {
+            if (bs.remaining() < sz)
+                return false;
+
+            bs.read_copy(out, sz);
+            return true;
+        }
+    };
+}
@@ -0,0 +1,297 @@
+#pragma once
+
+//
+// arena
+// A monotonic memory arena, and the pieces needed to allocate
+// shared objects out of it.
+//
+// Loading a document creates a very large number of small objects,
+// the nodes, and their visual properties.  Each one was a separate
+// trip to the heap, and each one was a separate trip back to the heap
+// when the document went away.
+//
+// The MonotonicArena carves allocations out of large blocks, by simply
+// bumping a pointer.  Individual allocations are never freed, the blocks
+// are all released together when the arena is destroyed.
+//
+// Objects are still handed out as std::shared_ptr, so nothing else
+// about how they're used needs to change.  Every object allocated from
+// the arena holds a reference to the arena, through its allocator, so
+// the arena can not go away while any object that lives in it is still
+// around, even if that object outlives the document that created it.
+//
+// There is a notion of a 'current' arena, per thread.  When there is
+// one, arena_make_shared() allocates from it, otherwise it's the same
+// as std::make_shared().  The ArenaScope sets the current arena for
+// the duration of a scope, such as while a document is being loaded.
+//
+// The containers inside those objects, their children and properties,
+// can come from the arena as well, with an ArenaMemberAllocator.  It
+// holds a plain pointer to the arena, rather than a reference, because
+// the object it is part of is already holding one.
+//
+// The arena only saves the trips to the heap.  Destroying a document
+// still runs the destructor of every object in it, because they hold
+// paths and images, and each shared object still carries its reference
+// to the arena, in its control block.
+//
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+namespace waavs
+{
+    //============================================================
+    // MonotonicArena
+    //============================================================
+    struct MonotonicArena
+    {
+        static constexpr size_t kDefaultBlockSize = 64 * 1024;
+
+        struct Block {
+            Block* fNext;
+            size_t fSize;
+        };
+
+        Block* fBlocks{ nullptr };
+        uint8_t* fCursor{ nullptr };
+        uint8_t* fLimit{ nullptr };
+        size_t fBlockSize{ kDefaultBlockSize };
+
+        // Some statistics
+        size_t fAllocationCount{ 0 };       // number of calls to allocate()
+        size_t fBytesAllocated{ 0 };        // bytes handed out
+        size_t fBytesReserved{ 0 };         // bytes taken from the heap
+        size_t fBlockCount{ 0 };            // number of blocks taken from the heap
+
+        MonotonicArena(size_t blockSize = kDefaultBlockSize)
+            : fBlockSize(blockSize)
+        {}
+
+        MonotonicArena(const MonotonicArena&) = delete;
+        MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+        ~MonotonicArena()
+        {
+            release();
+        }
+
+        // allocate()
+        // Return memory of at least 'sz' bytes, with the given alignment
+        // 'align' must be a power of 2
+        void* allocate(size_t sz, size_t align = alignof(std::max_align_t))
+        {
+            uintptr_t p = ((uintptr_t)fCursor + (align - 1)) & ~(uintptr_t)(align - 1);
+
+            if ((fCursor == nullptr) || (p + sz > (uintptr_t)fLimit))
+            {
+                // Anything large gets a block of its own
+                size_t needed = sz + align;
+                addBlock(needed > fBlockSize ? needed : fBlockSize);
+
+                p = ((uintptr_t)fCursor + (align - 1)) & ~(uintptr_t)(align - 1);
+            }
+
+            fCursor = (uint8_t*)(p + sz);
+
+            fAllocationCount++;
+            fBytesAllocated += sz;
+
+            return (void*)p;
+        }
+
+        // release()
+        // Give all the blocks back to the heap at once.
+        // Only safe when nothing lives in the arena any more.
+        void release()
+        {
+            while (fBlocks != nullptr)
+            {
+                Block* next = fBlocks->fNext;
+                ::free(fBlocks);
+                fBlocks = next;
+            }
+
+            fCursor = nullptr;
+            fLimit = nullptr;
+        }
+
+    private:
+        void addBlock(size_t sz)
+        {
+            Block* blk = (Block*)::malloc(sizeof(Block) + sz);
+            if (blk == nullptr)
+                throw std::bad_alloc();
+
+            blk->fNext = fBlocks;
+            blk->fSize = sz;
+            fBlocks = blk;
+
+            fCursor = (uint8_t*)(blk + 1);
+            fLimit = fCursor + sz;
+
+            fBlockCount++;
+            fBytesReserved += sz;
+        }
+    };
+
+
+    //============================================================
+    // ArenaAllocator
+    // A standard allocator that gets its memory from a MonotonicArena
+    // deallocate() does nothing, the memory is reclaimed when the
+    // arena itself goes away.
+    //============================================================
+    template <typename T>
+    struct ArenaAllocator
+    {
+        using value_type = T;
+
+        std::shared_ptr<MonotonicArena> fArena{};
+
+        ArenaAllocator(std::shared_ptr<MonotonicArena> arena) noexcept
+            : fArena(std::move(arena))
+        {}
+
+        template <typename U>
+        ArenaAllocator(const ArenaAllocator<U>& other) noexcept
+            : fArena(other.fArena)
+        {}
+
+        T* allocate(size_t n)
+        {
+            return (T*)fArena->allocate(n * sizeof(T), alignof(T));
+        }
+
+        void deallocate(T*, size_t) noexcept
+        {
+            ;
+        }
+
+        template <typename U>
+        bool operator==(const ArenaAllocator<U>& other) const noexcept { return fArena == other.fArena; }
+        template <typename U>
+        bool operator!=(const ArenaAllocator<U>& other) const noexcept { return fArena != other.fArena; }
+    };
+
+
+    // The arena currently in use on this thread, if any
+    // This is an inline function, so there is only one of
+    // these, no matter how many places include this header
+    inline std::shared_ptr<MonotonicArena>& currentArena()
+    {
+        static thread_local std::shared_ptr<MonotonicArena> arena{};
+        return arena;
+    }
+
+    //============================================================
+    // ArenaMemberAllocator
+    // For containers that are members of objects living in an arena.
+    // When the container is constructed, it takes the current arena,
+    // if there is one, otherwise it uses the heap.
+    //
+    // The arena is held by a plain pointer, which is only safe as long
+    // as the container stays inside its object.  A copy of the container
+    // gets an allocator of its own, from whatever arena is current at
+    // the time, but a container moved out of its object keeps pointing
+    // into the arena.  Don't do that.
+    //
+    // Like the rest of the arena, it is not thread safe.  The containers
+    // can grow after loading, when a document is edited, but not from
+    // more than one thread at a time.
+    //============================================================
+    template <typename T>
+    struct ArenaMemberAllocator
+    {
+        using value_type = T;
+        using propagate_on_container_copy_assignment = std::false_type;
+        using propagate_on_container_move_assignment = std::false_type;
+        using propagate_on_container_swap = std::false_type;
+
+        MonotonicArena* fArena{ nullptr };
+
+        ArenaMemberAllocator() noexcept
+            : fArena(currentArena().get())
+        {}
+
+        template <typename U>
+        ArenaMemberAllocator(const ArenaMemberAllocator<U>& other) noexcept
+            : fArena(other.fArena)
+        {}
+
+        T* allocate(size_t n)
+        {
+            if (nullptr != fArena)
+                return (T*)fArena->allocate(n * sizeof(T), alignof(T));
+
+            return std::allocator<T>().allocate(n);
+        }
+
+        void deallocate(T* p, size_t n) noexcept
+        {
+            if (nullptr == fArena)
+                std::allocator<T>().deallocate(p, n);
+        }
+
+        ArenaMemberAllocator select_on_container_copy_construction() const noexcept
+        {
+            return ArenaMemberAllocator();
+        }
+
+        template <typename U>
+        bool operator==(const ArenaMemberAllocator<U>& other) const noexcept { return fArena == other.fArena; }
+        template <typename U>
+        bool operator!=(const ArenaMemberAllocator<U>& other) const noexcept { return fArena != other.fArena; }
+    };
+
+    template <typename T>
+    using ArenaVector = std::vector<T, ArenaMemberAllocator<T>>;
+
+
+    //============================================================
+    // ArenaScope
+    // Make an arena the current arena for the lifetime of the scope
+    // restoring whatever was current before when it ends.
+    //============================================================
+    struct ArenaScope
+    {
+        std::shared_ptr<MonotonicArena> fPrevious{};
+
+        ArenaScope(std::shared_ptr<MonotonicArena> arena)
+            : fPrevious(currentArena())
+        {
+            currentArena() = std::move(arena);
+        }
+
+        ~ArenaScope()
+        {
+            currentArena() = std::move(fPrevious);
+        }
+
+        ArenaScope(const ArenaScope&) = delete;
+        ArenaScope& operator=(const ArenaScope&) = delete;
+    };
+
+    //
+    // arena_make_shared()
+    //
+    // Use this in place of std::make_shared() for objects that
+    // should live in the current arena, if there is one.
+    //
+    template <typename T, typename... Args>
+    static inline std::shared_ptr<T> arena_make_shared(Args&&... args)
+    {
+        const std::shared_ptr<MonotonicArena>& arena = currentArena();
+        if (arena != nullptr)
+            return std::allocate_shared<T>(ArenaAllocator<T>(arena), std::forward<Args>(args)...);
+
+        return std::make_shared<T>(std::forward<Args>(args)...);
+    }
+}
@@ -7,7 +7,9 @@
 
 #include "bithacks.h"
 #include "charset.h"
+#include "fastfloat.h"
 #include "maths.h"
+#include "memscan.h"
 
 namespace waavs {
 
@@ -592,22 +594,20 @@ namespace waavs
 	// or or the whole chunk of the character is not found
 	static inline ByteSpan chunk_find_char(const ByteSpan& a, char c) noexcept
 	{
-		const uint8_t* start = a.fStart;
 		const uint8_t* end = a.fEnd;
-		while (start < end && *start != c)
-			++start;
+		const uint8_t* start = memscan_byte(a.fStart, end, (uint8_t)c);
 
 		return { start, end };
 	}
 
+	// Given an input chunk
+	// find the first instance of a specified string
+	// return the chunk starting at the found string
+	// or an empty chunk at the end if it's not found
 	static inline ByteSpan chunk_find_cstr(const ByteSpan& a, const char* c) noexcept
 	{
-		const uint8_t* start = a.fStart;
 		const uint8_t* end = a.fEnd;
-		const uint8_t* cstart = (const uint8_t*)c;
-		const uint8_t* cend = cstart + strlen(c);
-		while (start < end && !chunk_starts_with({ start, end }, { cstart, cend }))
-			++start;
+		const uint8_t* start = memscan_str(a.fStart, end, (const uint8_t*)c, strlen(c));
 
 		return { start, end };
 	}
@@ -688,98 +688,208 @@ namespace waavs
 
 
 	//
-	// chunk_to_double()
+	// chunk_parse_double()
 	// 
-	// parse floating point number
-	// includes sign, exponent, and decimal point
-	// The input chunk is altered, with the fStart pointer moved to the end of the number
-	// Note:  If we want to include "charconv", the we can use the std::from_chars
-	// This should be a fast implementation, far batter than something like atof, or sscanf
-	// But, the routine here should be universally fast, when charconv is not available on the 
-	// target platform.
+	// Parse a floating point number, with optional sign, decimal point, 
+	// and exponent.  On success, the chunk is advanced past the number.
+	// On failure, it is left alone.
 	//
-			// Just put this from_chars implementation here in case
-		// we ever want to use it instead
-		//double outNumber = 0;
-		//auto res = std::from_chars((const char*)s.fStart, (const char*)s.fEnd, outNumber);
-		//if (res.ec == std::errc::invalid_argument)
-		//{
-		//	printf("chunk_to_double: INVALID ARGUMENT: ");
-		//	printChunk(s);
-		//}
-		//return outNumber;
-	
-	static inline double chunk_to_double(const ByteSpan& inChunk) noexcept
+	// The digits are gathered into an integer, and the power of ten 
+	// that goes with it, which decimalToDouble() (fastfloat.h) turns 
+	// into the closest double.  In the rare case where it can't be
+	// sure, std::from_chars() has the final say.  Either way, the 
+	// result is correctly rounded.
+	//
+	// An 'e' is only taken as the start of an exponent when digits
+	// follow, so "2em" is 2, followed by the units "em".
+	//
+	static inline bool chunk_parse_double(ByteSpan& s, double& value) noexcept
 	{
-		ByteSpan s = inChunk;
+		// As many digits as always fit in 64 bits
+		static constexpr int kMaxDigits = 19;
 
-		double sign = 1.0;
-		double res = 0.0;
-		long long intPart = 0;
-		uint64_t fracPart = 0;
-		bool hasIntPart = false;
-		bool hasFracPart = false;
+		auto isDigit = [](unsigned char c) { return (unsigned char)(c - '0') < 10; };
 
-		// Parse optional sign
-		if (*s == '+') {
-			s++;
-		}
-		else if (*s == '-') {
-			sign = -1;
-			s++;
+		const unsigned char* p = s.fStart;
+		const unsigned char* end = s.fEnd;
+
+		bool negative = false;
+		if (p < end && (*p == '+' || *p == '-'))
+		{
+			negative = (*p == '-');
+			p++;
 		}
 
-		// Parse integer part
-		if (chrDecDigits[*s]) {
+		uint64_t w = 0;
+		int64_t exp10 = 0;
+		int digits = 0;
+		bool truncated = false;
+		bool hasDigits = false;
 
-			intPart = chunk_to_u64(s);
+		// Eight digits at a time, while they fit in w
+		auto takeEightDigits = [&]() -> bool {
+			if (end - p < 8 || digits + 8 > kMaxDigits)
+				return false;
 
-			res = (double)intPart;
-			hasIntPart = true;
-		}
+			uint64_t chunk = fastfloat_read8(p);
+			if (!fastfloat_is_eight_digits(chunk))
+				return false;
+
+			bool wasZero = (w == 0);
+			w = w * 100000000 + fastfloat_parse_eight_digits(chunk);
+
+			// Leading zeros are not significant
+			if (!wasZero)
+				digits += 8;
+			else
+				for (uint64_t v = w; v != 0; v /= 10)
+					digits++;
+
+			hasDigits = true;
+			p += 8;
+
+			return true;
+		};
 
-		// Parse fractional part.
-		if (*s == '.') {
-			s++; // Skip '.'
-			auto sentinel = s.fStart;
+		// Integer part
+		while (takeEightDigits())
+			;
 
-			if (chrDecDigits(*s)) {
-				fracPart = chunk_to_u64(s);
-				auto ending = s.fStart;
+		while (p < end && isDigit(*p))
+		{
+			uint32_t d = *p - '0';
+			hasDigits = true;
 
-				ptrdiff_t diff = ending - sentinel;
-				res = res + ((double)fracPart) / (double)powd((double)10, double(diff));
-				hasFracPart = true;
+			if (digits < kMaxDigits) {
+				w = w * 10 + d;
+				if (w != 0)
+					digits++;
+			}
+			else {
+				exp10++;
+				truncated |= (d != 0);
 			}
+			p++;
 		}
 
-		// A valid number should have integer or fractional part.
-		if (!hasIntPart && !hasFracPart)
-			return 0.0;
+		// Fractional part
+		if (p < end && *p == '.')
+		{
+			p++;
+
+			while (takeEightDigits())
+				exp10 -= 8;
+
+			while (p < end && isDigit(*p))
+			{
+				uint32_t d = *p - '0';
+				hasDigits = true;
+
+				if (digits < kMaxDigits) {
+					w = w * 10 + d;
+					if (w != 0)
+						digits++;
+					exp10--;
+				}
+				else {
+					truncated |= (d != 0);
+				}
+				p++;
+			}
+		}
 
+		// A valid number has an integer or fractional part.
+		if (!hasDigits)
+			return false;
 
-		// Parse optional exponent
-		if (*s == 'e' || *s == 'E') {
-			long long expPart = 0;
-			s++; // skip 'E'
+		// Optional exponent
+		if (p < end && (*p == 'e' || *p == 'E'))
+		{
+			const unsigned char* e = p + 1;
+			bool expNegative = false;
 
-			double expSign = 1.0;
-			if (*s == '+') {
-				s++;
-			}
-			else if (*s == '-') {
-				expSign = -1.0;
-				s++;
+			if (e < end && (*e == '+' || *e == '-'))
+			{
+				expNegative = (*e == '-');
+				e++;
 			}
 
-			if (chrDecDigits[*s]) {
-				expPart = chunk_to_u64(s);
-				res = res * powd(10, double(expSign * double(expPart)));
+			if (e < end && isDigit(*e))
+			{
+				int64_t expPart = 0;
+				while (e < end && isDigit(*e))
+				{
+					// Anything this big is already out of range
+					if (expPart < 100000)
+						expPart = expPart * 10 + (*e - '0');
+					e++;
+				}
+
+				exp10 += expNegative ? -expPart : expPart;
+				p = e;
 			}
 		}
 
-		return res * sign;
-		
+		if (!decimalToDouble(w, exp10, negative, truncated, value))
+		{
+			if (!decimalFallback((const char*)s.fStart, (const char*)p, value))
+				return false;
+		}
+
+		s.fStart = p;
+
+		return true;
+	}
+
+	//
+	// chunk_to_double()
+	// 
+	// The number at the start of the chunk, or 0.0 if there isn't one.
+	// The input chunk is not altered.
+	//
+	static inline double chunk_to_double(const ByteSpan& inChunk) noexcept
+	{
+		ByteSpan s = inChunk;
+		double value = 0.0;
+
+		if (!chunk_parse_double(s, value))
+			return 0.0;
+
+		return value;
+	}
+
+	// parseNumberList()
+	//
+	// Parse up to 'maxCount' numbers, separated by whitespace and
+	// commas, into 'out', in a single pass.  Returns how many were 
+	// found, and leaves the chunk just past the last of them.
+	// This is what points, path data, and transform arguments are
+	// made of, and is quicker than one parseNextNumber() at a time.
+	//
+	static inline size_t parseNumberList(ByteSpan& s, double* out, size_t maxCount) noexcept
+	{
+		auto isSeparator = [](unsigned char c) { return c == ' ' || c == ',' || c == '\t' || c == '\n' || c == '\r' || c == '\f'; };
+
+		const unsigned char* p = s.fStart;
+		size_t n = 0;
+
+		while (n < maxCount)
+		{
+			const unsigned char* q = p;
+			while (q < s.fEnd && isSeparator(*q))
+				q++;
+
+			ByteSpan num(q, s.fEnd);
+			if (!chunk_parse_double(num, out[n]))
+				break;
+
+			p = num.fStart;
+			n++;
+		}
+
+		s.fStart = p;
+
+		return n;
 	}
 }
 
@@ -0,0 +1,273 @@
+#pragma once
+
+//
+// bvh
+// A bounding volume hierarchy over a set of axis aligned boxes.
+//
+// A container with many children wants to answer the question
+// "which of my children touch this area?" without looking at
+// every one of them.  The BoundsHierarchy is built once, from the
+// bounds of the children, and can then be queried as often as
+// necessary.  Items are identified by the index they were given
+// when the hierarchy was built.
+//
+// The tree is built top down, splitting the items at the median
+// of their centers, along the longest axis, until there are only
+// a few items left in a node.  The nodes are stored in a single
+// vector, in depth first order, so the left child of a node is
+// always the node right after it.
+//
+// The hierarchy is static.  If the bounds of the items change, it
+// needs to be built again.
+//
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "blend2d.h"
+#include "memscan.h"
+
+
+namespace waavs
+{
+    struct BoundsHierarchy
+    {
+        static constexpr uint32_t kMaxLeafItems = 4;
+
+        struct Node {
+            BLBox fBounds{};
+            uint32_t fFirst{ 0 };       // leaf: index of first item in fItems, interior: index of right child
+            uint32_t fCount{ 0 };       // leaf: number of items, interior: 0
+        };
+
+        std::vector<Node> fNodes{};
+        std::vector<uint32_t> fItems{};
+        std::vector<BLBox> fItemBounds{};       // indexed by item id
+
+        void clear()
+        {
+            fNodes.clear();
+            fItems.clear();
+            fItemBounds.clear();
+        }
+
+        bool empty() const { return fNodes.empty(); }
+
+        // The bounds of everything in the hierarchy
+        BLBox bounds() const
+        {
+            if (fNodes.empty())
+                return BLBox{};
+
+            return fNodes[0].fBounds;
+        }
+
+        // build()
+        // Construct the hierarchy from a set of boxes, and the
+        // ids they will be reported with.
+        void build(const std::vector<BLBox>& boxes, const std::vector<uint32_t>& ids)
+        {
+            clear();
+
+            if (boxes.empty())
+                return;
+
+            uint32_t maxId = 0;
+            for (auto id : ids)
+                maxId = std::max(maxId, id);
+
+            fItemBounds.resize((size_t)maxId + 1);
+            for (size_t i = 0; i < ids.size(); i++)
+                fItemBounds[ids[i]] = boxes[i];
+
+            fItems = ids;
+            fNodes.reserve(2 * (ids.size() / kMaxLeafItems + 1));
+
+            buildNode(0, (uint32_t)fItems.size());
+        }
+
+        // query()
+        // Call 'visit(id)' for every item whose box overlaps 'area'
+        // Items are visited in no particular order
+        template <typename F>
+        void query(const BLBox& area, F&& visit) const
+        {
+            if (fNodes.empty())
+                return;
+
+            // Median splits keep the tree balanced, so the depth
+            // is log2 of the number of items, and this is plenty
+            uint32_t stack[64];
+            int sp = 0;
+            stack[sp++] = 0;
+
+            while (sp > 0)
+            {
+                uint32_t nodeIdx = stack[--sp];
+                const Node& node = fNodes[nodeIdx];
+
+                if (!overlaps(node.fBounds, area))
+                    continue;
+
+                if (node.fCount > 0)
+                {
+                    for (uint32_t i = node.fFirst; i < node.fFirst + node.fCount; i++)
+                    {
+                        uint32_t id = fItems[i];
+                        if (overlaps(fItemBounds[id], area))
+                            visit(id);
+                    }
+                }
+                else {
+                    stack[sp++] = node.fFirst;      // right
+                    stack[sp++] = nodeIdx + 1;      // left
+                }
+            }
+        }
+
+        // queryInOrder()
+        // Like query(), but the items are visited in order of their
+        // ids, which is the order drawing wants.  'marks' has a bit for
+        // every id; the hits are set there, and then the bits are visited
+        // in order.  Bits the caller has already set are visited along
+        // with the hits.  'marks' is left cleared, ready for the next query.
+        template <typename F>
+        void queryInOrder(const BLBox& area, std::vector<uint32_t>& marks, F&& visit) const
+        {
+            query(area, [&marks](uint32_t id) { marks[id >> 5] |= (1u << (id & 31)); });
+
+            for (size_t w = 0; w < marks.size(); w++)
+            {
+                uint32_t bits = marks[w];
+                marks[w] = 0;
+
+                while (bits != 0)
+                {
+                    uint32_t id = (uint32_t)(w * 32) + memscan_ctz32(bits);
+                    bits &= bits - 1;
+                    visit(id);
+                }
+            }
+        }
+
+        // Call 'visit(id)' for every item whose box contains the point
+        template <typename F>
+        void queryPoint(double x, double y, F&& visit) const
+        {
+            query(BLBox(x, y, x, y), visit);
+        }
+
+        static bool overlaps(const BLBox& a, const BLBox& b) noexcept
+        {
+            return (a.x0 <= b.x1) && (b.x0 <= a.x1) && (a.y0 <= b.y1) && (b.y0 <= a.y1);
+        }
+
+        // QueryMarks
+        // Scratch bits for queryInOrder(), covering 'count' ids.
+        //
+        // Queries nest, a container draws its children from inside its
+        // own query, and more than one thread can be drawing the same
+        // document.  So each thread keeps a stack of bitmaps, one per
+        // level of nesting, and they are reused from one query to the
+        // next, rather than allocated every time.
+        struct QueryMarks
+        {
+            std::vector<uint32_t>& fBits;
+
+            QueryMarks(size_t count)
+                : fBits(acquire())
+            {
+                fBits.assign((count + 31) / 32, 0);
+            }
+
+            ~QueryMarks() { depth()--; }
+
+            void set(uint32_t id) { fBits[id >> 5] |= (1u << (id & 31)); }
+
+        private:
+            // A deque, so the bitmaps don't move when more are added
+            static std::deque<std::vector<uint32_t>>& stack()
+            {
+                static thread_local std::deque<std::vector<uint32_t>> marks{};
+                return marks;
+            }
+
+            static size_t& depth()
+            {
+                static thread_local size_t level = 0;
+                return level;
+            }
+
+            static std::vector<uint32_t>& acquire()
+            {
+                auto& marks = stack();
+                size_t& level = depth();
+                if (level == marks.size())
+                    marks.emplace_back();
+
+                return marks[level++];
+            }
+        };
+
+    private:
+        static void merge(BLBox& a, const BLBox& b) noexcept
+        {
+            a.x0 = std::min(a.x0, b.x0);
+            a.y0 = std::min(a.y0, b.y0);
+            a.x1 = std::max(a.x1, b.x1);
+            a.y1 = std::max(a.y1, b.y1);
+        }
+
+        // Build the node for fItems[first, first+count), and return its index
+        uint32_t buildNode(uint32_t first, uint32_t count)
+        {
+            uint32_t nodeIdx = (uint32_t)fNodes.size();
+            fNodes.push_back(Node{});
+
+            BLBox bounds = fItemBounds[fItems[first]];
+            BLBox centers(bounds.x0 + bounds.x1, bounds.y0 + bounds.y1, bounds.x0 + bounds.x1, bounds.y0 + bounds.y1);
+            for (uint32_t i = first + 1; i < first + count; i++)
+            {
+                const BLBox& b = fItemBounds[fItems[i]];
+                merge(bounds, b);
+
+                double cx = b.x0 + b.x1;
+                double cy = b.y0 + b.y1;
+                merge(centers, BLBox(cx, cy, cx, cy));
+            }
+
+            fNodes[nodeIdx].fBounds = bounds;
+
+            if (count <= kMaxLeafItems)
+            {
+                fNodes[nodeIdx].fFirst = first;
+                fNodes[nodeIdx].fCount = count;
+                return nodeIdx;
+            }
+
+            // Split along the axis where the centers are most spread out
+            bool splitX = (centers.x1 - centers.x0) >= (centers.y1 - centers.y0);
+            uint32_t half = count / 2;
+
+            const std::vector<BLBox>& itemBounds = fItemBounds;
+            std::nth_element(fItems.begin() + first, fItems.begin() + first + half, fItems.begin() + first + count,
+                [&itemBounds, splitX](uint32_t a, uint32_t b) {
+                    const BLBox& ba = itemBounds[a];
+                    const BLBox& bb = itemBounds[b];
+                    if (splitX)
+                        return (ba.x0 + ba.x1) < (bb.x0 + bb.x1);
+                    return (ba.y0 + ba.y1) < (bb.y0 + bb.y1);
+                });
+
+            buildNode(first, half);
+            uint32_t right = buildNode(first + half, count - half);
+
+            fNodes[nodeIdx].fFirst = right;
+            fNodes[nodeIdx].fCount = 0;
+
+            return nodeIdx;
+        }
+    };
+}
@@ -2,10 +2,13 @@
 
 #pragma comment(lib, "blend2d.lib") // Link with Blend2D static library, on Windows
 
+#include <algorithm>
 #include <functional>
+#include <vector>
 
 #include "blend2d.h"
 #include "fonthandler.h"
+#include "svgsurfacepool.h"
 
 
 
@@ -83,6 +86,30 @@ namespace waavs
         // local width/height
 		double fLocalWidth{ 0 };
         double fLocalHeight{ 0 };
+
+        // Part of the surface that culling is limited to
+        BLBox fCullingLimit{};
+        bool fHasCullingLimit{ false };
+
+        // Geometry smaller than this, in device pixels, is drawn
+        // as a simple box, rather than as its full shape
+        double fSmallGeometryThreshold{ 0.5 };
+
+        // Whether groups with opacity may be drawn through 
+        // cached offscreen layers
+        bool fUseLayers{ true };
+
+        // Whether shapes may be drawn from a simplified version
+        // of their path, chosen by how large they'll appear
+        bool fUseLevelsOfDetail{ true };
+
+        // Whether simple shapes, like rect and circle, are drawn
+        // with blend2d's own calls for them, rather than as paths
+        bool fUseNativeGeometry{ true };
+
+        // Pooled surfaces that have been drawn from, and go back to
+        // the pool once the context is flushed, and done reading them
+        std::vector<BLImage> fSurfacesToRecycle{};
         
         
     public:
@@ -106,9 +133,18 @@ namespace waavs
             textAlign(ALIGNMENT::LEFT, ALIGNMENT::BASELINE);
             textFamily("Arial");
             textSize(16);
+
+            // There's no image bound yet, so none of the above reached
+            // blend2d.  Don't let the tracking believe it did.
+            resetStateTracking();
         }
         
-        virtual ~IRenderSVG() {}
+        virtual ~IRenderSVG() 
+        {
+            // Nothing may still be reading the surfaces when they go
+            if (!fSurfacesToRecycle.empty())
+                end();
+        }
 
         FontHandler* fontHandler() const { return fFontHandler; }
         void fontHandler(FontHandler* fh) { fFontHandler = fh; }
@@ -122,27 +158,500 @@ namespace waavs
         void localSize(double w, double h) { fLocalWidth = w; fLocalHeight = h; }
         BLPoint localSize() const { return BLPoint(fLocalWidth, fLocalHeight); }
         
+        //=================================================
+        // State tracking
+        // 
+        // Every node does a push() and pop() around itself, and applies
+        // all of its attributes, whether they change anything or not.
+        // We keep a shadow copy of the drawing state, and skip setting
+        // anything to the value it already has.  A push() does not save 
+        // the BLContext state until something is about to change, so a
+        // node that changes nothing costs nothing to push and pop.
+        //
+        // Anything that changes the state has to come through here, 
+        // rather than straight to BLContext, or a pop() might not 
+        // undo it.
+        //=================================================
+        enum : uint32_t {
+            STATE_FILL_STYLE = 0x0001,
+            STATE_STROKE_STYLE = 0x0002,
+            STATE_FILL_ALPHA = 0x0004,
+            STATE_STROKE_ALPHA = 0x0008,
+            STATE_GLOBAL_ALPHA = 0x0010,
+            STATE_STROKE_WIDTH = 0x0020,
+            STATE_MITER_LIMIT = 0x0040,
+            STATE_STROKE_JOIN = 0x0080,
+            STATE_START_CAP = 0x0100,
+            STATE_END_CAP = 0x0200,
+            STATE_TRANSFORM_ORDER = 0x0400,
+            STATE_FILL_RULE = 0x0800,
+            STATE_COMP_OP = 0x1000,
+        };
+
+        struct TrackedState {
+            uint32_t fKnown{ 0 };       // which of the values below are known
+
+            BLVar fFillStyle{};
+            BLVar fStrokeStyle{};
+            double fFillAlpha{ 1.0 };
+            double fStrokeAlpha{ 1.0 };
+            double fGlobalAlpha{ 1.0 };
+            double fStrokeWidth{ 1.0 };
+            double fMiterLimit{ 4.0 };
+            uint32_t fStrokeJoin{ 0 };
+            uint32_t fStartCap{ 0 };
+            uint32_t fEndCap{ 0 };
+            uint32_t fTransformOrder{ 0 };
+            uint32_t fFillRule{ 0 };
+            uint32_t fCompOp{ 0 };
+
+            TrackedState() = default;
+            TrackedState(const TrackedState& other) = default;
+
+            // BLVar only assigns through assign()
+            TrackedState& operator=(const TrackedState& other)
+            {
+                fKnown = other.fKnown;
+                fFillStyle.assign(other.fFillStyle);
+                fStrokeStyle.assign(other.fStrokeStyle);
+                fFillAlpha = other.fFillAlpha;
+                fStrokeAlpha = other.fStrokeAlpha;
+                fGlobalAlpha = other.fGlobalAlpha;
+                fStrokeWidth = other.fStrokeWidth;
+                fMiterLimit = other.fMiterLimit;
+                fStrokeJoin = other.fStrokeJoin;
+                fStartCap = other.fStartCap;
+                fEndCap = other.fEndCap;
+                fTransformOrder = other.fTransformOrder;
+                fFillRule = other.fFillRule;
+                fCompOp = other.fCompOp;
+
+                return *this;
+            }
+        };
+
+        struct SaveLevel {
+            bool fSaved{ false };       // whether BLContext::save() was called
+            TrackedState fState{};      // the state when it was
+        };
+
+        struct StateStats {
+            size_t fPushes{ 0 };
+            size_t fSaves{ 0 };                 // pushes that needed a real save
+            size_t fStateChanges{ 0 };          // changes passed on to the context
+            size_t fStateChangesSkipped{ 0 };   // changes to the value already there
+        };
+
+        TrackedState fState{};
+        std::vector<SaveLevel> fSaveStack{};
+        StateStats fStateStats{};
+        bool fTrackState{ true };
+
+
+        bool trackState() const { return fTrackState; }
+        void trackState(bool track) { fTrackState = track; }
+
+        const StateStats& stateStats() const { return fStateStats; }
+        void resetStateStats() { fStateStats = StateStats{}; }
+
+        // Forget what we know about the state, when 
+        // the context starts over
+        void resetStateTracking()
+        {
+            fState = TrackedState{};
+            fSaveStack.clear();
+        }
+
+        // Every form of begin() and end(), so none of them can
+        // get past the tracking to BLContext's own
+        BLResult begin(BLImageCore& image) { resetStateTracking(); return BLContext::begin(image); }
+        BLResult begin(BLImageCore& image, const BLContextCreateInfo& createInfo) { resetStateTracking(); return BLContext::begin(image, createInfo); }
+        BLResult begin(BLImageCore& image, const BLContextCreateInfo* createInfo) { resetStateTracking(); return BLContext::begin(image, createInfo); }
+        BLResult end() 
+        { 
+            resetStateTracking(); 
+            BLResult result = BLContext::end();
+            recycleSurfaces();
+
+            return result;
+        }
+
+        // recycleAfterFlush()
+        // Hand a surface from the SurfacePool back, once this context
+        // is done with it.  A context with worker threads may not have
+        // drawn from it yet, so it's held until the next end() or flush().
+        void recycleAfterFlush(BLImage& img)
+        {
+            if (img.empty())
+                return;
+
+            fSurfacesToRecycle.push_back(std::move(img));
+            img.reset();
+        }
+
+        void recycleSurfaces()
+        {
+            auto& pool = SurfacePool::global();
+            for (auto& img : fSurfacesToRecycle)
+                pool.recycle(img);
+
+            fSurfacesToRecycle.clear();
+        }
+
+        // stateIs()
+        // Whether the tracked values in 'which' are known to already be 
+        // what's wanted. 'same' is the comparison with what we know.
+        bool stateIs(uint32_t which, bool same)
+        {
+            if (fTrackState && ((fState.fKnown & which) == which) && same)
+            {
+                fStateStats.fStateChangesSkipped++;
+                return true;
+            }
+
+            return false;
+        }
+
+        // willChangeState()
+        // Something is about to change, so if there's a push() that 
+        // hasn't saved the state yet, now is the time.
+        void willChangeState()
+        {
+            fStateStats.fStateChanges++;
+
+            if (!fSaveStack.empty() && !fSaveStack.back().fSaved)
+            {
+                BLContext::save();
+                fSaveStack.back().fSaved = true;
+                fSaveStack.back().fState = fState;
+                fStateStats.fSaves++;
+            }
+        }
+
         virtual void strokeBeforeTransform(bool b) 
         {
-            setStrokeTransformOrder(b ? BL_STROKE_TRANSFORM_ORDER_BEFORE : BL_STROKE_TRANSFORM_ORDER_AFTER);
+            uint32_t order = b ? BL_STROKE_TRANSFORM_ORDER_BEFORE : BL_STROKE_TRANSFORM_ORDER_AFTER;
+            if (stateIs(STATE_TRANSFORM_ORDER, fState.fTransformOrder == order))
+                return;
+
+            willChangeState();
+            setStrokeTransformOrder((BLStrokeTransformOrder)order);
+            fState.fTransformOrder = order;
+            fState.fKnown |= STATE_TRANSFORM_ORDER;
         }
         
-        virtual void blendMode(int mode) { BLContext::setCompOp((BLCompOp)mode); }
-        virtual void globalOpacity(double opacity) { BLContext::setGlobalAlpha(opacity); }
-
-        virtual void strokeCap(int cap, int position) { BLContext::setStrokeCap((BLStrokeCapPosition)position, (BLStrokeCap)cap); }
-        virtual void strokeCaps(int caps) { BLContext::setStrokeCaps((BLStrokeCap)caps); }
-        virtual void strokeJoin(int join) { BLContext::setStrokeJoin((BLStrokeJoin)join); }
-        virtual void strokeMiterLimit(double limit) { BLContext::setStrokeMiterLimit(limit); }
-        virtual void strokeWidth(double w) { BLContext::setStrokeWidth(w); }
+        virtual void blendMode(int mode) 
+        { 
+            if (stateIs(STATE_COMP_OP, fState.fCompOp == (uint32_t)mode))
+                return;
+
+            willChangeState();
+            BLContext::setCompOp((BLCompOp)mode);
+            fState.fCompOp = (uint32_t)mode;
+            fState.fKnown |= STATE_COMP_OP;
+        }
+
+        virtual void globalOpacity(double opacity) { setGlobalAlpha(opacity); }
+
+        virtual void strokeCap(int cap, int position) 
+        { 
+            uint32_t which = (position == BL_STROKE_CAP_POSITION_START) ? STATE_START_CAP : STATE_END_CAP;
+            uint32_t& current = (position == BL_STROKE_CAP_POSITION_START) ? fState.fStartCap : fState.fEndCap;
+            if (stateIs(which, current == (uint32_t)cap))
+                return;
+
+            willChangeState();
+            BLContext::setStrokeCap((BLStrokeCapPosition)position, (BLStrokeCap)cap);
+            current = (uint32_t)cap;
+            fState.fKnown |= which;
+        }
+
+        virtual void strokeCaps(int caps) 
+        { 
+            if (stateIs(STATE_START_CAP | STATE_END_CAP, fState.fStartCap == (uint32_t)caps && fState.fEndCap == (uint32_t)caps))
+                return;
+
+            willChangeState();
+            BLContext::setStrokeCaps((BLStrokeCap)caps);
+            fState.fStartCap = (uint32_t)caps;
+            fState.fEndCap = (uint32_t)caps;
+            fState.fKnown |= STATE_START_CAP | STATE_END_CAP;
+        }
+
+        virtual void strokeJoin(int join) { setStrokeJoin((BLStrokeJoin)join); }
+
+        virtual void strokeMiterLimit(double limit) 
+        { 
+            if (stateIs(STATE_MITER_LIMIT, fState.fMiterLimit == limit))
+                return;
+
+            willChangeState();
+            BLContext::setStrokeMiterLimit(limit);
+            fState.fMiterLimit = limit;
+            fState.fKnown |= STATE_MITER_LIMIT;
+        }
+
+        virtual void strokeWidth(double w) 
+        { 
+            if (stateIs(STATE_STROKE_WIDTH, fState.fStrokeWidth == w))
+                return;
+
+            willChangeState();
+            BLContext::setStrokeWidth(w);
+            fState.fStrokeWidth = w;
+            fState.fKnown |= STATE_STROKE_WIDTH;
+        }
 		double strokeWidth() { return blContextGetStrokeWidth(this); }
-        
+
+        // cullingArea()
+        //
+        // The area of the drawing surface, in device pixels, that can be
+        // seen.  Containers skip children that fall outside of it.
+        // Return false when everything should be drawn.
+        virtual bool cullingArea(BLBox& area)
+        {
+            BLSize target = targetSize();
+            if (target.w <= 0 || target.h <= 0)
+                return false;
+
+            area = BLBox(0, 0, target.w, target.h);
+
+            if (fHasCullingLimit)
+            {
+                area.x0 = std::max(area.x0, fCullingLimit.x0);
+                area.y0 = std::max(area.y0, fCullingLimit.y0);
+                area.x1 = std::min(area.x1, fCullingLimit.x1);
+                area.y1 = std::min(area.y1, fCullingLimit.y1);
+            }
+
+            return true;
+        }
+
+        // smallGeometryThreshold()
+        // Shapes whose bounds, on the drawing surface, are smaller than 
+        // this many pixels across are drawn as their bounding box, which
+        // covers about the same pixels, for a lot less work.  Set it to
+        // 0 to always draw the full shapes, when quality matters most.
+        double smallGeometryThreshold() const { return fSmallGeometryThreshold; }
+        void smallGeometryThreshold(double pixels) { fSmallGeometryThreshold = pixels > 0 ? pixels : 0; }
+
+        // useLayers()
+        // A group with opacity is drawn into an offscreen layer, which 
+        // is kept from one frame to the next.  Turn this off when what
+        // is drawn is kept in some other form, like a recording.
+        bool useLayers() const { return fUseLayers; }
+        void useLayers(bool use) { fUseLayers = use; }
+
+        // useLevelsOfDetail()
+        // Paths with simplified versions are drawn using the one that
+        // suits the current scale.  Turn this off when what's drawn
+        // will be seen at some other scale, like a recording.
+        bool useLevelsOfDetail() const { return fUseLevelsOfDetail; }
+        void useLevelsOfDetail(bool use) { fUseLevelsOfDetail = use; }
+
+        // useNativeGeometry()
+        // Rects, circles, ellipses, lines, and polygons are drawn with 
+        // blend2d's calls for those shapes.  Turn this off to draw them
+        // as paths instead, to compare the two.
+        bool useNativeGeometry() const { return fUseNativeGeometry; }
+        void useNativeGeometry(bool use) { fUseNativeGeometry = use; }
+
+        // inheritStyle()
+        // Take on the paint, stroke, and text settings of another context,
+        // so that drawing into a layer looks like drawing into 'from'.
+        // The transform, clip, and global alpha are left alone.
+        void inheritStyle(const IRenderSVG& from)
+        {
+            BLVar style{};
+
+            if (from.getFillStyle(style) == BL_SUCCESS && !style.isNull())
+                fill(style);
+            else
+                noFill();
+
+            style.reset();
+            if (from.getStrokeStyle(style) == BL_SUCCESS && !style.isNull())
+                stroke(style);
+            else
+                noStroke();
+
+            fillOpacity(from.fillAlpha());
+            strokeOpacity(from.strokeAlpha());
+            setFillRule(from.BLContext::fillRule());
+
+            const BLStrokeOptions& options = from.strokeOptions();
+            strokeWidth(options.width);
+            strokeMiterLimit(options.miterLimit);
+            setStrokeJoin((BLStrokeJoin)options.join);
+            strokeCap(options.startCap, BL_STROKE_CAP_POSITION_START);
+            strokeCap(options.endCap, BL_STROKE_CAP_POSITION_END);
+            strokeBeforeTransform(options.transformOrder == BL_STROKE_TRANSFORM_ORDER_BEFORE);
+
+            willChangeState();
+            BLContext::setStrokeDashArray(options.dashArray);
+            BLContext::setStrokeDashOffset(options.dashOffset);
+
+            fFontFace = from.fFontFace;
+            fFont = from.fFont;
+            fFontSize = from.fFontSize;
+            fTextHAlignment = from.fTextHAlignment;
+            fTextVAlignment = from.fTextVAlignment;
+            fLocalWidth = from.fLocalWidth;
+            fLocalHeight = from.fLocalHeight;
+            fSmallGeometryThreshold = from.fSmallGeometryThreshold;
+            fUseLayers = from.fUseLayers;
+            fUseLevelsOfDetail = from.fUseLevelsOfDetail;
+            fUseNativeGeometry = from.fUseNativeGeometry;
+        }
+
+        // inheritedStyleKey()
+        // A hash of what inheritStyle() takes on, other than the fill 
+        // and stroke styles themselves, which can be compared directly.
+        // Something drawn with the inherited style, like a cached layer,
+        // is only good for as long as this stays the same.
+        uint64_t inheritedStyleKey() const
+        {
+            const BLStrokeOptions& options = strokeOptions();
+
+            double values[] = {
+                fillAlpha(), strokeAlpha(), (double)BLContext::fillRule(),
+                options.width, options.miterLimit, (double)options.join,
+                (double)options.startCap, (double)options.endCap, (double)options.transformOrder,
+                options.dashOffset, (double)options.dashArray.size(),
+                fFontSize, (double)fTextHAlignment, (double)fTextVAlignment,
+                fLocalWidth, fLocalHeight, fSmallGeometryThreshold,
+                (double)fUseLayers, (double)fUseLevelsOfDetail, (double)fUseNativeGeometry
+            };
+
+            uint64_t key = fnv1a_64(values, sizeof(values));
+            key = (key ^ fnv1a_64(options.dashArray.data(), options.dashArray.size() * sizeof(double))) * FNV1A_64_PRIME;
+            key = (key ^ (uint64_t)fFontFace.uniqueId()) * FNV1A_64_PRIME;
+
+            return key;
+        }
+
+        // cullingLimit()
+        // When only part of the surface is being redrawn, limit 
+        // the culling area to that part, in device pixels
+        void cullingLimit(const BLBox& limit) { fCullingLimit = limit; fHasCullingLimit = true; }
+        void noCullingLimit() { fHasCullingLimit = false; }
+
+
+        //=================================================
+        // The transforms, state, and drawing operations that
+        // the nodes use directly from BLContext.  They are virtual
+        // here so that a sub-class, such as a recorder, sees
+        // everything that is drawn.  The other BLContext overloads
+        // remain available.
+        //=================================================
+        using BLContext::setTransform;
+        using BLContext::applyTransform;
+        using BLContext::translate;
+        using BLContext::scale;
+        using BLContext::rotate;
+        using BLContext::setGlobalAlpha;
+        using BLContext::setFillRule;
+        using BLContext::setStrokeJoin;
+        using BLContext::fillPath;
+        using BLContext::strokePath;
+        using BLContext::fillGeometry;
+        using BLContext::strokeGeometry;
+        using BLContext::blitImage;
+        using BLContext::fillMask;
+
+        // transformChanging()
+        // The transform is not tracked, it changes with nearly every node.
+        // A gradient or pattern takes on the transform that's in effect when
+        // it is set, so after the transform changes, setting the same one
+        // again is not the same thing anymore.  Solid colors don't care.
+        void transformChanging()
+        {
+            willChangeState();
+
+            if (fState.fFillStyle.isGradient() || fState.fFillStyle.isPattern())
+                fState.fKnown &= ~STATE_FILL_STYLE;
+            if (fState.fStrokeStyle.isGradient() || fState.fStrokeStyle.isPattern())
+                fState.fKnown &= ~STATE_STROKE_STYLE;
+        }
+
+        virtual BLResult setTransform(const BLMatrix2D& m) { transformChanging(); return BLContext::setTransform(m); }
+        virtual BLResult applyTransform(const BLMatrix2D& m) { transformChanging(); return BLContext::applyTransform(m); }
+        virtual BLResult translate(double x, double y) { transformChanging(); return BLContext::translate(x, y); }
+        virtual BLResult translate(const BLPoint& p) { transformChanging(); return BLContext::translate(p); }
+        virtual BLResult scale(double x, double y) { transformChanging(); return BLContext::scale(x, y); }
+        virtual BLResult rotate(double angle) { transformChanging(); return BLContext::rotate(angle); }
+
+        virtual BLResult setGlobalAlpha(double alpha) 
+        { 
+            if (stateIs(STATE_GLOBAL_ALPHA, fState.fGlobalAlpha == alpha))
+                return BL_SUCCESS;
+
+            willChangeState();
+            fState.fGlobalAlpha = alpha;
+            fState.fKnown |= STATE_GLOBAL_ALPHA;
+
+            return BLContext::setGlobalAlpha(alpha);
+        }
+
+        virtual BLResult setFillRule(BLFillRule rule) 
+        { 
+            if (stateIs(STATE_FILL_RULE, fState.fFillRule == (uint32_t)rule))
+                return BL_SUCCESS;
+
+            willChangeState();
+            fState.fFillRule = (uint32_t)rule;
+            fState.fKnown |= STATE_FILL_RULE;
+
+            return BLContext::setFillRule(rule);
+        }
+
+        virtual BLResult setStrokeJoin(BLStrokeJoin join) 
+        { 
+            if (stateIs(STATE_STROKE_JOIN, fState.fStrokeJoin == (uint32_t)join))
+                return BL_SUCCESS;
+
+            willChangeState();
+            fState.fStrokeJoin = (uint32_t)join;
+            fState.fKnown |= STATE_STROKE_JOIN;
+
+            return BLContext::setStrokeJoin(join);
+        }
+
+        virtual BLResult fillPath(const BLPathCore& path) { return BLContext::fillPath(path); }
+        virtual BLResult strokePath(const BLPathCore& path) { return BLContext::strokePath(path); }
+        virtual BLResult fillGeometry(BLGeometryType type, const void* data) { return BLContext::fillGeometry(type, data); }
+        virtual BLResult strokeGeometry(BLGeometryType type, const void* data) { return BLContext::strokeGeometry(type, data); }
+        virtual BLResult blitImage(const BLRect& dst, const BLImageCore& src) { return BLContext::blitImage(dst, src); }
+        virtual BLResult blitImage(const BLRect& dst, const BLImageCore& src, const BLRectI& srcArea) { return BLContext::blitImage(dst, src, srcArea); }
+        virtual BLResult fillMask(const BLPoint& origin, const BLImage& mask) { return BLContext::fillMask(origin, mask); }
+
+
+        // The save is put off until something changes
         virtual bool push() {
-            auto res = save();
-            return res == BL_SUCCESS;
+            fStateStats.fPushes++;
+            fSaveStack.push_back(SaveLevel{});
+
+            if (!fTrackState)
+                willChangeState();
+
+            return true;
         }
         
         virtual bool pop() {
+            if (fSaveStack.empty())
+            {
+                auto res = restore();
+                return res == BL_SUCCESS;
+            }
+
+            bool saved = fSaveStack.back().fSaved;
+            if (saved)
+                fState = fSaveStack.back().fState;
+            fSaveStack.pop_back();
+
+            if (!saved)
+                return true;
+
             auto res = restore();
             return res == BL_SUCCESS;
         }
@@ -153,23 +662,83 @@ namespace waavs
             {
                 printf("IRenderSVG.flush(), ERROR: %d\n", bResult);
             }
+            else
+                recycleSurfaces();
 
             return bResult == BL_SUCCESS;
         }
 
         // paint for filling polygons
-        virtual void fill(const BLVar& value) { if (!value.isNull())BLContext::setFillStyle(value); }
-        virtual void fill(const BLRgba32& value) { BLContext::setFillStyle(value); };
-        virtual void fillOpacity(double o) { BLContext::setFillAlpha(o); };
+        virtual void fill(const BLVar& value) 
+        { 
+            if (value.isNull() || stateIs(STATE_FILL_STYLE, fState.fFillStyle.equals(value)))
+                return;
+
+            willChangeState();
+            BLContext::setFillStyle(value);
+            fState.fFillStyle.assign(value);
+            fState.fKnown |= STATE_FILL_STYLE;
+        }
+
+        virtual void fill(const BLRgba32& value) { fill(BLVar(value)); };
+
+        virtual void fillOpacity(double o) 
+        { 
+            if (stateIs(STATE_FILL_ALPHA, fState.fFillAlpha == o))
+                return;
 
-        virtual void noFill() { BLContext::setFillStyle(BLVar::null()); }
+            willChangeState();
+            BLContext::setFillAlpha(o);
+            fState.fFillAlpha = o;
+            fState.fKnown |= STATE_FILL_ALPHA;
+        };
+
+        virtual void noFill() 
+        { 
+            if (stateIs(STATE_FILL_STYLE, fState.fFillStyle.isNull()))
+                return;
+
+            willChangeState();
+            BLContext::setFillStyle(BLVar::null());
+            fState.fFillStyle.reset();
+            fState.fKnown |= STATE_FILL_STYLE;
+        }
 
         // paint for stroking lines
-        virtual void stroke(const BLVar& value) { if (!value.isNull()) BLContext::setStrokeStyle(value); }
-        virtual void stroke(const BLRgba32& value) { BLContext::setStrokeStyle(value); }
-        virtual void strokeOpacity(double o) { BLContext::setStrokeAlpha(o); }
+        virtual void stroke(const BLVar& value) 
+        { 
+            if (value.isNull() || stateIs(STATE_STROKE_STYLE, fState.fStrokeStyle.equals(value)))
+                return;
+
+            willChangeState();
+            BLContext::setStrokeStyle(value);
+            fState.fStrokeStyle.assign(value);
+            fState.fKnown |= STATE_STROKE_STYLE;
+        }
+
+        virtual void stroke(const BLRgba32& value) { stroke(BLVar(value)); }
 
-        virtual void noStroke() { setStrokeStyle(BLVar::null()); }
+        virtual void strokeOpacity(double o) 
+        { 
+            if (stateIs(STATE_STROKE_ALPHA, fState.fStrokeAlpha == o))
+                return;
+
+            willChangeState();
+            BLContext::setStrokeAlpha(o);
+            fState.fStrokeAlpha = o;
+            fState.fKnown |= STATE_STROKE_ALPHA;
+        }
+
+        virtual void noStroke() 
+        { 
+            if (stateIs(STATE_STROKE_STYLE, fState.fStrokeStyle.isNull()))
+                return;
+
+            willChangeState();
+            BLContext::setStrokeStyle(BLVar::null());
+            fState.fStrokeStyle.reset();
+            fState.fKnown |= STATE_STROKE_STYLE;
+        }
 
 
         // Background management
@@ -195,14 +764,15 @@ namespace waavs
 
         // Clipping
         virtual void clip(const BLRect& bb) {
+            willChangeState();
             BLContext::clipToRect(bb);
         }
         
-        virtual void noClip() { BLContext::restoreClipping(); }
+        virtual void noClip() { willChangeState(); BLContext::restoreClipping(); }
 
         // Geometry
         // hard set a specfic pixel value
-        virtual void fillRule(int rule) { BLContext::setFillRule((BLFillRule)rule); }
+        virtual void fillRule(int rule) { setFillRule((BLFillRule)rule); }
 
 
         virtual void path(const BLPath& path) {
@@ -0,0 +1,164 @@
+#pragma once
+
+//
+// memscan
+// Delimiter searching over raw byte ranges.
+//
+// The xml scanner spends most of its time skipping over long runs of
+// attribute values, path data, and content, looking for a single
+// delimiter character ('<', '>', a quote, or the first character of a
+// terminator like "-->").  Doing that a byte at a time is the single
+// biggest cost when loading very large documents.
+//
+// The routines here will look at 32 bytes at a time (AVX2), or 16 bytes
+// at a time (SSE2), and fall back to a plain scalar loop when neither
+// is available.  The instruction set is selected at compile time, so
+// there is no runtime dispatch cost.
+//
+// All routines take a [start, end) range, and return a pointer to the
+// first matching byte, or 'end' if there is no match.  They never read
+// beyond 'end'.
+//
+
+#include <cstdint>
+#include <cstring>
+
+#include "definitions.h"
+
+#if defined(__AVX2__)
+    #define WAAVS_MEMSCAN_AVX2 1
+    #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+    #define WAAVS_MEMSCAN_SSE2 1
+    #include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+
+namespace waavs
+{
+    // Index of the lowest set bit of a non-zero mask
+    static inline unsigned memscan_ctz32(uint32_t mask) noexcept
+    {
+#if defined(_MSC_VER)
+        unsigned long idx;
+        _BitScanForward(&idx, mask);
+        return (unsigned)idx;
+#else
+        return (unsigned)__builtin_ctz(mask);
+#endif
+    }
+
+    //
+    // memscan_byte()
+    //
+    // Find the first occurence of byte 'c' in the range
+    //
+    static inline const uint8_t* memscan_byte(const uint8_t* start, const uint8_t* end, const uint8_t c) noexcept
+    {
+#if defined(WAAVS_MEMSCAN_AVX2)
+        const __m256i needle = _mm256_set1_epi8((char)c);
+        while (end - start >= 32)
+        {
+            __m256i block = _mm256_loadu_si256((const __m256i*)start);
+            uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle));
+            if (mask != 0)
+                return start + memscan_ctz32(mask);
+            start += 32;
+        }
+#endif
+
+#if defined(WAAVS_MEMSCAN_AVX2) || defined(WAAVS_MEMSCAN_SSE2)
+        const __m128i needle16 = _mm_set1_epi8((char)c);
+        while (end - start >= 16)
+        {
+            __m128i block = _mm_loadu_si128((const __m128i*)start);
+            uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle16));
+            if (mask != 0)
+                return start + memscan_ctz32(mask);
+            start += 16;
+        }
+#endif
+
+        // scalar tail, or the whole thing if there is no vector support
+        while (start < end && *start != c)
+            ++start;
+
+        return start;
+    }
+
+    //
+    // memscan_byte2()
+    //
+    // Find the first occurence of either byte 'c1' or 'c2' in the range
+    // Useful when looking for either kind of quote character
+    //
+    static inline const uint8_t* memscan_byte2(const uint8_t* start, const uint8_t* end, const uint8_t c1, const uint8_t c2) noexcept
+    {
+#if defined(WAAVS_MEMSCAN_AVX2)
+        const __m256i n1 = _mm256_set1_epi8((char)c1);
+        const __m256i n2 = _mm256_set1_epi8((char)c2);
+        while (end - start >= 32)
+        {
+            __m256i block = _mm256_loadu_si256((const __m256i*)start);
+            __m256i hits = _mm256_or_si256(_mm256_cmpeq_epi8(block, n1), _mm256_cmpeq_epi8(block, n2));
+            uint32_t mask = (uint32_t)_mm256_movemask_epi8(hits);
+            if (mask != 0)
+                return start + memscan_ctz32(mask);
+            start += 32;
+        }
+#endif
+
+#if defined(WAAVS_MEMSCAN_AVX2) || defined(WAAVS_MEMSCAN_SSE2)
+        const __m128i m1 = _mm_set1_epi8((char)c1);
+        const __m128i m2 = _mm_set1_epi8((char)c2);
+        while (end - start >= 16)
+        {
+            __m128i block = _mm_loadu_si128((const __m128i*)start);
+            __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(block, m1), _mm_cmpeq_epi8(block, m2));
+            uint32_t mask = (uint32_t)_mm_movemask_epi8(hits);
+            if (mask != 0)
+                return start + memscan_ctz32(mask);
+            start += 16;
+        }
+#endif
+
+        while (start < end && *start != c1 && *start != c2)
+            ++start;
+
+        return start;
+    }
+
+    //
+    // memscan_str()
+    //
+    // Find the first occurence of the 'needle' sequence in the range
+    // The vector search is used to find candidates for the first byte,
+    // and only those candidates are compared against the full needle.
+    // Returns 'end' if the needle is not found
+    //
+    static inline const uint8_t* memscan_str(const uint8_t* start, const uint8_t* end, const uint8_t* needle, size_t needleLen) noexcept
+    {
+        if (needleLen == 0)
+            return start;
+
+        const uint8_t first = needle[0];
+
+        while (end - start >= (ptrdiff_t)needleLen)
+        {
+            start = memscan_byte(start, end - (needleLen - 1), first);
+            if (end - start < (ptrdiff_t)needleLen)
+                break;
+
+            if (memcmp(start + 1, needle + 1, needleLen - 1) == 0)
+                return start;
+
+            ++start;
+        }
+
+        return end;
+    }
+}
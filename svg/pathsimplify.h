@@ -0,0 +1,333 @@
+#pragma once
+
+//
+// pathsimplify
+// Simplified versions of a path, for drawing it when it is small.
+//
+// When a large, detailed document, like a map, is drawn zoomed far
+// out, most of the vertices of its paths land within a fraction of a
+// pixel of each other.  They still cost as much to process as when
+// they're large.
+//
+// PathLevelsOfDetail keeps a few simplified versions of a path, one
+// for each power of two the drawing is scaled down by.  Level k is
+// meant for scales at or below 1/2^k.  Its curves are flattened into
+// lines, and then lines that don't contribute are removed
+// (Douglas-Peucker), all within a tolerance that is less than half a
+// device pixel at that scale.
+//
+// Each level is built from the one before it, so building them all
+// doesn't take much more than building the first.  The tolerance
+// each level uses is small enough that the error, all added up, is
+// still within the bound.  A level is only kept if it is a good deal
+// smaller than the one before it.
+//
+
+#include <cmath>
+#include <vector>
+
+#include "blend2d.h"
+
+
+namespace waavs
+{
+    //===========================================================
+    // Flattening curves
+    // The number of line segments needed to keep within 'tolerance'
+    // of a curve comes from Wang's formula.
+    //===========================================================
+    static inline int curveSegments(double deviation, double degreeFactor, double tolerance)
+    {
+        if (deviation <= 0)
+            return 1;
+
+        double n = std::ceil(std::sqrt(degreeFactor * deviation / tolerance));
+        if (n < 1)
+            return 1;
+        if (n > 256)
+            return 256;
+
+        return (int)n;
+    }
+
+    static inline double pointLength(const BLPoint& p) { return std::sqrt(p.x * p.x + p.y * p.y); }
+
+    static inline void flattenQuad(const BLPoint& p0, const BLPoint& p1, const BLPoint& p2, double tolerance, std::vector<BLPoint>& pts)
+    {
+        int n = curveSegments(pointLength(p0 - p1 * 2.0 + p2), 0.25, tolerance);
+
+        for (int i = 1; i <= n; i++)
+        {
+            double t = (double)i / n;
+            double mt = 1.0 - t;
+            pts.push_back(p0 * (mt * mt) + p1 * (2.0 * mt * t) + p2 * (t * t));
+        }
+    }
+
+    static inline void flattenCubic(const BLPoint& p0, const BLPoint& p1, const BLPoint& p2, const BLPoint& p3, double tolerance, std::vector<BLPoint>& pts)
+    {
+        double d = std::max(pointLength(p0 - p1 * 2.0 + p2), pointLength(p1 - p2 * 2.0 + p3));
+        int n = curveSegments(d, 0.75, tolerance);
+
+        for (int i = 1; i <= n; i++)
+        {
+            double t = (double)i / n;
+            double mt = 1.0 - t;
+            pts.push_back(p0 * (mt * mt * mt) + p1 * (3.0 * mt * mt * t) + p2 * (3.0 * mt * t * t) + p3 * (t * t * t));
+        }
+    }
+
+    //===========================================================
+    // simplifyPolyline()
+    // Douglas-Peucker.  Keep the fewest points such that none of
+    // those dropped is more than 'tolerance' from the lines between
+    // the ones that are kept.  Done with a stack rather than recursion.
+    //===========================================================
+    static inline double segmentDistanceSquared(const BLPoint& p, const BLPoint& a, const BLPoint& b)
+    {
+        BLPoint ab = b - a;
+        BLPoint ap = p - a;
+
+        double len2 = ab.x * ab.x + ab.y * ab.y;
+        double t = 0;
+        if (len2 > 0)
+            t = std::max(0.0, std::min(1.0, (ap.x * ab.x + ap.y * ab.y) / len2));
+
+        BLPoint d = ap - ab * t;
+        return d.x * d.x + d.y * d.y;
+    }
+
+    static inline void simplifyPolyline(const std::vector<BLPoint>& pts, double tolerance, std::vector<BLPoint>& out)
+    {
+        out.clear();
+
+        if (pts.size() <= 2)
+        {
+            out = pts;
+            return;
+        }
+
+        double tol2 = tolerance * tolerance;
+        std::vector<bool> keep(pts.size(), false);
+        keep.front() = true;
+        keep.back() = true;
+
+        std::vector<std::pair<size_t, size_t>> stack{};
+        stack.push_back({ 0, pts.size() - 1 });
+
+        while (!stack.empty())
+        {
+            auto span = stack.back();
+            stack.pop_back();
+
+            double maxDist = 0;
+            size_t maxIdx = 0;
+
+            for (size_t i = span.first + 1; i < span.second; i++)
+            {
+                double d = segmentDistanceSquared(pts[i], pts[span.first], pts[span.second]);
+                if (d > maxDist)
+                {
+                    maxDist = d;
+                    maxIdx = i;
+                }
+            }
+
+            if (maxDist > tol2)
+            {
+                keep[maxIdx] = true;
+                stack.push_back({ span.first, maxIdx });
+                stack.push_back({ maxIdx, span.second });
+            }
+        }
+
+        for (size_t i = 0; i < pts.size(); i++)
+        {
+            if (keep[i])
+                out.push_back(pts[i]);
+        }
+    }
+
+    //===========================================================
+    // simplifyPath()
+    // Flatten the curves of 'src', within 'flattenTolerance', and
+    // then simplify each figure within 'tolerance'.  The result only
+    // has lines in it.  Returns false if the path has something in
+    // it we don't deal with, like conics.
+    //===========================================================
+    static inline bool simplifyPath(const BLPath& src, double flattenTolerance, double tolerance, BLPath& dst)
+    {
+        dst.clear();
+
+        const uint8_t* cmds = src.commandData();
+        const BLPoint* verts = src.vertexData();
+        size_t count = src.size();
+
+        std::vector<BLPoint> figure{};
+        std::vector<BLPoint> simplified{};
+
+        auto emitFigure = [&](bool closed) {
+            if (figure.empty())
+                return;
+
+            if (closed)
+                figure.push_back(figure.front());
+
+            simplifyPolyline(figure, tolerance, simplified);
+
+            if (closed && simplified.size() > 1)
+                simplified.pop_back();
+
+            dst.moveTo(simplified[0]);
+            for (size_t i = 1; i < simplified.size(); i++)
+                dst.lineTo(simplified[i]);
+
+            if (closed)
+                dst.close();
+
+            figure.clear();
+        };
+
+        size_t i = 0;
+        while (i < count)
+        {
+            switch (cmds[i])
+            {
+            case BL_PATH_CMD_MOVE:
+                emitFigure(false);
+                figure.push_back(verts[i]);
+                i++;
+                break;
+
+            case BL_PATH_CMD_ON:
+                if (figure.empty())
+                    return false;
+                figure.push_back(verts[i]);
+                i++;
+                break;
+
+            case BL_PATH_CMD_QUAD: {
+                if (figure.empty() || i + 1 >= count)
+                    return false;
+                BLPoint start = figure.back();
+                flattenQuad(start, verts[i], verts[i + 1], flattenTolerance, figure);
+                i += 2;
+            }
+                break;
+
+            case BL_PATH_CMD_CUBIC: {
+                if (figure.empty() || i + 2 >= count)
+                    return false;
+                BLPoint start = figure.back();
+                flattenCubic(start, verts[i], verts[i + 1], verts[i + 2], flattenTolerance, figure);
+                i += 3;
+            }
+                break;
+
+            case BL_PATH_CMD_CLOSE:
+                emitFigure(true);
+                i++;
+                break;
+
+            default:
+                return false;
+            }
+        }
+
+        emitFigure(false);
+
+        return true;
+    }
+
+
+    //===========================================================
+    // PathLevelsOfDetail
+    //===========================================================
+    struct PathLevelsOfDetail
+    {
+        // Paths smaller than this aren't worth simplifying
+        static constexpr size_t kMinVertices = 128;
+        static constexpr int kMaxLevel = 8;
+
+        // The error allowed, in device pixels
+        static constexpr double kDeviceTolerance = 0.5;
+
+        struct Level {
+            int fLevel{ 0 };
+            BLPath fPath{};
+        };
+
+        // From the finest to the coarsest
+        std::vector<Level> fLevels{};
+        bool fBuilt{ false };
+
+
+        bool empty() const { return fLevels.empty(); }
+        bool built() const { return fBuilt; }
+        void clear() { fLevels.clear(); fBuilt = false; }
+
+        // build()
+        // Create the simplified versions of 'src'.  Returns
+        // false if there aren't any.
+        bool build(const BLPath& src)
+        {
+            fLevels.clear();
+            fBuilt = true;
+
+            if (src.size() < kMinVertices)
+                return false;
+
+            const BLPath* from = &src;
+            size_t fromSize = src.size();
+
+            for (int level = 1; level <= kMaxLevel; level++)
+            {
+                // The tolerance, in user units, that comes to
+                // kDeviceTolerance at a scale of 1/2^level.
+                // A quarter of it is used by each level, so the
+                // levels this one is built from, plus the flattening
+                // of curves, add up to less than three quarters of it.
+                double tolerance = kDeviceTolerance * std::ldexp(1.0, level);
+
+                BLPath simplified{};
+                if (!simplifyPath(*from, tolerance / 4.0, tolerance / 4.0, simplified))
+                    return !fLevels.empty();
+
+                // Not worth keeping if it didn't shrink much
+                if (simplified.size() * 4 > fromSize * 3)
+                    continue;
+
+                simplified.shrink();
+                fLevels.push_back(Level{ level, simplified });
+
+                from = &fLevels.back().fPath;
+                fromSize = from->size();
+            }
+
+            return !fLevels.empty();
+        }
+
+        // select()
+        // The simplified path to draw at 'scale', or nullptr
+        // if the original should be drawn
+        const BLPath* select(double scale) const
+        {
+            if (fLevels.empty() || scale <= 0)
+                return nullptr;
+
+            int wanted = (int)std::floor(-std::log2(scale));
+            if (wanted < fLevels.front().fLevel)
+                return nullptr;
+
+            const BLPath* found = nullptr;
+            for (const auto& lvl : fLevels)
+            {
+                if (lvl.fLevel > wanted)
+                    break;
+                found = &lvl.fPath;
+            }
+
+            return found;
+        }
+    };
+}
@@ -7,6 +7,7 @@
 #include "svgattributes.h"
 #include "svgshapes.h"
 #include "svgdocument.h"
+#include "svgdisplaylist.h"
 #include "svgfilter.h"
 #include "viewport.h"
 #include "fonthandler.h"
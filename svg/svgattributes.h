@@ -21,7 +21,7 @@ namespace waavs {
     {
         static void registerFactory() {
             registerSVGAttribute("extendMode", [](const ByteSpan& value) {
-                auto node = std::make_shared<SVGPatternExtendMode>(nullptr);
+                auto node = arena_make_shared<SVGPatternExtendMode>(nullptr);
                 node->loadFromChunk(value);
                 return node;
                 });
@@ -65,7 +65,7 @@ namespace waavs {
     {
         static void registerFactory() {
             registerSVGAttribute("transform", [](const ByteSpan& value) {
-                auto node = std::make_shared<SVGTransform>(nullptr);
+                auto node = arena_make_shared<SVGTransform>(nullptr);
 			    node->loadFromChunk(value);
 				return node;
 				});
@@ -178,7 +178,7 @@ namespace waavs {
     {
         static void registerFactory() {
 			registerSVGAttribute("opacity", [](const ByteSpan& value) {
-				auto node = std::make_shared<SVGOpacity>(nullptr);
+				auto node = arena_make_shared<SVGOpacity>(nullptr);
 			node->loadFromChunk(value);
 			return node;
 				});
@@ -218,7 +218,7 @@ namespace waavs {
     {
         static void registerFactory() {
             registerSVGAttribute("fill-opacity", [](const ByteSpan& value) {
-                auto node = std::make_shared<SVGFillOpacity>(nullptr); 
+                auto node = arena_make_shared<SVGFillOpacity>(nullptr); 
                 node->loadFromChunk(value);  
                 return node;
                 });
@@ -239,7 +239,7 @@ namespace waavs {
     {
         static void registerFactory() {
             registerSVGAttribute("stroke-opacity", [](const ByteSpan& value) {
-                auto node = std::make_shared<SVGStrokeOpacity>(nullptr); 
+                auto node = arena_make_shared<SVGStrokeOpacity>(nullptr); 
                 node->loadFromChunk(value);  
                 return node; 
                 });
@@ -265,7 +265,7 @@ namespace waavs {
     {
         static void registerFactory() {
             registerSVGAttribute("paint-order", [](const ByteSpan& value) {
-                auto node = std::make_shared<SVGPaintOrderAttribute>(nullptr); 
+                auto node = arena_make_shared<SVGPaintOrderAttribute>(nullptr); 
                 node->loadFromChunk(value);  
                 return node; 
                 });
@@ -299,7 +299,7 @@ namespace waavs {
 		static void registerFactory() 
         {
             registerSVGAttribute("systemLanguage", [](const ByteSpan& value) {
-                auto node = std::make_shared<SVGRawAttribute>(nullptr); 
+                auto node = arena_make_shared<SVGRawAttribute>(nullptr); 
                 node->loadFromChunk(value);  
                 return node; 
                 });
@@ -330,7 +330,7 @@ namespace waavs {
     {
         static void registerFactory() {
             registerSVGAttribute("font-size", [](const ByteSpan& value) {
-                auto node = std::make_shared<SVGFontSize>(nullptr); 
+                auto node = arena_make_shared<SVGFontSize>(nullptr); 
                 node->loadFromChunk(value);  
                 return node; 
                 });
@@ -401,7 +401,7 @@ namespace waavs {
     {
         static void registerFactory() {
             registerSVGAttribute("font-family", [](const ByteSpan& value) {
-                auto node = std::make_shared<SVGFontFamily>(nullptr); 
+                auto node = arena_make_shared<SVGFontFamily>(nullptr); 
                 node->loadFromChunk(value);  
                 return node; 
                 });
@@ -678,7 +678,7 @@ namespace waavs {
     {
         static void registerFactory() {
             registerSVGAttribute("text-anchor", [](const ByteSpan& value) {
-                auto node = std::make_shared<SVGTextAnchor>(nullptr); 
+                auto node = arena_make_shared<SVGTextAnchor>(nullptr); 
                 node->loadFromChunk(value);  
                 return node; 
                 });
@@ -731,7 +731,7 @@ namespace waavs {
     {
         static void registerFactory() {
             registerSVGAttribute("text-align", [](const ByteSpan& value) {
-                auto node = std::make_shared<SVGTextAlign>(nullptr); 
+                auto node = arena_make_shared<SVGTextAlign>(nullptr); 
                 node->loadFromChunk(value);  
                 return node; 
                 });
@@ -935,7 +935,7 @@ namespace waavs {
 	{
         static void registerFactory() {
             registerSVGAttribute("fill", [](const ByteSpan& value) {
-                auto node = std::make_shared<SVGFillPaint>(nullptr); 
+                auto node = arena_make_shared<SVGFillPaint>(nullptr); 
                 node->loadFromChunk(value);  
                 return node; 
                 });
@@ -982,7 +982,7 @@ namespace waavs {
     {
         static void registerFactory() {
             registerSVGAttribute("stroke", [](const ByteSpan& value) {
-                auto node = std::make_shared<SVGStrokePaint>(nullptr); 
+                auto node = arena_make_shared<SVGStrokePaint>(nullptr); 
                 node->loadFromChunk(value);  
                 return node; 
                 });
@@ -1018,7 +1018,7 @@ namespace waavs {
     {
         static void registerFactory() {
             registerSVGAttribute("fill-rule", [](const ByteSpan& value) {
-                auto node = std::make_shared<SVGFillRule>(nullptr); 
+                auto node = arena_make_shared<SVGFillRule>(nullptr); 
                 node->loadFromChunk(value);  
                 return node; 
                 });
@@ -1055,6 +1055,8 @@ namespace waavs {
             else
                 set(false);
 
+            fVar = (uint32_t)fValue;
+
             return true;
         }
 
@@ -1070,7 +1072,7 @@ namespace waavs {
     struct SVGStrokeWidth : public SVGVisualProperty
     {
         static void registerFactory() {
-            registerSVGAttribute("stroke-width", [](const ByteSpan& value) {auto node = std::make_shared<SVGStrokeWidth>(nullptr); node->loadFromChunk(value);  return node; });
+            registerSVGAttribute("stroke-width", [](const ByteSpan& value) {auto node = arena_make_shared<SVGStrokeWidth>(nullptr); node->loadFromChunk(value);  return node; });
         }
 
 
@@ -1090,6 +1092,7 @@ namespace waavs {
         bool loadSelfFromChunk(const ByteSpan& inChunk) override
         {
             fWidth = toNumber(inChunk);
+            fVar = fWidth;
             set(true);
             
             return true;
@@ -1105,7 +1108,7 @@ namespace waavs {
     struct SVGStrokeMiterLimit : public SVGVisualProperty
     {
         static void registerFactory() {
-            registerSVGAttribute("stroke-miterlimit", [](const ByteSpan& value) {auto node = std::make_shared<SVGStrokeMiterLimit>(nullptr); node->loadFromChunk(value);  return node; });
+            registerSVGAttribute("stroke-miterlimit", [](const ByteSpan& value) {auto node = arena_make_shared<SVGStrokeMiterLimit>(nullptr); node->loadFromChunk(value);  return node; });
         }
 
         
@@ -1142,9 +1145,9 @@ namespace waavs {
     {
         static void registerFactory()
         {
-            registerSVGAttribute("stroke-linecap", [](const ByteSpan& value) {auto node = std::make_shared<SVGStrokeLineCap>(nullptr,"stroke-linecap"); node->loadFromChunk(value);  return node; });
-            registerSVGAttribute("stroke-linecap-start", [](const ByteSpan& value) {auto node = std::make_shared<SVGStrokeLineCap>(nullptr,"stroke-linecap-start"); node->loadFromChunk(value);  return node; });
-            registerSVGAttribute("stroke-linecap-end", [](const ByteSpan& value) {auto node = std::make_shared<SVGStrokeLineCap>(nullptr, "stroke-linecap-end"); node->loadFromChunk(value);  return node; });
+            registerSVGAttribute("stroke-linecap", [](const ByteSpan& value) {auto node = arena_make_shared<SVGStrokeLineCap>(nullptr,"stroke-linecap"); node->loadFromChunk(value);  return node; });
+            registerSVGAttribute("stroke-linecap-start", [](const ByteSpan& value) {auto node = arena_make_shared<SVGStrokeLineCap>(nullptr,"stroke-linecap-start"); node->loadFromChunk(value);  return node; });
+            registerSVGAttribute("stroke-linecap-end", [](const ByteSpan& value) {auto node = arena_make_shared<SVGStrokeLineCap>(nullptr, "stroke-linecap-end"); node->loadFromChunk(value);  return node; });
         }
 
         
@@ -1215,7 +1218,7 @@ namespace waavs {
     struct SVGStrokeLineJoin : public SVGVisualProperty
     {
         static void registerFactory() {
-            registerSVGAttribute("stroke-linejoin", [](const ByteSpan& value) {auto node = std::make_shared<SVGStrokeLineJoin>(nullptr); node->loadFromChunk(value);  return node; });
+            registerSVGAttribute("stroke-linejoin", [](const ByteSpan& value) {auto node = arena_make_shared<SVGStrokeLineJoin>(nullptr); node->loadFromChunk(value);  return node; });
         }
         
         BLStrokeJoin fLineJoin{ BL_STROKE_JOIN_MITER_BEVEL };
@@ -1265,10 +1268,10 @@ namespace waavs {
     struct SVGViewbox : public SVGVisualProperty
     {
         static void registerFactory() {
-            registerSVGAttribute("viewBox", [](const ByteSpan& value) {auto node = std::make_shared<SVGViewbox>(nullptr); node->loadFromChunk(value);  return node; });
+            registerSVGAttribute("viewBox", [](const ByteSpan& value) {auto node = arena_make_shared<SVGViewbox>(nullptr); node->loadFromChunk(value);  return node; });
 
             //gSVGPropertyCreation["viewBox"] = [](IAmGroot* root, const XmlAttributeCollection& elem) {
-            //    auto node = std::make_shared<SVGViewbox>(root);
+            //    auto node = arena_make_shared<SVGViewbox>(root);
             //    node->loadFromChunk(elem.getAttribute("viewBox"));
             //    return node;
             //};
@@ -1439,10 +1442,10 @@ namespace waavs {
     {
         
         static void registerMarkerFactory() {
-            registerSVGAttribute("marker", [](const ByteSpan& value) {auto node = std::make_shared<SVGMarkerAttribute>(nullptr); node->loadFromChunk(value);  return node; });
-            registerSVGAttribute("marker-start", [](const ByteSpan& value) {auto node = std::make_shared<SVGMarkerAttribute>(nullptr); node->loadFromChunk(value);  return node; });
-            registerSVGAttribute("marker-mid", [](const ByteSpan& value) {auto node = std::make_shared<SVGMarkerAttribute>(nullptr); node->loadFromChunk(value);  return node; });
-            registerSVGAttribute("marker-end", [](const ByteSpan& value) {auto node = std::make_shared<SVGMarkerAttribute>(nullptr); node->loadFromChunk(value);  return node; });
+            registerSVGAttribute("marker", [](const ByteSpan& value) {auto node = arena_make_shared<SVGMarkerAttribute>(nullptr); node->loadFromChunk(value);  return node; });
+            registerSVGAttribute("marker-start", [](const ByteSpan& value) {auto node = arena_make_shared<SVGMarkerAttribute>(nullptr); node->loadFromChunk(value);  return node; });
+            registerSVGAttribute("marker-mid", [](const ByteSpan& value) {auto node = arena_make_shared<SVGMarkerAttribute>(nullptr); node->loadFromChunk(value);  return node; });
+            registerSVGAttribute("marker-end", [](const ByteSpan& value) {auto node = arena_make_shared<SVGMarkerAttribute>(nullptr); node->loadFromChunk(value);  return node; });
         }
      
 
@@ -1502,11 +1505,11 @@ namespace waavs {
     {
         static void registerFactory()
         {
-            gSVGPropertyCreation["clip-path"] = [](IAmGroot* groot, const XmlAttributeCollection& elem) {
-                auto node = std::make_shared<SVGClipPathAttribute>(groot);
+            registerSVGProperty("clip-path", [](IAmGroot* groot, const XmlAttributeCollection& elem) {
+                auto node = arena_make_shared<SVGClipPathAttribute>(groot);
                 node->loadFromChunk(elem.getAttribute("clip-path"));
                 return node;
-            };
+            });
 
         }
 
@@ -1588,7 +1591,7 @@ namespace waavs {
     struct SVGVectorEffectAttribute : public SVGVisualProperty
     {
         static void registerFactory() {
-            registerSVGAttribute("vector-effect", [](const ByteSpan& value) {auto node = std::make_shared<SVGVectorEffectAttribute>(nullptr); node->loadFromChunk(value);  return node; });
+            registerSVGAttribute("vector-effect", [](const ByteSpan& value) {auto node = arena_make_shared<SVGVectorEffectAttribute>(nullptr); node->loadFromChunk(value);  return node; });
         }
 
 
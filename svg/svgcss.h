@@ -8,6 +8,7 @@
 #include <string>
 
 #include "xmlscan.h"
+#include "arena.h"
 
 // Core data structures and types to support CSS parsing
 
@@ -487,7 +488,7 @@ namespace waavs
             CSSSelectorIterator iter(fSource);
             while (iter.next())
             {
-				auto sel = std::make_shared<CSSSelector>(*iter);
+				auto sel = arena_make_shared<CSSSelector>(*iter);
 				addSelector(sel);
                 
                 //++iter;
@@ -2,6 +2,7 @@
 
 
 #include <cstdint>		// uint8_t, etc
+#include <cmath>
 #include <cstddef>		// nullptr_t, ptrdiff_t, size_t
 
 
@@ -26,74 +27,7 @@ namespace waavs {
     // with no whitespace
     static bool parseNumber(ByteSpan& s, double &value) noexcept
     {
-        double sign = 1.0;
-        double res = 0.0;
-        long long intPart = 0;
-        uint64_t fracPart = 0;
-        bool hasIntPart = false;
-        bool hasFracPart = false;
-
-        // Parse optional sign
-        if (*s == '+') {
-            s++;
-        }
-        else if (*s == '-') {
-            sign = -1;
-            s++;
-        }
-
-        // Parse integer part
-        if (chrDecDigits[*s]) {
-
-            intPart = chunk_to_u64(s);
-
-            res = (double)intPart;
-            hasIntPart = true;
-        }
-
-        // Parse fractional part.
-        if (*s == '.') {
-            s++; // Skip '.'
-            auto sentinel = s.fStart;
-
-            if (chrDecDigits(*s)) {
-                fracPart = chunk_to_u64(s);
-                auto ending = s.fStart;
-
-                ptrdiff_t diff = ending - sentinel;
-                res = res + ((double)fracPart) / (double)powd((double)10, double(diff));
-                hasFracPart = true;
-            }
-        }
-
-        // A valid number should have integer or fractional part.
-        if (!hasIntPart && !hasFracPart)
-            return false;
-
-
-        // Parse optional exponent
-        if (*s == 'e' || *s == 'E') {
-            long long expPart = 0;
-            s++; // skip 'E'
-
-            double expSign = 1.0;
-            if (*s == '+') {
-                s++;
-            }
-            else if (*s == '-') {
-                expSign = -1.0;
-                s++;
-            }
-
-            if (chrDecDigits[*s]) {
-                expPart = chunk_to_u64(s);
-                res = res * powd(10, double(expSign * double(expPart)));
-            }
-        }
-
-        value = res * sign;
-        
-        return true;
+        return chunk_parse_double(s, value);
     }
 
 
@@ -116,6 +50,7 @@ namespace waavs {
 
 		return parseNumber(s, outNumber);
     }
+
 }
 
 
@@ -954,24 +889,12 @@ namespace waavs
         // perfectly represent the numbers we want to parse.
         item.fEnd = s.fStart;
 
-        // Create a chunk that will represent a specific number to be parsed.
-        ByteSpan numChunk{};
-
         // Move the source chunk cursor past the ')', so that whatever
         // needs to use it next is ready to go.
         s++;
 
         // Now we're ready to parse the individual numbers
-        auto numDelims = xmlwsp + ',';
-
-        while (item) {
-            if (na >= maxNa)
-                break;
-
-            if (!parseNextNumber(item, args[na]))
-                break;
-            na++;
-        }
+        na = (int)parseNumberList(item, args, maxNa);
 
         return s;
     }
@@ -1207,6 +1130,40 @@ namespace waavs {
 
     inline void expandRect(BLRect& a, const BLPoint& b) { a = rectMerge(a, b); }
     inline void expandRect(BLRect& a, const BLRect& b) { a = rectMerge(a, b); }
+
+    // boxTransform()
+    //
+    // The box that encloses all four corners of 'b' after
+    // they have gone through the transform 'm'
+    inline BLBox boxTransform(const BLBox& b, const BLMatrix2D& m)
+    {
+        BLPoint p0 = m.mapPoint(b.x0, b.y0);
+        BLPoint p1 = m.mapPoint(b.x1, b.y0);
+        BLPoint p2 = m.mapPoint(b.x1, b.y1);
+        BLPoint p3 = m.mapPoint(b.x0, b.y1);
+
+        return BLBox(std::min(std::min(p0.x, p1.x), std::min(p2.x, p3.x)),
+            std::min(std::min(p0.y, p1.y), std::min(p2.y, p3.y)),
+            std::max(std::max(p0.x, p1.x), std::max(p2.x, p3.x)),
+            std::max(std::max(p0.y, p1.y), std::max(p2.y, p3.y)));
+    }
+
+    inline BLBox boxInflate(const BLBox& b, double d)
+    {
+        return BLBox(b.x0 - d, b.y0 - d, b.x1 + d, b.y1 + d);
+    }
+
+    // transformScale()
+    //
+    // The most that a transform will stretch a length
+    // along either axis.  Good enough to size stroke widths
+    inline double transformScale(const BLMatrix2D& m)
+    {
+        double sx = std::sqrt(m.m00 * m.m00 + m.m01 * m.m01);
+        double sy = std::sqrt(m.m10 * m.m10 + m.m11 * m.m11);
+
+        return std::max(sx, sy);
+    }
 }
 
 
@@ -0,0 +1,512 @@
+#pragma once
+
+//
+// svgdisplaylist
+// A retained list of drawing commands, recorded once from a document,
+// and replayed as many times as needed.
+//
+// Drawing a document walks the whole tree, resolves attributes, paint
+// servers, markers, and so on, every time.  When the same document is
+// drawn over and over, with only the view changing, as with pan and
+// zoom, most of that work produces the exact same drawing commands.
+//
+// The SVGDisplayListRecorder is an IRenderSVG that doesn't draw anything.
+// Instead, it writes down the commands it receives into an SVGDisplayList.
+// The list can then be replayed into any BLContext, with a different
+// base transform each time, without touching the document again.
+//
+// The commands are kept compact.  Each one is an opcode, plus indices
+// into pools of numbers, matrices, paths, styles, images, fonts, and
+// text.  Paths and images are shared with the document (blend2d objects
+// are reference counted), so recording doesn't copy geometry.
+//
+// Usage:
+//   SVGDisplayList dl;
+//   SVGDisplayListRecorder::record(fh, doc.get(), dl);
+//
+//   dl.replay(ctx, viewTransform);
+//
+// A display list is a snapshot.  If the document changes, it needs
+// to be recorded again.
+//
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "irendersvg.h"
+#include "svgdocument.h"
+
+
+namespace waavs
+{
+    enum DisplayListOp : uint8_t
+    {
+        DL_PUSH = 0,
+        DL_POP,
+
+        DL_SET_TRANSFORM,       // A: matrix
+        DL_APPLY_TRANSFORM,     // A: matrix
+        DL_TRANSLATE,           // A: numbers (x, y)
+        DL_SCALE,               // A: numbers (x, y)
+        DL_ROTATE,              // A: numbers (angle)
+
+        DL_FILL_STYLE,          // A: style
+        DL_STROKE_STYLE,        // A: style
+        DL_NO_FILL,
+        DL_NO_STROKE,
+        DL_FILL_ALPHA,          // A: numbers (alpha)
+        DL_STROKE_ALPHA,        // A: numbers (alpha)
+        DL_GLOBAL_ALPHA,        // A: numbers (alpha)
+
+        DL_STROKE_WIDTH,        // A: numbers (width)
+        DL_STROKE_MITER_LIMIT,  // A: numbers (limit)
+        DL_STROKE_JOIN,         // Imm: join
+        DL_STROKE_CAP,          // Imm: cap, B: position
+        DL_STROKE_CAPS,         // Imm: cap
+        DL_STROKE_TRANSFORM_ORDER,  // Imm: order
+        DL_FILL_RULE,           // Imm: rule
+        DL_COMP_OP,             // Imm: composition operator
+
+        DL_CLIP_RECT,           // A: numbers (x, y, w, h)
+        DL_RESTORE_CLIPPING,
+
+        DL_FILL_PATH,           // A: path
+        DL_STROKE_PATH,         // A: path
+        DL_FILL_RECT,           // A: numbers (x, y, w, h)
+        DL_STROKE_RECT,         // A: numbers (x, y, w, h)
+        DL_FILL_GEOMETRY,       // Imm: geometry type, A: numbers (the geometry)
+        DL_STROKE_GEOMETRY,     // Imm: geometry type, A: numbers (the geometry)
+        DL_BLIT_IMAGE,          // A: image, B: numbers (dst x, y, w, h, src x, y, w, h)
+        DL_FILL_MASK,           // A: image, B: numbers (x, y)
+
+        DL_FONT,                // A: font
+        DL_FILL_TEXT,           // A: text, B: numbers (x, y)
+        DL_STROKE_TEXT,         // A: text, B: numbers (x, y)
+
+        DL_FILL_ALL,            // A: style
+        DL_CLEAR_ALL,
+    };
+
+    struct DisplayListCommand
+    {
+        uint8_t fOp{ 0 };
+        uint8_t fImm{ 0 };
+        uint32_t fA{ 0 };
+        uint32_t fB{ 0 };
+    };
+
+
+    struct SVGDisplayList
+    {
+        std::vector<DisplayListCommand> fCommands{};
+
+        std::vector<double> fNumbers{};
+        std::vector<BLMatrix2D> fMatrices{};
+        std::vector<BLPath> fPaths{};
+        std::vector<BLVar> fStyles{};
+        std::vector<BLImage> fImages{};
+        std::vector<BLFont> fFonts{};
+        std::vector<std::string> fTexts{};
+
+        // The frame of the document that was recorded
+        BLRect fFrame{};
+
+
+        size_t size() const { return fCommands.size(); }
+        bool empty() const { return fCommands.empty(); }
+
+        const BLRect& frame() const { return fFrame; }
+        void frame(const BLRect& fr) { fFrame = fr; }
+
+        void clear()
+        {
+            fCommands.clear();
+            fNumbers.clear();
+            fMatrices.clear();
+            fPaths.clear();
+            fStyles.clear();
+            fImages.clear();
+            fFonts.clear();
+            fTexts.clear();
+            fFrame = BLRect{};
+        }
+
+        //=================================================
+        // Adding things to the list
+        //=================================================
+        void add(DisplayListOp op, uint8_t imm = 0, uint32_t a = 0, uint32_t b = 0)
+        {
+            fCommands.push_back(DisplayListCommand{ (uint8_t)op, imm, a, b });
+        }
+
+        uint32_t addNumbers(std::initializer_list<double> values)
+        {
+            uint32_t idx = (uint32_t)fNumbers.size();
+            fNumbers.insert(fNumbers.end(), values);
+            return idx;
+        }
+
+        // Add a simple geometry, which is nothing but doubles
+        uint32_t addGeometry(BLGeometryType type, const void* data)
+        {
+            size_t count = geometryDoubles(type);
+            const double* values = (const double*)data;
+
+            uint32_t idx = (uint32_t)fNumbers.size();
+            fNumbers.insert(fNumbers.end(), values, values + count);
+            return idx;
+        }
+
+        // How many doubles a geometry that can be
+        // stored as numbers takes, or 0 if it can't
+        static size_t geometryDoubles(BLGeometryType type)
+        {
+            switch (type)
+            {
+            case BL_GEOMETRY_TYPE_BOXD: return 4;
+            case BL_GEOMETRY_TYPE_RECTD: return 4;
+            case BL_GEOMETRY_TYPE_CIRCLE: return 3;
+            case BL_GEOMETRY_TYPE_ELLIPSE: return 4;
+            case BL_GEOMETRY_TYPE_ROUND_RECT: return 6;
+            case BL_GEOMETRY_TYPE_LINE: return 4;
+            case BL_GEOMETRY_TYPE_TRIANGLE: return 6;
+            default:
+                return 0;
+            }
+        }
+
+        uint32_t addMatrix(const BLMatrix2D& m) { fMatrices.push_back(m); return (uint32_t)fMatrices.size() - 1; }
+        uint32_t addPath(const BLPathCore& p) { fPaths.push_back(p.dcast()); return (uint32_t)fPaths.size() - 1; }
+        uint32_t addStyle(const BLVar& v) { fStyles.push_back(v); return (uint32_t)fStyles.size() - 1; }
+        uint32_t addImage(const BLImageCore& img) { fImages.push_back(img.dcast()); return (uint32_t)fImages.size() - 1; }
+        uint32_t addFont(const BLFont& f) { fFonts.push_back(f); return (uint32_t)fFonts.size() - 1; }
+        uint32_t addText(const char* txt, size_t len) { fTexts.emplace_back(txt, len); return (uint32_t)fTexts.size() - 1; }
+
+
+        //=================================================
+        // replay()
+        //
+        // Draw the list into 'ctx', with 'base' as the transform from
+        // the document to the context.  The recorded transforms are all
+        // relative to 'base'.  The state of 'ctx' is the same after
+        // the replay as it was before.
+        //=================================================
+        void replay(BLContext& ctx, const BLMatrix2D& base) const
+        {
+            ctx.save();
+
+            ctx.setTransform(base);
+            ctx.userToMeta();
+
+            // The same defaults an IRenderSVG starts with
+            ctx.setCompOp(BL_COMP_OP_SRC_OVER);
+            ctx.setStrokeJoin(BL_STROKE_JOIN_MITER_CLIP);
+            ctx.setFillRule(BL_FILL_RULE_NON_ZERO);
+            ctx.setFillStyle(BLRgba32(0, 0, 0));
+            ctx.setStrokeStyle(BLVar::null());
+            ctx.setStrokeWidth(1.0);
+
+            const BLFont* font = nullptr;
+            const double* num = fNumbers.data();
+
+            for (const auto& cmd : fCommands)
+            {
+                switch (cmd.fOp)
+                {
+                case DL_PUSH: ctx.save(); break;
+                case DL_POP: ctx.restore(); break;
+
+                case DL_SET_TRANSFORM: ctx.setTransform(fMatrices[cmd.fA]); break;
+                case DL_APPLY_TRANSFORM: ctx.applyTransform(fMatrices[cmd.fA]); break;
+                case DL_TRANSLATE: ctx.translate(num[cmd.fA], num[cmd.fA + 1]); break;
+                case DL_SCALE: ctx.scale(num[cmd.fA], num[cmd.fA + 1]); break;
+                case DL_ROTATE: ctx.rotate(num[cmd.fA]); break;
+
+                case DL_FILL_STYLE: ctx.setFillStyle(fStyles[cmd.fA]); break;
+                case DL_STROKE_STYLE: ctx.setStrokeStyle(fStyles[cmd.fA]); break;
+                case DL_NO_FILL: ctx.setFillStyle(BLVar::null()); break;
+                case DL_NO_STROKE: ctx.setStrokeStyle(BLVar::null()); break;
+                case DL_FILL_ALPHA: ctx.setFillAlpha(num[cmd.fA]); break;
+                case DL_STROKE_ALPHA: ctx.setStrokeAlpha(num[cmd.fA]); break;
+                case DL_GLOBAL_ALPHA: ctx.setGlobalAlpha(num[cmd.fA]); break;
+
+                case DL_STROKE_WIDTH: ctx.setStrokeWidth(num[cmd.fA]); break;
+                case DL_STROKE_MITER_LIMIT: ctx.setStrokeMiterLimit(num[cmd.fA]); break;
+                case DL_STROKE_JOIN: ctx.setStrokeJoin((BLStrokeJoin)cmd.fImm); break;
+                case DL_STROKE_CAP: ctx.setStrokeCap((BLStrokeCapPosition)cmd.fB, (BLStrokeCap)cmd.fImm); break;
+                case DL_STROKE_CAPS: ctx.setStrokeCaps((BLStrokeCap)cmd.fImm); break;
+                case DL_STROKE_TRANSFORM_ORDER: ctx.setStrokeTransformOrder((BLStrokeTransformOrder)cmd.fImm); break;
+                case DL_FILL_RULE: ctx.setFillRule((BLFillRule)cmd.fImm); break;
+                case DL_COMP_OP: ctx.setCompOp((BLCompOp)cmd.fImm); break;
+
+                case DL_CLIP_RECT: ctx.clipToRect(BLRect(num[cmd.fA], num[cmd.fA + 1], num[cmd.fA + 2], num[cmd.fA + 3])); break;
+                case DL_RESTORE_CLIPPING: ctx.restoreClipping(); break;
+
+                case DL_FILL_PATH: ctx.fillPath(fPaths[cmd.fA]); break;
+                case DL_STROKE_PATH: ctx.strokePath(fPaths[cmd.fA]); break;
+                case DL_FILL_RECT: ctx.fillRect(BLRect(num[cmd.fA], num[cmd.fA + 1], num[cmd.fA + 2], num[cmd.fA + 3])); break;
+                case DL_STROKE_RECT: ctx.strokeRect(BLRect(num[cmd.fA], num[cmd.fA + 1], num[cmd.fA + 2], num[cmd.fA + 3])); break;
+
+                case DL_FILL_GEOMETRY: ctx.fillGeometry((BLGeometryType)cmd.fImm, num + cmd.fA); break;
+                case DL_STROKE_GEOMETRY: ctx.strokeGeometry((BLGeometryType)cmd.fImm, num + cmd.fA); break;
+
+                case DL_BLIT_IMAGE: {
+                    const double* n = num + cmd.fB;
+                    ctx.blitImage(BLRect(n[0], n[1], n[2], n[3]), fImages[cmd.fA], BLRectI((int)n[4], (int)n[5], (int)n[6], (int)n[7]));
+                }
+                break;
+
+                case DL_FILL_MASK: ctx.fillMask(BLPoint(num[cmd.fB], num[cmd.fB + 1]), fImages[cmd.fA]); break;
+
+                case DL_FONT: font = &fFonts[cmd.fA]; break;
+
+                case DL_FILL_TEXT:
+                    if (nullptr != font)
+                        ctx.fillUtf8Text(BLPoint(num[cmd.fB], num[cmd.fB + 1]), *font, fTexts[cmd.fA].data(), fTexts[cmd.fA].size());
+                    break;
+
+                case DL_STROKE_TEXT:
+                    if (nullptr != font)
+                        ctx.strokeUtf8Text(BLPoint(num[cmd.fB], num[cmd.fB + 1]), *font, fTexts[cmd.fA].data(), fTexts[cmd.fA].size());
+                    break;
+
+                case DL_FILL_ALL: ctx.fillAll(fStyles[cmd.fA]); break;
+                case DL_CLEAR_ALL: ctx.clearAll(); break;
+
+                default:
+                    break;
+                }
+            }
+
+            ctx.restore();
+        }
+    };
+
+
+    //=================================================
+    // SVGDisplayListRecorder
+    //
+    // An IRenderSVG that writes what it's asked to draw into
+    // an SVGDisplayList.  The state changes still go through to
+    // the underlying context, which is a tiny scratch image, so
+    // that anything that asks about the current state, like the
+    // transform or the stroke width, gets the right answer.
+    // Nothing is culled, so the whole document is recorded, and
+    // can be replayed at any scale.
+    //=================================================
+    struct SVGDisplayListRecorder : public IRenderSVG
+    {
+        SVGDisplayList& fList;
+        BLImage fScratch{};
+        BLFont fLastFont{};
+        bool fHaveFont{ false };
+
+        SVGDisplayListRecorder(FontHandler* fh, SVGDisplayList& dl)
+            : IRenderSVG(fh)
+            , fList(dl)
+            , fScratch(1, 1, BL_FORMAT_PRGB32)
+        {
+            fList.clear();
+            begin(fScratch);
+
+            // The list can be replayed at any scale, so
+            // nothing is small enough to draw as a box
+            smallGeometryThreshold(0);
+
+            // Nor should a group become a picture of itself
+            useLayers(false);
+
+            // Or a path be simplified for the scratch image's scale
+            useLevelsOfDetail(false);
+        }
+
+        virtual ~SVGDisplayListRecorder()
+        {
+            BLContext::end();
+        }
+
+        // record()
+        // Convenience to record a whole document
+        static void record(FontHandler* fh, SVGDocument* doc, SVGDisplayList& dl)
+        {
+            SVGDisplayListRecorder rec(fh, dl);
+            doc->draw(&rec);
+            rec.finish();
+
+            dl.frame(doc->frame());
+        }
+
+        void finish() { BLContext::end(); }
+
+        bool cullingArea(BLBox&) override { return false; }
+
+        //=================================================
+        // State, which is recorded and passed along
+        //=================================================
+        bool push() override { fList.add(DL_PUSH); return IRenderSVG::push(); }
+        bool pop() override { fList.add(DL_POP); return IRenderSVG::pop(); }
+        bool flush() override { return true; }
+
+        BLResult setTransform(const BLMatrix2D& m) override { fList.add(DL_SET_TRANSFORM, 0, fList.addMatrix(m)); return IRenderSVG::setTransform(m); }
+        BLResult applyTransform(const BLMatrix2D& m) override { fList.add(DL_APPLY_TRANSFORM, 0, fList.addMatrix(m)); return IRenderSVG::applyTransform(m); }
+        BLResult translate(double x, double y) override { fList.add(DL_TRANSLATE, 0, fList.addNumbers({ x, y })); return IRenderSVG::translate(x, y); }
+        BLResult translate(const BLPoint& p) override { return translate(p.x, p.y); }
+        BLResult scale(double x, double y) override { fList.add(DL_SCALE, 0, fList.addNumbers({ x, y })); return IRenderSVG::scale(x, y); }
+        BLResult rotate(double angle) override { fList.add(DL_ROTATE, 0, fList.addNumbers({ angle })); return IRenderSVG::rotate(angle); }
+
+        BLResult setGlobalAlpha(double alpha) override { fList.add(DL_GLOBAL_ALPHA, 0, fList.addNumbers({ alpha })); return IRenderSVG::setGlobalAlpha(alpha); }
+        BLResult setFillRule(BLFillRule rule) override { fList.add(DL_FILL_RULE, (uint8_t)rule); return IRenderSVG::setFillRule(rule); }
+        BLResult setStrokeJoin(BLStrokeJoin join) override { fList.add(DL_STROKE_JOIN, (uint8_t)join); return IRenderSVG::setStrokeJoin(join); }
+
+        void strokeBeforeTransform(bool b) override
+        {
+            fList.add(DL_STROKE_TRANSFORM_ORDER, (uint8_t)(b ? BL_STROKE_TRANSFORM_ORDER_BEFORE : BL_STROKE_TRANSFORM_ORDER_AFTER));
+            IRenderSVG::strokeBeforeTransform(b);
+        }
+
+        void blendMode(int mode) override { fList.add(DL_COMP_OP, (uint8_t)mode); IRenderSVG::blendMode(mode); }
+        void globalOpacity(double opacity) override { setGlobalAlpha(opacity); }
+
+        void strokeCap(int cap, int position) override { fList.add(DL_STROKE_CAP, (uint8_t)cap, 0, (uint32_t)position); IRenderSVG::strokeCap(cap, position); }
+        void strokeCaps(int caps) override { fList.add(DL_STROKE_CAPS, (uint8_t)caps); IRenderSVG::strokeCaps(caps); }
+        void strokeJoin(int join) override { setStrokeJoin((BLStrokeJoin)join); }
+        void strokeMiterLimit(double limit) override { fList.add(DL_STROKE_MITER_LIMIT, 0, fList.addNumbers({ limit })); IRenderSVG::strokeMiterLimit(limit); }
+        void strokeWidth(double w) override { fList.add(DL_STROKE_WIDTH, 0, fList.addNumbers({ w })); IRenderSVG::strokeWidth(w); }
+        using IRenderSVG::strokeWidth;
+
+        void fill(const BLVar& value) override { if (!value.isNull()) { fList.add(DL_FILL_STYLE, 0, fList.addStyle(value)); IRenderSVG::fill(value); } }
+        void fill(const BLRgba32& value) override { fill(BLVar(value)); }
+        void fillOpacity(double o) override { fList.add(DL_FILL_ALPHA, 0, fList.addNumbers({ o })); IRenderSVG::fillOpacity(o); }
+        void noFill() override { fList.add(DL_NO_FILL); IRenderSVG::noFill(); }
+
+        void stroke(const BLVar& value) override { if (!value.isNull()) { fList.add(DL_STROKE_STYLE, 0, fList.addStyle(value)); IRenderSVG::stroke(value); } }
+        void stroke(const BLRgba32& value) override { stroke(BLVar(value)); }
+        void strokeOpacity(double o) override { fList.add(DL_STROKE_ALPHA, 0, fList.addNumbers({ o })); IRenderSVG::strokeOpacity(o); }
+        void noStroke() override { fList.add(DL_NO_STROKE); IRenderSVG::noStroke(); }
+
+        void fillRule(int rule) override { setFillRule((BLFillRule)rule); }
+
+        void clip(const BLRect& bb) override { fList.add(DL_CLIP_RECT, 0, fList.addNumbers({ bb.x, bb.y, bb.w, bb.h })); IRenderSVG::clip(bb); }
+        void noClip() override { fList.add(DL_RESTORE_CLIPPING); IRenderSVG::noClip(); }
+
+        //=================================================
+        // Drawing, which is only recorded
+        //=================================================
+        void clear() override { fList.add(DL_CLEAR_ALL); }
+
+        void background(const BLRgba32& c) override
+        {
+            if (c.value == 0)
+                clear();
+            else
+                fList.add(DL_FILL_ALL, 0, fList.addStyle(BLVar(c)));
+        }
+
+        BLResult fillPath(const BLPathCore& path) override { fList.add(DL_FILL_PATH, 0, fList.addPath(path)); return BL_SUCCESS; }
+        BLResult strokePath(const BLPathCore& path) override { fList.add(DL_STROKE_PATH, 0, fList.addPath(path)); return BL_SUCCESS; }
+
+        // Simple shapes are kept as they are, anything 
+        // else is turned into a path
+        BLResult fillGeometry(BLGeometryType type, const void* data) override
+        {
+            return recordGeometry(DL_FILL_GEOMETRY, DL_FILL_PATH, type, data);
+        }
+
+        BLResult strokeGeometry(BLGeometryType type, const void* data) override
+        {
+            return recordGeometry(DL_STROKE_GEOMETRY, DL_STROKE_PATH, type, data);
+        }
+
+        void path(const BLPath& p) override { strokePath(p); }
+
+        void rect(const BLRect& geom) override
+        {
+            uint32_t idx = fList.addNumbers({ geom.x, geom.y, geom.w, geom.h });
+            fList.add(DL_FILL_RECT, 0, idx);
+            fList.add(DL_STROKE_RECT, 0, idx);
+        }
+
+        BLResult blitImage(const BLRect& dst, const BLImageCore& src) override
+        {
+            BLSize sz = src.dcast().size();
+            return blitImage(dst, src, BLRectI(0, 0, sz.w, sz.h));
+        }
+
+        BLResult blitImage(const BLRect& dst, const BLImageCore& src, const BLRectI& srcArea) override
+        {
+            uint32_t nums = fList.addNumbers({ dst.x, dst.y, dst.w, dst.h, (double)srcArea.x, (double)srcArea.y, (double)srcArea.w, (double)srcArea.h });
+            fList.add(DL_BLIT_IMAGE, 0, fList.addImage(src), nums);
+            return BL_SUCCESS;
+        }
+
+        BLResult fillMask(const BLPoint& origin, const BLImage& mask) override
+        {
+            fList.add(DL_FILL_MASK, 0, fList.addImage(mask), fList.addNumbers({ origin.x, origin.y }));
+            return BL_SUCCESS;
+        }
+
+        void image(const BLImageCore& img, int x, int y) override
+        {
+            BLSize sz = img.dcast().size();
+            blitImage(BLRect(x, y, sz.w, sz.h), img, BLRectI(0, 0, sz.w, sz.h));
+        }
+
+        void scaleImage(const BLImageCore& src,
+            int srcX, int srcY, int srcWidth, int srcHeight,
+            double dstX, double dstY, double dstWidth, double dstHeight) override
+        {
+            blitImage(BLRect(dstX, dstY, dstWidth, dstHeight), src, BLRectI(srcX, srcY, srcWidth, srcHeight));
+        }
+
+        using IRenderSVG::text;
+
+        void text(const ByteSpan& txt, double x, double y) override
+        {
+            recordText((const char*)txt.data(), txt.size(), x, y);
+        }
+
+        void text(const char* txt, double x, double y) override
+        {
+            recordText(txt, strlen(txt), x, y);
+        }
+
+    private:
+        BLResult recordGeometry(DisplayListOp geometryOp, DisplayListOp pathOp, BLGeometryType type, const void* data)
+        {
+            if (SVGDisplayList::geometryDoubles(type) > 0)
+            {
+                fList.add(geometryOp, (uint8_t)type, fList.addGeometry(type, data));
+                return BL_SUCCESS;
+            }
+
+            BLPath apath{};
+            BLResult res = apath.addGeometry(type, data);
+            if (res != BL_SUCCESS)
+                return res;
+
+            fList.add(pathOp, 0, fList.addPath(apath));
+            return BL_SUCCESS;
+        }
+
+        void recordText(const char* txt, size_t len, double x, double y)
+        {
+            // Only record the font when it changes
+            if (!fHaveFont || !(fFont == fLastFont))
+            {
+                fLastFont = fFont;
+                fHaveFont = true;
+                fList.add(DL_FONT, 0, fList.addFont(fFont));
+            }
+
+            uint32_t textIdx = fList.addText(txt, len);
+            uint32_t pos = fList.addNumbers({ x, y });
+
+            // Same order as IRenderSVG
+            fList.add(DL_STROKE_TEXT, 0, textIdx, pos);
+            fList.add(DL_FILL_TEXT, 0, textIdx, pos);
+
+            fTextX += fTextAdvance;
+        }
+    };
+}
@@ -36,6 +36,7 @@
 #include "svgfilter.h"
 #include "svgcss.h"
 #include "svgdrawingcontext.h"
+#include "arena.h"
 
 
 
@@ -44,7 +45,18 @@ namespace waavs {
     //
     struct SVGDocument : public  SVGGraphicsElement, public IAmGroot
     {
+        // The document holds ByteSpans that point into the source
+        // so the source memory must live as long as the document does.
+        // Either we make a copy in fSourceMem, or we share ownership of
+        // memory someone else has already got, through fSourceOwner
         MemBuff fSourceMem{};
+        std::shared_ptr<const void> fSourceOwner{ nullptr };
+
+        // The nodes and properties created while loading the document
+        // are allocated from this arena.  It is released, in blocks, once
+        // the last of those objects goes away.
+        std::shared_ptr<MonotonicArena> fArena{ nullptr };
+        bool fUseArena{ true };
         
 		FontHandler* fFontHandler = nullptr;
         
@@ -68,6 +80,25 @@ namespace waavs {
         
         std::unordered_map<ByteSpan, std::shared_ptr<SVGViewable>, ByteSpanHash> fDefinitions{};
         std::unordered_map<ByteSpan, ByteSpan, ByteSpanHash> fEntities{};
+
+        // Paths parsed while loading, shared by nodes with the same path data
+        SVGPathCache fPathCache{};
+
+        // Live changes to nodes, once the document is loaded.  For each
+        // node that changed, where it used to paint, so that only those
+        // parts need to be redrawn.
+        struct DirtyNode {
+            SVGVisualNode* fNode{ nullptr };
+            BLBox fOldBounds{};
+            bool fHasOldBounds{ false };
+        };
+
+        static constexpr size_t kMaxDamageRects = 16;
+
+        bool fTrackChanges{ false };
+        std::vector<DirtyNode> fDirtyNodes{};
+        uint64_t fChangeCount{ 0 };
+        uint64_t fSharedChangeCount{ 0 };
         
         
         //==========================================
@@ -102,6 +133,287 @@ namespace waavs {
         // retrieve root svg node
 		std::shared_ptr<SVGSVGElement> documentElement() const { return fSVGNode; }
         
+        // Whether the object graph is allocated from an arena while loading
+        // This must be set before the document is loaded
+        bool useArena() const { return fUseArena; }
+        void useArena(bool use) { fUseArena = use; }
+
+        // The arena used to load the document, if any
+        // Its counters tell how many allocations loading took
+        std::shared_ptr<MonotonicArena> arena() const { return fArena; }
+
+        //=================================================================
+        // Hit testing
+        // Coordinates are in the document's user space, which is the
+        // space the document is drawn in before any transform the
+        // caller applies to the drawing context.
+        //=================================================================
+
+        // Return the topmost visible node at the point, or nullptr
+        SVGVisualNode* nodeAtPoint(double x, double y)
+        {
+            return hitTestPoint(BLPoint(x, y), BL_FILL_RULE_NON_ZERO);
+        }
+
+        // Return all the visible nodes whose bounds touch the rectangle
+        // in document order, which is bottom to top
+        std::vector<SVGVisualNode*> nodesInRect(const BLRect& r)
+        {
+            std::vector<SVGVisualNode*> found{};
+            hitTestRect(BLBox(r.x, r.y, r.x + r.w, r.y + r.h), found);
+
+            return found;
+        }
+        
+
+        //=================================================================
+        // Damage tracking
+        // After the document is loaded, setAttribute() on any of its
+        // nodes is recorded here, along with where the node painted 
+        // before the change.  drawDamage() then redraws only the parts
+        // of a surface that are affected, instead of the whole thing.
+        //=================================================================
+        bool trackingChanges() const override { return fTrackChanges; }
+        void trackChanges(bool track) { fTrackChanges = track; if (!track) forgetChanges(); }
+        uint64_t changeCount() const override { return fChangeCount; }
+        uint64_t sharedChangeCount() const override { return fSharedChangeCount; }
+
+        // Only while loading, as the cache's keys point into the source
+        SVGPathCache* pathCache() override { return fTrackChanges ? nullptr : &fPathCache; }
+
+        void nodeChanging(SVGVisualNode* node) override
+        {
+            if (nullptr == node)
+                return;
+
+            fChangeCount++;
+
+            // Count the change in the node, and every container above it,
+            // so cached layers of other groups can be kept.  If a <use> 
+            // draws something on the way up somewhere else as well, or the
+            // way up doesn't reach the document, so the node is only drawn
+            // through references, then the change counts everywhere.
+            bool shared = false;
+            const SVGVisualNode* top = node;
+            for (SVGVisualNode* p = node; p != nullptr; p = p->parentNode())
+            {
+                p->fSubtreeChanges++;
+                shared = shared || p->fReferenced;
+                top = p;
+            }
+
+            if (shared || top != this)
+                fSharedChangeCount++;
+
+            // only the bounds from before the first change matter
+            if (node->fChangePending)
+                return;
+
+            node->fChangePending = true;
+
+            DirtyNode dirty{};
+            dirty.fNode = node;
+            dirty.fHasOldBounds = node->worldBounds(dirty.fOldBounds);
+
+            fDirtyNodes.push_back(dirty);
+        }
+
+        bool hasDamage() const { return !fDirtyNodes.empty(); }
+
+        // collectDamage()
+        //
+        // Gather up the areas, in document space, that need to be redrawn
+        // because of the changes since the last time, and forget about 
+        // the changes.  Returns false if the area of some change is not
+        // known, in which case everything needs to be redrawn.
+        bool collectDamage(std::vector<BLBox>& damage)
+        {
+            bool known = true;
+
+            for (auto& dirty : fDirtyNodes)
+            {
+                BLBox newBounds{};
+                bool hasNewBounds = dirty.fNode->worldBounds(newBounds);
+
+                if (dirty.fHasOldBounds && hasNewBounds &&
+                    newBounds.x0 == dirty.fOldBounds.x0 && newBounds.y0 == dirty.fOldBounds.y0 &&
+                    newBounds.x1 == dirty.fOldBounds.x1 && newBounds.y1 == dirty.fOldBounds.y1)
+                {
+                    // Painted differently, in the same place, like a color change
+                    damage.push_back(newBounds);
+                    continue;
+                }
+
+                // The node moved, grew, or shrank, so the containers above
+                // it need to know, from the bottom up
+                for (SVGVisualNode* p = dirty.fNode->parentNode(); p != nullptr; p = p->parentNode())
+                    p->childBoundsChanged();
+
+                if (!dirty.fHasOldBounds || !hasNewBounds)
+                {
+                    known = false;
+                    continue;
+                }
+
+                damage.push_back(dirty.fOldBounds);
+                damage.push_back(newBounds);
+            }
+
+            forgetChanges();
+
+            return known;
+        }
+
+        void forgetChanges()
+        {
+            for (auto& dirty : fDirtyNodes)
+                dirty.fNode->fChangePending = false;
+
+            fDirtyNodes.clear();
+        }
+
+        // damageRects()
+        //
+        // The parts of a surface of 'surfaceSize' that need to be redrawn,
+        // in device pixels, when the document is drawn through 'view'.
+        // Overlapping areas are merged, and when there are too many, they
+        // become a single one.  Forgets about the changes.
+        std::vector<BLRectI> damageRects(const BLMatrix2D& view, const BLSizeI& surfaceSize)
+        {
+            std::vector<BLRectI> rects{};
+
+            if (!hasDamage())
+                return rects;
+
+            std::vector<BLBox> damage{};
+            if (!collectDamage(damage))
+            {
+                rects.push_back(BLRectI(0, 0, surfaceSize.w, surfaceSize.h));
+                return rects;
+            }
+
+            std::vector<BLBox> boxes{};
+            for (auto& box : damage)
+            {
+                // one more pixel all around for anti-aliasing
+                BLBox dev = boxInflate(boxTransform(box, view), 1.0);
+
+                dev.x0 = std::max(std::floor(dev.x0), 0.0);
+                dev.y0 = std::max(std::floor(dev.y0), 0.0);
+                dev.x1 = std::min(std::ceil(dev.x1), (double)surfaceSize.w);
+                dev.y1 = std::min(std::ceil(dev.y1), (double)surfaceSize.h);
+
+                if (dev.x1 <= dev.x0 || dev.y1 <= dev.y0)
+                    continue;
+
+                boxes.push_back(dev);
+            }
+
+            mergeOverlapping(boxes);
+
+            for (auto& b : boxes)
+                rects.push_back(BLRectI((int)b.x0, (int)b.y0, (int)(b.x1 - b.x0), (int)(b.y1 - b.y0)));
+
+            return rects;
+        }
+
+        // drawDamage()
+        //
+        // Redraw the parts of the surface 'ctx' is bound to that are
+        // affected by changes since the last time.  The surface must hold
+        // what was drawn before, through the same 'view'.  Each part
+        // is cleared to 'background' and drawn again, clipped to that
+        // part, and with culling limited to it.
+        // Returns the number of parts that were redrawn.
+        size_t drawDamage(IRenderSVG* ctx, const BLMatrix2D& view, const BLRgba32& background = BLRgba32(0))
+        {
+            BLSize target = ctx->targetSize();
+            auto rects = damageRects(view, BLSizeI((int)target.w, (int)target.h));
+
+            for (auto& r : rects)
+            {
+                ctx->push();
+
+                ctx->setTransform(BLMatrix2D::makeIdentity());
+                ctx->clip(BLRect(r.x, r.y, r.w, r.h));
+
+                if (background.value == 0)
+                    ctx->clearRect(r);
+                else
+                    ctx->fillRect(r, background);
+
+                ctx->setTransform(view);
+                ctx->cullingLimit(BLBox(r.x, r.y, r.x + r.w, r.y + r.h));
+
+                draw(ctx);
+
+                ctx->noCullingLimit();
+                ctx->pop();
+            }
+
+            return rects.size();
+        }
+
+    private:
+        static void mergeBox(BLBox& a, const BLBox& b)
+        {
+            a.x0 = std::min(a.x0, b.x0);
+            a.y0 = std::min(a.y0, b.y0);
+            a.x1 = std::max(a.x1, b.x1);
+            a.y1 = std::max(a.y1, b.y1);
+        }
+
+        // Merge boxes that overlap, until none do.  If that leaves too
+        // many, merge them all into one.
+        //
+        // A single pass over the boxes.  The merged ones never overlap
+        // each other, so each box only needs to be checked against them,
+        // picking up any it touches, and checking again when it grows.
+        // There are never more than kMaxDamageRects merged boxes; past
+        // that, everything becomes one.
+        static void mergeOverlapping(std::vector<BLBox>& boxes)
+        {
+            if (boxes.empty())
+                return;
+
+            BLBox all = boxes[0];
+            std::vector<BLBox> merged{};
+
+            for (auto& b : boxes)
+            {
+                mergeBox(all, b);
+
+                if (merged.size() > kMaxDamageRects)
+                    continue;
+
+                BLBox box = b;
+                size_t i = 0;
+                while (i < merged.size())
+                {
+                    if (!BoundsHierarchy::overlaps(merged[i], box))
+                    {
+                        i++;
+                        continue;
+                    }
+
+                    // the box grew, so look at all of them again
+                    mergeBox(box, merged[i]);
+                    merged[i] = merged.back();
+                    merged.pop_back();
+                    i = 0;
+                }
+
+                merged.push_back(box);
+            }
+
+            boxes.clear();
+            if (merged.size() > kMaxDamageRects)
+                boxes.push_back(all);
+            else
+                boxes = std::move(merged);
+        }
+
+    public:
 
         //=================================================================
 		// IAmGroot
@@ -260,7 +572,7 @@ namespace waavs {
                 {
                     // There should be only one root node in a document, so we should 
                     // break here, but, curiosity...
-                    auto node = std::make_shared<SVGSVGElement>(this);
+                    auto node = arena_make_shared<SVGSVGElement>(this);
                     
                     if (nullptr != node) {
                         node->loadFromXmlIterator(iter);
@@ -275,17 +587,18 @@ namespace waavs {
         //*/
         
         
-		// Assuming we've already got a file mapped into memory, load the document
-        bool loadFromChunk(const ByteSpan &srcChunk)
+        // Parse the document out of memory that is already
+        // guaranteed to outlive the document
+        bool loadFromSourceSpan(const ByteSpan& srcSpan)
         {
-            // create a memBuff from srcChunk
-            // since we use memory references, we need
-            // to keep the memory around for the duration of the 
-            // document's life
-            fSourceMem.initFromSpan(srcChunk);
+            // Everything created while loading comes out of the arena
+            if (fUseArena && (nullptr == fArena))
+                fArena = std::make_shared<MonotonicArena>();
+
+            ArenaScope scope(fUseArena ? fArena : nullptr);
             
 			// Create the XML Iterator we're going to use to parse the document
-            XmlElementIterator iter(fSourceMem.span(), true);
+            XmlElementIterator iter(srcSpan, true);
 
             loadFromXmlIterator(iter);
 			
@@ -293,10 +606,45 @@ namespace waavs {
             // This binding could happen at draw time instead
             // for maximum flexibility
             bindToGroot(this);
+
+            // The nodes hold on to the paths they share
+            fPathCache.clear();
+
+            // From here on, changes to nodes are tracked
+            fTrackChanges = true;
             
             return true;
         }
 
+		// Assuming we've already got a file mapped into memory, load the document
+        bool loadFromChunk(const ByteSpan &srcChunk)
+        {
+            // create a memBuff from srcChunk
+            // since we use memory references, we need
+            // to keep the memory around for the duration of the 
+            // document's life
+            fSourceMem.initFromSpan(srcChunk);
+            
+            return loadFromSourceSpan(fSourceMem.span());
+        }
+
+        // loadFromChunk()
+        // 
+        // Load the document without copying the source.  The 'owner' is 
+        // whatever keeps the memory of srcChunk alive, such as a MappedFile, 
+        // or a MemBuff.  The document holds onto the owner for as long 
+        // as it lives, and its ByteSpans point directly into srcChunk.
+        // If there is no owner, fall back to making a copy.
+        bool loadFromChunk(const ByteSpan& srcChunk, std::shared_ptr<const void> owner)
+        {
+            if (nullptr == owner)
+                return loadFromChunk(srcChunk);
+
+            fSourceOwner = owner;
+
+            return loadFromSourceSpan(srcChunk);
+        }
+
         // A convenience to construct the document from a chunk, and return
         // a shared pointer to the document
         static std::shared_ptr<SVGDocument> createFromChunk(const ByteSpan& srcChunk, FontHandler* fh, const double w, const double h, const double ppi)
@@ -306,6 +654,16 @@ namespace waavs {
 
             return doc;
         }
+
+        // Same as above, but without copying the source
+        // The document shares ownership of the memory with 'owner'
+        static std::shared_ptr<SVGDocument> createFromChunk(const ByteSpan& srcChunk, std::shared_ptr<const void> owner, FontHandler* fh, const double w, const double h, const double ppi)
+        {
+            auto doc = std::make_shared<SVGDocument>(fh, w, h, ppi);
+            doc->loadFromChunk(srcChunk, owner);
+
+            return doc;
+        }
         
     };
 }
@@ -0,0 +1,161 @@
+#pragma once
+
+//
+// svgelementids
+// Compact integer identifiers for the SVG element names that
+// have factories registered for them.
+//
+// The element factories are held in arrays indexed by these ids, so
+// dispatching on an element name is a single compile time perfect 
+// hash (see svgnamehash.h), followed by an array index.
+//
+// To add a new built-in element, add an id to the enum, and an entry 
+// to the gSVGElementNames table, in the same order.  Elements that
+// are not listed here can still be registered, they just go through 
+// a slower map based lookup.
+//
+
+#include <cstdint>
+
+#include "svgnamehash.h"
+
+
+namespace waavs
+{
+    enum SVG_ELEMENT_ID : uint8_t
+    {
+        SVG_ELEMENT_INVALID = 0,
+
+        SVG_ELEMENT_A,
+        SVG_ELEMENT_CIRCLE,
+        SVG_ELEMENT_CLIP_PATH,
+        SVG_ELEMENT_CONIC_GRADIENT,
+        SVG_ELEMENT_DEFS,
+        SVG_ELEMENT_DESC,
+        SVG_ELEMENT_ELLIPSE,
+        SVG_ELEMENT_FE_BLEND,
+        SVG_ELEMENT_FE_COLOR_MATRIX,
+        SVG_ELEMENT_FE_COMPONENT_TRANSFER,
+        SVG_ELEMENT_FE_COMPOSITE,
+        SVG_ELEMENT_FE_CONVOLVE_MATRIX,
+        SVG_ELEMENT_FE_DIFFUSE_LIGHTING,
+        SVG_ELEMENT_FE_DISPLACEMENT_MAP,
+        SVG_ELEMENT_FE_DISTANT_LIGHT,
+        SVG_ELEMENT_FE_FLOOD,
+        SVG_ELEMENT_FE_GAUSSIAN_BLUR,
+        SVG_ELEMENT_FE_OFFSET,
+        SVG_ELEMENT_FE_TURBULENCE,
+        SVG_ELEMENT_FILTER,
+        SVG_ELEMENT_FONT,
+        SVG_ELEMENT_FONT_FACE,
+        SVG_ELEMENT_FONT_FACE_NAME,
+        SVG_ELEMENT_FONT_FACE_SRC,
+        SVG_ELEMENT_FOREIGN_OBJECT,
+        SVG_ELEMENT_G,
+        SVG_ELEMENT_GLYPH,
+        SVG_ELEMENT_IMAGE,
+        SVG_ELEMENT_LINE,
+        SVG_ELEMENT_LINEAR_GRADIENT,
+        SVG_ELEMENT_MARKER,
+        SVG_ELEMENT_MASK,
+        SVG_ELEMENT_MISSING_GLYPH,
+        SVG_ELEMENT_PATH,
+        SVG_ELEMENT_PATTERN,
+        SVG_ELEMENT_POLYGON,
+        SVG_ELEMENT_POLYLINE,
+        SVG_ELEMENT_RADIAL_GRADIENT,
+        SVG_ELEMENT_RECT,
+        SVG_ELEMENT_SCRIPT,
+        SVG_ELEMENT_SOLID_COLOR,
+        SVG_ELEMENT_STYLE,
+        SVG_ELEMENT_SVG,
+        SVG_ELEMENT_SWITCH,
+        SVG_ELEMENT_SYMBOL,
+        SVG_ELEMENT_TEXT,
+        SVG_ELEMENT_TITLE,
+        SVG_ELEMENT_TSPAN,
+        SVG_ELEMENT_USE,
+
+        SVG_ELEMENT_COUNT
+    };
+
+    static constexpr SVGNameEntry gSVGElementNames[] = {
+        { "a", SVG_ELEMENT_A },
+        { "circle", SVG_ELEMENT_CIRCLE },
+        { "clipPath", SVG_ELEMENT_CLIP_PATH },
+        { "conicGradient", SVG_ELEMENT_CONIC_GRADIENT },
+        { "defs", SVG_ELEMENT_DEFS },
+        { "desc", SVG_ELEMENT_DESC },
+        { "ellipse", SVG_ELEMENT_ELLIPSE },
+        { "feBlend", SVG_ELEMENT_FE_BLEND },
+        { "feColorMatrix", SVG_ELEMENT_FE_COLOR_MATRIX },
+        { "feComponentTransfer", SVG_ELEMENT_FE_COMPONENT_TRANSFER },
+        { "feComposite", SVG_ELEMENT_FE_COMPOSITE },
+        { "feConvolveMatrix", SVG_ELEMENT_FE_CONVOLVE_MATRIX },
+        { "feDiffuseLighting", SVG_ELEMENT_FE_DIFFUSE_LIGHTING },
+        { "feDisplacementMap", SVG_ELEMENT_FE_DISPLACEMENT_MAP },
+        { "feDistantLight", SVG_ELEMENT_FE_DISTANT_LIGHT },
+        { "feFlood", SVG_ELEMENT_FE_FLOOD },
+        { "feGaussianBlur", SVG_ELEMENT_FE_GAUSSIAN_BLUR },
+        { "feOffset", SVG_ELEMENT_FE_OFFSET },
+        { "feTurbulence", SVG_ELEMENT_FE_TURBULENCE },
+        { "filter", SVG_ELEMENT_FILTER },
+        { "font", SVG_ELEMENT_FONT },
+        { "font-face", SVG_ELEMENT_FONT_FACE },
+        { "font-face-name", SVG_ELEMENT_FONT_FACE_NAME },
+        { "font-face-src", SVG_ELEMENT_FONT_FACE_SRC },
+        { "foreignObject", SVG_ELEMENT_FOREIGN_OBJECT },
+        { "g", SVG_ELEMENT_G },
+        { "glyph", SVG_ELEMENT_GLYPH },
+        { "image", SVG_ELEMENT_IMAGE },
+        { "line", SVG_ELEMENT_LINE },
+        { "linearGradient", SVG_ELEMENT_LINEAR_GRADIENT },
+        { "marker", SVG_ELEMENT_MARKER },
+        { "mask", SVG_ELEMENT_MASK },
+        { "missing-glyph", SVG_ELEMENT_MISSING_GLYPH },
+        { "path", SVG_ELEMENT_PATH },
+        { "pattern", SVG_ELEMENT_PATTERN },
+        { "polygon", SVG_ELEMENT_POLYGON },
+        { "polyline", SVG_ELEMENT_POLYLINE },
+        { "radialGradient", SVG_ELEMENT_RADIAL_GRADIENT },
+        { "rect", SVG_ELEMENT_RECT },
+        { "script", SVG_ELEMENT_SCRIPT },
+        { "solidColor", SVG_ELEMENT_SOLID_COLOR },
+        { "style", SVG_ELEMENT_STYLE },
+        { "svg", SVG_ELEMENT_SVG },
+        { "switch", SVG_ELEMENT_SWITCH },
+        { "symbol", SVG_ELEMENT_SYMBOL },
+        { "text", SVG_ELEMENT_TEXT },
+        { "title", SVG_ELEMENT_TITLE },
+        { "tspan", SVG_ELEMENT_TSPAN },
+        { "use", SVG_ELEMENT_USE },
+    };
+
+    static_assert(sizeof(gSVGElementNames) / sizeof(gSVGElementNames[0]) == SVG_ELEMENT_COUNT - 1, "every SVG_ELEMENT_ID needs a name");
+    static_assert(svg_names_in_order(gSVGElementNames), "gSVGElementNames must be in SVG_ELEMENT_ID order");
+
+    static constexpr SVGNameTable<256> gSVGElementTable = svg_name_build_table<256>(gSVGElementNames);
+    static_assert(svg_name_seed_is_perfect<256>(gSVGElementNames, gSVGElementTable.fSeed), "no perfect hash seed for SVG element names");
+
+
+    //
+    // svgElementId()
+    //
+    // Turn an element name into its id.  Returns SVG_ELEMENT_INVALID
+    // if the name is not one of the known elements.
+    //
+    static inline SVG_ELEMENT_ID svgElementId(const ByteSpan& name) noexcept
+    {
+        return (SVG_ELEMENT_ID)svg_name_lookup(gSVGElementNames, gSVGElementTable, name);
+    }
+
+    // svgElementName()
+    // Return the name associated with an element id
+    static inline ByteSpan svgElementName(SVG_ELEMENT_ID id) noexcept
+    {
+        if ((id == SVG_ELEMENT_INVALID) || (id >= SVG_ELEMENT_COUNT))
+            return {};
+
+        return ByteSpan(gSVGElementNames[id - 1].fName);
+    }
+}
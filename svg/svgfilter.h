@@ -52,7 +52,7 @@ namespace waavs {
 		static void registerSingularNode()
 		{
 			gShapeCreationMap["filter"] = [](IAmGroot* aroot, const XmlElement& elem) {
-				auto node = std::make_shared<SVGFilterElement>(aroot);
+				auto node = arena_make_shared<SVGFilterElement>(aroot);
 				node->loadFromXmlElement(elem);
 
 				return node;
@@ -62,7 +62,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["filter"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGFilterElement>(aroot);
+				auto node = arena_make_shared<SVGFilterElement>(aroot);
 				node->loadFromXmlIterator(iter);
 				
 				return node;
@@ -139,7 +139,7 @@ namespace waavs {
 		static void registerSingularNode()
 		{
 			gShapeCreationMap["feBlend"] = [](IAmGroot* aroot, const XmlElement& elem) {
-				auto node = std::make_shared<SVGFeBlendElement>(aroot);
+				auto node = arena_make_shared<SVGFeBlendElement>(aroot);
 				node->loadFromXmlElement(elem);
 
 				return node;
@@ -149,7 +149,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["feBlend"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGFeBlendElement>(aroot);
+				auto node = arena_make_shared<SVGFeBlendElement>(aroot);
 				node->loadFromXmlIterator(iter);
 				node->visible(false);
 				return node;
@@ -175,7 +175,7 @@ namespace waavs {
 		static void registerSingularNode()
 		{
 			gShapeCreationMap["feComponentTransfer"] = [](IAmGroot* aroot, const XmlElement& elem) {
-				auto node = std::make_shared<SVGFeComponentTransferElement>(aroot);
+				auto node = arena_make_shared<SVGFeComponentTransferElement>(aroot);
 				node->loadFromXmlElement(elem);
 
 				return node;
@@ -185,7 +185,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["feComponentTransfer"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGFeComponentTransferElement>(aroot);
+				auto node = arena_make_shared<SVGFeComponentTransferElement>(aroot);
 				node->loadFromXmlIterator(iter);
 				return node;
 				};
@@ -212,7 +212,7 @@ namespace waavs {
 		static void registerSingularNode()
 		{
 			gShapeCreationMap["feComposite"] = [](IAmGroot* aroot, const XmlElement& elem) {
-				auto node = std::make_shared<SVGFeCompositeElement>(aroot);
+				auto node = arena_make_shared<SVGFeCompositeElement>(aroot);
 				node->loadFromXmlElement(elem);
 				
 				return node;
@@ -222,7 +222,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["feComposite"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGFeCompositeElement>(aroot);
+				auto node = arena_make_shared<SVGFeCompositeElement>(aroot);
 				node->loadFromXmlIterator(iter);
 				return node;
 			};
@@ -248,7 +248,7 @@ namespace waavs {
 		static void registerSingularNode()
 		{
 			gShapeCreationMap["feColorMatrix"] = [](IAmGroot* aroot, const XmlElement& elem) {
-				auto node = std::make_shared<SVGFeColorMatrixElement>(aroot);
+				auto node = arena_make_shared<SVGFeColorMatrixElement>(aroot);
 				node->loadFromXmlElement(elem);
 				
 				return node;
@@ -258,7 +258,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["feColorMatrix"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGFeColorMatrixElement>(aroot);
+				auto node = arena_make_shared<SVGFeColorMatrixElement>(aroot);
 				node->loadFromXmlIterator(iter);
 				return node;
 			};
@@ -283,7 +283,7 @@ namespace waavs {
 		static void registerSingularNode()
 		{
 			gShapeCreationMap["feConvolveMatrix"] = [](IAmGroot* aroot, const XmlElement& elem) {
-				auto node = std::make_shared<SVGFeConvolveMatrixElement>(aroot);
+				auto node = arena_make_shared<SVGFeConvolveMatrixElement>(aroot);
 				node->loadFromXmlElement(elem);
 
 				return node;
@@ -293,7 +293,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["feConvolveMatrix"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGFeConvolveMatrixElement>(aroot);
+				auto node = arena_make_shared<SVGFeConvolveMatrixElement>(aroot);
 				node->loadFromXmlIterator(iter);
 				return node;
 				};
@@ -319,7 +319,7 @@ namespace waavs {
 		static void registerSingularNode()
 		{
 			gShapeCreationMap["feDiffuseLighting"] = [](IAmGroot* aroot, const XmlElement& elem) {
-				auto node = std::make_shared<SVGFeDiffuseLightingElement>(aroot);
+				auto node = arena_make_shared<SVGFeDiffuseLightingElement>(aroot);
 				node->loadFromXmlElement(elem);
 
 				return node;
@@ -329,7 +329,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["feDiffuseLighting"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGFeDiffuseLightingElement>(aroot);
+				auto node = arena_make_shared<SVGFeDiffuseLightingElement>(aroot);
 				node->loadFromXmlIterator(iter);
 				return node;
 				};
@@ -355,7 +355,7 @@ namespace waavs {
 		static void registerSingularNode()
 		{
 			gShapeCreationMap["feDisplacementMap"] = [](IAmGroot* aroot, const XmlElement& elem) {
-				auto node = std::make_shared<SVGFeDisplacementMapElement>(aroot);
+				auto node = arena_make_shared<SVGFeDisplacementMapElement>(aroot);
 				node->loadFromXmlElement(elem);
 
 				return node;
@@ -365,7 +365,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["feDisplacementMap"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGFeDisplacementMapElement>(aroot);
+				auto node = arena_make_shared<SVGFeDisplacementMapElement>(aroot);
 				node->loadFromXmlIterator(iter);
 				return node;
 				};
@@ -390,7 +390,7 @@ namespace waavs {
 		static void registerSingularNode()
 		{
 			gShapeCreationMap["feDistantLight"] = [](IAmGroot* aroot, const XmlElement& elem) {
-				auto node = std::make_shared<SVGFeDistantLightElement>(aroot);
+				auto node = arena_make_shared<SVGFeDistantLightElement>(aroot);
 				node->loadFromXmlElement(elem);
 
 				return node;
@@ -400,7 +400,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["feDistantLight"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGFeDistantLightElement>(aroot);
+				auto node = arena_make_shared<SVGFeDistantLightElement>(aroot);
 				node->loadFromXmlIterator(iter);
 				return node;
 				};
@@ -425,7 +425,7 @@ namespace waavs {
 		static void registerSingularNode()
 		{
 			gShapeCreationMap["feFlood"] = [](IAmGroot* aroot, const XmlElement& elem) {
-				auto node = std::make_shared<SVGFeFloodElement>(aroot);
+				auto node = arena_make_shared<SVGFeFloodElement>(aroot);
 				node->loadFromXmlElement(elem);
 
 				return node;
@@ -435,7 +435,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["feFlood"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGFeFloodElement>(aroot);
+				auto node = arena_make_shared<SVGFeFloodElement>(aroot);
 				node->loadFromXmlIterator(iter);
 				node->visible(false);
 				return node;
@@ -462,7 +462,7 @@ namespace waavs {
 		static void registerSingularNode()
 		{
 			gShapeCreationMap["feGaussianBlur"] = [](IAmGroot* aroot, const XmlElement& elem) {
-				auto node = std::make_shared<SVGFeGaussianBlurElement>(aroot);
+				auto node = arena_make_shared<SVGFeGaussianBlurElement>(aroot);
 				node->loadFromXmlElement(elem);
 				
 				return node;
@@ -472,7 +472,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["feGaussianBlur"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGFeGaussianBlurElement>(aroot);
+				auto node = arena_make_shared<SVGFeGaussianBlurElement>(aroot);
 				node->loadFromXmlIterator(iter);
 				node->visible(false);
 				return node;
@@ -507,7 +507,7 @@ namespace waavs {
 		static void registerSingularNode()
 		{
 			gShapeCreationMap["feOffset"] = [](IAmGroot* aroot, const XmlElement& elem) {
-				auto node = std::make_shared<SVGFeOffsetElement>(aroot);
+				auto node = arena_make_shared<SVGFeOffsetElement>(aroot);
 				node->loadFromXmlElement(elem);
 
 				return node;
@@ -517,7 +517,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["feOffset"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGFeOffsetElement>(aroot);
+				auto node = arena_make_shared<SVGFeOffsetElement>(aroot);
 				node->loadFromXmlIterator(iter);
 				node->visible(false);
 				return node;
@@ -544,7 +544,7 @@ namespace waavs {
 		static void registerSingularNode()
 		{
 			gShapeCreationMap["feTurbulence"] = [](IAmGroot* aroot, const XmlElement& elem) {
-				auto node = std::make_shared<SVGFeTurbulenceElement>(aroot);
+				auto node = arena_make_shared<SVGFeTurbulenceElement>(aroot);
 				node->loadFromXmlElement(elem);
 
 				return node;
@@ -554,7 +554,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["feTurbulence"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGFeTurbulenceElement>(aroot);
+				auto node = arena_make_shared<SVGFeTurbulenceElement>(aroot);
 				node->loadFromXmlIterator(iter);
 				return node;
 			};
@@ -40,7 +40,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["font"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGFontNode>(aroot);
+				auto node = arena_make_shared<SVGFontNode>(aroot);
 				node->loadFromXmlIterator(iter);
 				node->visible(false);
 
@@ -104,7 +104,7 @@ namespace waavs {
 		static void registerSingularNode()
 		{
 			gShapeCreationMap["font-face"] = [](IAmGroot* aroot, const XmlElement& elem) {
-				auto node = std::make_shared<SVGFontFaceNode>(aroot);
+				auto node = arena_make_shared<SVGFontFaceNode>(aroot);
 				node->loadFromXmlElement(elem);
 				node->visible(false);
 
@@ -115,7 +115,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["font-face"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGFontFaceNode>(aroot);
+				auto node = arena_make_shared<SVGFontFaceNode>(aroot);
 				node->loadFromXmlIterator(iter);
 				node->visible(false);
 
@@ -188,7 +188,7 @@ namespace waavs {
 		static void registerSingularNode()
 		{
 			gShapeCreationMap["missing-glyph"] = [](IAmGroot* aroot, const XmlElement& elem) {
-				auto node = std::make_shared<SVGMissingGlyphNode>(aroot);
+				auto node = arena_make_shared<SVGMissingGlyphNode>(aroot);
 				node->loadFromXmlElement(elem);
 
 				return node;
@@ -198,7 +198,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["missing-glyph"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGMissingGlyphNode>(aroot);
+				auto node = arena_make_shared<SVGMissingGlyphNode>(aroot);
 				node->loadFromXmlIterator(iter);
 
 				return node;
@@ -256,7 +256,7 @@ namespace waavs {
 	{
 		static void registerFactory() {
 			gShapeCreationMap["glyph"] = [](IAmGroot* root, const XmlElement& elem) {
-				auto node = std::make_shared<SVGGlyphNode>(root);
+				auto node = arena_make_shared<SVGGlyphNode>(root);
 				node->loadFromXmlElement(elem);
 				return node;
 			};
@@ -301,8 +301,7 @@ namespace waavs {
 			if (!d)
 				return;
 
-			auto success = blpathparser::parsePath(d, fPath);
-			fPath.shrink();
+			auto success = loadPathData(d);
 
 			needsBinding(false);
 		}
@@ -318,7 +317,7 @@ namespace waavs {
 		static void registerSingularNode()
 		{
 			gShapeCreationMap["font-face-src"] = [](IAmGroot* aroot, const XmlElement& elem) {
-				auto node = std::make_shared<SVGFontFaceSrcNode>(aroot);
+				auto node = arena_make_shared<SVGFontFaceSrcNode>(aroot);
 				node->loadFromXmlElement(elem);
 
 				return node;
@@ -328,7 +327,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["font-face-src"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGFontFaceSrcNode>(aroot);
+				auto node = arena_make_shared<SVGFontFaceSrcNode>(aroot);
 				node->loadFromXmlIterator(iter);
 
 				return node;
@@ -349,7 +348,7 @@ namespace waavs {
 	{
 		static void registerFactory() {
 			gShapeCreationMap["font-face-name"] = [](IAmGroot* root, const XmlElement& elem) {
-				auto node = std::make_shared<SVGFontFaceNameNode>(root);
+				auto node = arena_make_shared<SVGFontFaceNameNode>(root);
 				node->loadFromXmlElement(elem);
 				return node;
 			};
@@ -0,0 +1,221 @@
+#pragma once
+
+//
+// svglayercache
+// Offscreen layers for groups that are drawn with opacity.
+//
+// Opacity on a group applies to the group as a whole, so where its
+// children overlap, only the top one should show through.  To get that
+// right, the children are drawn into a layer of their own, and the
+// layer is then drawn with the opacity.
+//
+// Drawing the layer over again for every frame is expensive, so it is
+// kept around.  It is rendered at the resolution of the device, that is
+// with as many pixels per unit as the transform it is drawn with, and
+// only rendered again when that scale changes by enough to matter, or
+// something inside the group changes.
+//
+// Scales are rounded to steps of kStepOctaves, and a layer is kept
+// as long as the scale it is drawn at is within kHysteresisOctaves of
+// the scale it was rendered at.  Since that's a bit more than half a
+// step, zooming back and forth across the edge of a step does not
+// render the layer again every frame.
+//
+// All layers share one memory budget.  When a layer won't fit, those
+// that were used least recently are released to make room.  If it
+// still won't fit, the group is drawn without a cached layer.
+//
+// The images come from the SurfacePool, so they are a size class 
+// bigger than what the layer needs.  A layer that is rendered again
+// hands its old image back to the pool.
+//
+
+#include <cmath>
+#include <list>
+#include <mutex>
+
+#include "blend2d.h"
+#include "svgsurfacepool.h"
+
+
+namespace waavs
+{
+    //================================================
+    // SVGLayer
+    // The cached layer of one group
+    //================================================
+    struct SVGLayer
+    {
+        // Held while the layer is rendered or drawn, as the
+        // same group can be drawn from several threads
+        std::mutex fLock{};
+
+        BLImage fImage{};
+        BLSizeI fPixels{};              // the part of fImage that is used
+        BLBox fArea{};                  // what the image covers, in the coordinates of the group's children
+        double fScale{ 0 };             // pixels per unit it was rendered at
+        uint64_t fChangeCount{ 0 };     // of the group's subtree, and shared changes, when it was rendered
+
+        // The inherited paint it was rendered with, and
+        // the key of the rest of the inherited style
+        BLVar fFillStyle{};
+        BLVar fStrokeStyle{};
+        uint64_t fStyleKey{ 0 };
+
+        // Maintained by the SVGLayerCache
+        size_t fBytes{ 0 };
+        bool fInCache{ false };
+        std::list<SVGLayer*>::iterator fLRUPos{};
+    };
+
+
+    //================================================
+    // SVGLayerCache
+    // The memory budget, and use order, of all the layers
+    //================================================
+    struct SVGLayerCache
+    {
+        static constexpr double kStepOctaves = 0.5;
+        static constexpr double kHysteresisOctaves = 0.35;
+
+        // Layers bigger than this, on a side, are not kept
+        static constexpr int kMaxLayerSize = 4096;
+
+        std::mutex fLock{};
+        std::list<SVGLayer*> fLRU{};            // most recently used at the front
+        size_t fBudgetBytes{ 64 * 1024 * 1024 };
+        size_t fBytesUsed{ 0 };
+
+        // Some statistics
+        size_t fHits{ 0 };
+        size_t fRenders{ 0 };
+        size_t fEvictions{ 0 };
+        size_t fOverBudget{ 0 };
+
+
+        // The one cache shared by all documents.  It is never destroyed,
+        // so nodes that outlive everything else can still release into it.
+        static SVGLayerCache& global()
+        {
+            static SVGLayerCache* gLayerCache = new SVGLayerCache();
+            return *gLayerCache;
+        }
+
+        size_t bytesUsed() { std::lock_guard<std::mutex> lk(fLock); return fBytesUsed; }
+        size_t budget() const { return fBudgetBytes; }
+        void budget(size_t bytes)
+        {
+            std::lock_guard<std::mutex> lk(fLock);
+            fBudgetBytes = bytes;
+            evictOverBudget(nullptr, 0);
+        }
+
+        // bucketScale()
+        // The scale a layer should be rendered at, to be drawn at 'scale'
+        static double bucketScale(double scale)
+        {
+            return std::exp2(std::round(std::log2(scale) / kStepOctaves) * kStepOctaves);
+        }
+
+        // scaleFits()
+        // Whether a layer rendered at 'layerScale' is still
+        // good enough to be drawn at 'scale'
+        static bool scaleFits(double layerScale, double scale)
+        {
+            if (layerScale <= 0 || scale <= 0)
+                return false;
+
+            return std::abs(std::log2(scale / layerScale)) <= kHysteresisOctaves;
+        }
+
+        // The caller holds the lock of 'layer' for all of the following
+
+        // touch()
+        // The layer is being drawn as it is
+        void touch(SVGLayer& layer)
+        {
+            std::lock_guard<std::mutex> lk(fLock);
+
+            fHits++;
+            if (layer.fInCache)
+                fLRU.splice(fLRU.begin(), fLRU, layer.fLRUPos);
+        }
+
+        // reserve()
+        // Make room for the layer to be rendered again with an image
+        // of 'bytes', handing its current image back to the pool.
+        // Returns false if there isn't room, even after releasing the 
+        // other layers, in which case the layer is released.
+        bool reserve(SVGLayer& layer, size_t bytes)
+        {
+            std::lock_guard<std::mutex> lk(fLock);
+
+            forget(layer);
+
+            if (bytes > fBudgetBytes || !evictOverBudget(&layer, bytes))
+            {
+                fOverBudget++;
+                return false;
+            }
+
+            fRenders++;
+            fBytesUsed += bytes;
+            layer.fBytes = bytes;
+            layer.fInCache = true;
+            fLRU.push_front(&layer);
+            layer.fLRUPos = fLRU.begin();
+
+            return true;
+        }
+
+        // release()
+        // Let go of the layer's image, and stop keeping track of it
+        void release(SVGLayer& layer)
+        {
+            std::lock_guard<std::mutex> lk(fLock);
+            forget(layer);
+        }
+
+    private:
+        // Both of these are called with fLock held
+        void forget(SVGLayer& layer)
+        {
+            if (layer.fInCache)
+            {
+                fLRU.erase(layer.fLRUPos);
+                fBytesUsed -= layer.fBytes;
+            }
+
+            SurfacePool::global().recycle(layer.fImage);
+            layer.fBytes = 0;
+            layer.fInCache = false;
+        }
+
+        // Release the least recently used layers, other than 'keep',
+        // until 'bytes' more will fit.  A layer that is busy in another
+        // thread is left alone.
+        bool evictOverBudget(SVGLayer* keep, size_t bytes)
+        {
+            auto it = fLRU.end();
+            while (fBytesUsed + bytes > fBudgetBytes && it != fLRU.begin())
+            {
+                --it;
+
+                SVGLayer* victim = *it;
+                if (victim == keep || !victim->fLock.try_lock())
+                    continue;
+
+                it = fLRU.erase(it);
+                fBytesUsed -= victim->fBytes;
+                fEvictions++;
+
+                SurfacePool::global().discard(victim->fImage);
+                victim->fBytes = 0;
+                victim->fInCache = false;
+                victim->fLock.unlock();
+            }
+
+            return fBytesUsed + bytes <= fBudgetBytes;
+        }
+    };
+}
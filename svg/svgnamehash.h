@@ -0,0 +1,148 @@
+#pragma once
+
+//
+// svgnamehash
+// Compile time perfect hashing of a fixed set of names.
+//
+// Given a constexpr table of names, each with a small integer id, a 
+// seed for the hash function is searched for, at compile time, that 
+// places every name into its own slot of a power of 2 sized table.
+// Looking up a name at runtime is then one hash, one table index,
+// and one compare to confirm the name is really the one in the slot.
+//
+// This is used to turn the known SVG property and element names into
+// compact ids, so the rest of the code can index arrays instead of
+// hashing strings into maps.
+//
+
+#include <cstdint>
+#include <cstring>
+
+#include "bspan.h"
+
+
+namespace waavs
+{
+    static constexpr size_t svg_cstrlen(const char* s) noexcept
+    {
+        size_t len = 0;
+        while (s[len] != 0)
+            len++;
+        return len;
+    }
+
+    // A seeded fnv-1a hash, usable both at compile time,
+    // and at runtime on the bytes of a ByteSpan
+    template <typename T>
+    static constexpr uint32_t svg_name_hash(const T* s, size_t len, uint32_t seed) noexcept
+    {
+        uint32_t h = 2166136261u ^ seed;
+        for (size_t i = 0; i < len; i++)
+        {
+            h ^= (uint8_t)s[i];
+            h *= 16777619u;
+        }
+
+        // The low bits of fnv-1a only depend on the low bits of 
+        // the seed, so mix the high bits down before they're used
+        // to index a small table
+        h ^= h >> 16;
+        h *= 0x85ebca6bu;
+        h ^= h >> 13;
+
+        return h;
+    }
+
+    struct SVGNameEntry
+    {
+        const char* fName;
+        size_t fLength;
+        uint8_t fId;
+
+        constexpr SVGNameEntry(const char* name, uint8_t id)
+            : fName(name), fLength(svg_cstrlen(name)), fId(id) {}
+    };
+
+    // The lookup table.  Each slot holds an index+1 into
+    // the names table, or 0 if the slot is empty
+    template <size_t TableSize>
+    struct SVGNameTable
+    {
+        static_assert((TableSize & (TableSize - 1)) == 0, "SVGNameTable size must be a power of 2");
+
+        uint32_t fSeed{ 0 };
+        uint8_t fSlots[TableSize]{};
+    };
+
+    // The names must be in the same order as their ids, which
+    // start at 1, so an id can be turned back into a name by indexing
+    template <size_t N>
+    static constexpr bool svg_names_in_order(const SVGNameEntry(&names)[N]) noexcept
+    {
+        for (size_t i = 0; i < N; i++)
+        {
+            if (names[i].fId != i + 1)
+                return false;
+        }
+        return true;
+    }
+
+    // Check whether a seed puts every name into its own slot
+    template <size_t TableSize, size_t N>
+    static constexpr bool svg_name_seed_is_perfect(const SVGNameEntry(&names)[N], uint32_t seed) noexcept
+    {
+        bool used[TableSize]{};
+        for (size_t i = 0; i < N; i++)
+        {
+            size_t slot = svg_name_hash(names[i].fName, names[i].fLength, seed) & (TableSize - 1);
+            if (used[slot])
+                return false;
+            used[slot] = true;
+        }
+        return true;
+    }
+
+    // Search for a seed that gives a perfect hash, and fill
+    // in the slots of the table using it.  If no seed is found
+    // fSeed is left as 0, and the static_assert at the point of
+    // use will catch it.
+    template <size_t TableSize, size_t N>
+    static constexpr SVGNameTable<TableSize> svg_name_build_table(const SVGNameEntry(&names)[N]) noexcept
+    {
+        SVGNameTable<TableSize> table{};
+
+        for (uint32_t seed = 0; seed < 10000; seed++)
+        {
+            if (svg_name_seed_is_perfect<TableSize>(names, seed))
+            {
+                table.fSeed = seed;
+                break;
+            }
+        }
+
+        for (size_t i = 0; i < N; i++)
+        {
+            size_t slot = svg_name_hash(names[i].fName, names[i].fLength, table.fSeed) & (TableSize - 1);
+            table.fSlots[slot] = (uint8_t)(i + 1);
+        }
+
+        return table;
+    }
+
+    // Return the id of the name, or 0 if it's not in the table
+    template <size_t TableSize, size_t N>
+    static inline uint8_t svg_name_lookup(const SVGNameEntry(&names)[N], const SVGNameTable<TableSize>& table, const ByteSpan& name) noexcept
+    {
+        size_t len = name.size();
+        uint32_t h = svg_name_hash(name.fStart, len, table.fSeed);
+        uint8_t idx = table.fSlots[h & (TableSize - 1)];
+        if (idx == 0)
+            return 0;
+
+        const SVGNameEntry& entry = names[idx - 1];
+        if ((entry.fLength != len) || (memcmp(entry.fName, name.fStart, len) != 0))
+            return 0;
+
+        return entry.fId;
+    }
+}
@@ -13,8 +13,6 @@
 //	waavs::blpathparser::parsePath(span, path);
 //
 
-#include <map>
-#include <functional>
 #include <cstdint>
 
 #include "blend2d.h"
@@ -26,33 +24,6 @@
 // uncomment the following to print diagnostics
 //#define PATH_COMMAND_DEBUG 1
 
-/*
-// Old reference
-// A dispatch std::map that matches the command character to the
-		// appropriate parse function
-		static std::map<SegmentCommand, std::function<bool(ByteSpan&, BLPath&, int&)>> parseMap = {
-			{SegmentCommand::MoveTo, parseMoveTo},				// M
-			{SegmentCommand::MoveBy, parseMoveBy},				// m
-			{SegmentCommand::LineTo, parseLineTo},				// L
-			{SegmentCommand::LineBy, parseLineBy},				// l
-			{SegmentCommand::HLineTo, parseHLineTo},			// H
-			{SegmentCommand::HLineBy, parseHLineBy},			// h
-			{SegmentCommand::VLineTo, parseVLineTo},			// V
-			{SegmentCommand::VLineBy, parseVLineBy},			// v
-			{SegmentCommand::CubicTo, parseCubicTo},			// C
-			{SegmentCommand::CubicBy, parseCubicBy},			// c
-			{SegmentCommand::SCubicTo, parseSmoothCubicTo},		// S
-			{SegmentCommand::SCubicBy, parseSmoothCubicBy},		// s
-			{SegmentCommand::QuadTo, parseQuadTo},				// Q
-			{SegmentCommand::QuadBy, parseQuadBy},				// q
-			{SegmentCommand::SQuadTo, parseSmoothQuadTo},		// T
-			{SegmentCommand::SQuadBy, parseSmoothQuadBy},		// t
-			{SegmentCommand::ArcTo, parseArcTo},				// A
-			{SegmentCommand::ArcBy, parseArcBy},				// a
-			{SegmentCommand::CloseTo, parseClose},				// Z
-			{SegmentCommand::CloseBy, parseClose}				// z
-		};
-*/
 
 
 namespace waavs {
@@ -105,591 +76,113 @@ namespace waavs
 	// there are multiple coordinates for a command, in a chain
 	// such as "M 10 10 20 20 30 30"
 	//
+	// The commands are handled in a single switch, rather than through 
+	// a table of functions, and the current point, and the start of the
+	// current figure, are tracked as we go, rather than asking the path
+	// for its last vertex on every relative command.
+	//
 	namespace blpathparser {
 		static charset pathCmdChars("mMlLhHvVcCqQsStTaAzZ");   // set of characters used for commands
 		static charset numberChars("0123456789.+-eE");         // digits, symbols, and letters found in numbers
 		static charset leadingChars("0123456789.+-");          // digits, symbols, and letters found at start of numbers
 
-
-		
-		static bool parseMoveTo(ByteSpan& s, BLPath& apath, int& iteration) noexcept
-		{
-			double x{ 0 };
-			double y{ 0 };
-			BLResult res = BL_SUCCESS;
-			
-			if (!parseNextNumber(s, x))
-				return false;
-			if (!parseNextNumber(s, y))
-				return false;
-
-			if (iteration == 0) {
-				res = apath.moveTo(x, y);
-#ifdef PATH_COMMAND_DEBUG
-				printf("apath.moveTo(%f, %f);\n", x, y);
-#endif
-			}
-			else {
-				res = apath.lineTo(x, y);
-#ifdef PATH_COMMAND_DEBUG
-				printf("// moveTo, iteration: %d\n", iteration);
-				printf("apath.lineTo(%f, %f);\n", x, y);
-#endif
-			}
-			
-			iteration++;
-
-			return true;
-		}
-
-		static bool parseMoveBy(ByteSpan& s, BLPath& apath, int& iteration) noexcept
-		{
-			double x{ 0 };
-			double y{ 0 };
-			BLResult res = BL_SUCCESS;
-			
-			if (!parseNextNumber(s, x))
-				return false;
-			if (!parseNextNumber(s, y))
-				return false;
-
-			BLPoint lastPos{};
-			apath.getLastVertex(&lastPos);
-
-			if (iteration == 0) {
-				res = apath.moveTo(lastPos.x + x, lastPos.y + y);
-
-#ifdef PATH_COMMAND_DEBUG
-				printf("// moveBy(%f, %f), iteration: %d\n", x, y, iteration);
-				printf("apath.moveTo(%f, %f);\n", lastPos.x + x, lastPos.y + y);
-#endif
-			}
-			else {
-				res = apath.lineTo(lastPos.x + x, lastPos.y + y);
-#ifdef PATH_COMMAND_DEBUG
-				printf("// moveBy(%f, %f), iteration: %d\n", x, y, iteration);
-				printf("apath.lineTo(%f, %f);\n", lastPos.x + x, lastPos.y + y);
-#endif
-			}
-			iteration++;
-
-			return true;
-		}
-
-		// Command 'L' - LineTo
-		static bool parseLineTo(ByteSpan& s, BLPath& apath, int& iteration) noexcept
-		{
-			double x{ 0 };
-			double y{ 0 };
-			BLResult res = BL_SUCCESS;
-			
-			if (!parseNextNumber(s, x))
-				return false;
-			if (!parseNextNumber(s, y))
-				return false;
-
-			res = apath.lineTo(x, y);
-
-#ifdef PATH_COMMAND_DEBUG
-			printf("apath.lineTo(%f, %f);\n", x, y);
-#endif
-			
-			iteration++;
-
-			return true;
-		}
-
-		static bool parseLineBy(ByteSpan& s, BLPath& apath, int& iteration) noexcept
-		{
-			double x{ 0 };
-			double y{ 0 };
-			BLResult res = BL_SUCCESS;
-			
-			if (!parseNextNumber(s, x))
-				return false;
-			if (!parseNextNumber(s, y))
-				return false;
-
-			BLPoint lastPos{};
-			apath.getLastVertex(&lastPos);
-
-			res = apath.lineTo(lastPos.x + x, lastPos.y + y);
-
-#ifdef PATH_COMMAND_DEBUG
-			printf("// lineBy: (%f, %f), %d\n", x, y, iteration);
-			printf("apath.lineTo( %f, %f);\n", lastPos.x + x, lastPos.y + y);
-#endif
-			
-			iteration++;
-
-			return true;
-		}
-
-		// Command - H
-		static bool parseHLineTo(ByteSpan& s, BLPath& apath, int& iteration) noexcept
-		{
-			double x{ 0 };
-			BLResult res = BL_SUCCESS;
-			
-			if (!parseNextNumber(s, x))
-				return false;
-
-			BLPoint lastPos{};
-			apath.getLastVertex(&lastPos);
-			res = apath.lineTo(x, lastPos.y);
-
-#ifdef PATH_COMMAND_DEBUG
-			printf("apath.lineTo(%f, %f);\n", x, lastPos.y);
-#endif
-			
-			iteration++;
-
-			return true;
-		}
-
-		// Command - h
-		static bool parseHLineBy(ByteSpan& s, BLPath& apath, int& iteration) noexcept
-		{
-			double x{ 0 };
-			BLResult res = BL_SUCCESS;
-			
-			if (!parseNextNumber(s, x))
-				return false;
-
-			BLPoint lastPos{};
-			apath.getLastVertex(&lastPos);
-			res = apath.lineTo(lastPos.x + x, lastPos.y);
-
-#ifdef PATH_COMMAND_DEBUG
-			//printf("// hLineBy\n");
-			printf("apath.lineTo(%f, %f);\n", lastPos.x + x, lastPos.y);
-#endif
-			
-			iteration++;
-
-			return true;
-		}
-
-		// Command - V
-		static bool parseVLineTo(ByteSpan& s, BLPath& apath, int& iteration) noexcept
-		{
-			double y{ 0 };
-			BLResult res = BL_SUCCESS;
-			
-			if (!parseNextNumber(s, y))
-				return false;
-
-			BLPoint lastPos{};
-			apath.getLastVertex(&lastPos);
-			res = apath.lineTo(lastPos.x, y);
-
-#ifdef PATH_COMMAND_DEBUG
-			//printf("// VLineTo, iteration: %d\n", iteration);
-			printf("apath.lineTo(%f, %f);\n", lastPos.x, y);
-#endif
-			
-			iteration++;
-
-			return true;
-		}
-
-		// Command - v
-		static bool parseVLineBy(ByteSpan& s, BLPath& apath, int& iteration) noexcept
-		{
-			double y{ 0 };
-			BLResult res = BL_SUCCESS;
-			
-			if (!parseNextNumber(s, y))
-				return false;
-
-			BLPoint lastPos{};
-			apath.getLastVertex(&lastPos);
-			res = apath.lineTo(lastPos.x, lastPos.y + y);
-
-#ifdef PATH_COMMAND_DEBUG
-			//printf("// vLineBy, iteration: %d\n", iteration);
-			printf("apath.lineTo(%f,%f);\n", lastPos.x, lastPos.y + y);
-#endif
-			iteration++;
-
-			return true;
-		}
-
-		// Command - Q
-		static bool parseQuadTo(ByteSpan& s, BLPath& apath, int& iteration) noexcept
-		{
-			double x1{ 0 };
-			double y1{ 0 };
-			double x2{ 0 };
-			double y2{ 0 };
-			BLResult res = BL_SUCCESS;
-			
-			if (!parseNextNumber(s, x1))
-				return false;
-			if (!parseNextNumber(s, y1))
-				return false;
-			if (!parseNextNumber(s, x2))
-				return false;
-			if (!parseNextNumber(s, y2))
-				return false;
-
-			res = apath.quadTo(x1, y1, x2, y2);
-
-#ifdef PATH_COMMAND_DEBUG
-			//printf("// quadTo, iteration: %d\n", iteration);
-			printf("apath.quadTo(%f,%f, %f, %f);\n", x1, y1, x2, y2);
-#endif
-
-			
-			iteration++;
-
-			return true;
-		}
-
-		// Command - q
-		static bool parseQuadBy(ByteSpan& s, BLPath& apath, int& iteration) noexcept
-		{
-			double x1{ 0 };
-			double y1{ 0 };
-			double x2{ 0 };
-			double y2{ 0 };
-			BLResult res = BL_SUCCESS;
-			
-			if (!parseNextNumber(s, x1))
-				return false;
-			if (!parseNextNumber(s, y1))
-				return false;
-			if (!parseNextNumber(s, x2))
-				return false;
-			if (!parseNextNumber(s, y2))
-				return false;
-
-			BLPoint lastPos{};
-			apath.getLastVertex(&lastPos);
-
-			res = apath.quadTo(lastPos.x + x1, lastPos.y + y1, lastPos.x + x2, lastPos.y + y2);
-
-#ifdef PATH_COMMAND_DEBUG
-			//printf("// quadTo, iteration: %d\n", iteration);
-			printf("apath.quadTo(%f,%f, %f, %f);\n", lastPos.x + x1, lastPos.y + y1, lastPos.x + x2, lastPos.y + y2);
-#endif
-			
-			iteration++;
-
-			return true;
-		}
-
-		// Command - T
-		static bool parseSmoothQuadTo(ByteSpan& s, BLPath& apath, int& iteration) noexcept
-		{
-			double x2{ 0 };
-			double y2{ 0 };
-			BLResult res = BL_SUCCESS;
-			
-			if (!parseNextNumber(s, x2))
-				return false;
-			if (!parseNextNumber(s, y2))
-				return false;
-
-			res = apath.smoothQuadTo(x2, y2);
-
-#ifdef PATH_COMMAND_DEBUG
-			//printf("// quadTo, iteration: %d\n", iteration);
-			printf("apath.smoothQuadTo(%f,%f);\n", x2, y2);
-#endif
-			
-			iteration++;
-
-			return true;
-		}
-
-		// Command - t
-		static bool parseSmoothQuadBy(ByteSpan& s, BLPath& apath, int& iteration) noexcept
-		{
-			double x2{ 0 };
-			double y2{ 0 };
-			BLResult res = BL_SUCCESS;
-			
-			if (!parseNextNumber(s, x2))
-				return false;
-			if (!parseNextNumber(s, y2))
-				return false;
-
-			BLPoint lastPos{};
-			apath.getLastVertex(&lastPos);
-
-			res = apath.smoothQuadTo(lastPos.x + x2, lastPos.y + y2);
-
-#ifdef PATH_COMMAND_DEBUG
-			//printf("// quadTo, iteration: %d\n", iteration);
-			printf("apath.smoothQuadTo(%f,%f);\n", lastPos.x + x2, lastPos.y + y2);
-#endif
-			
-			iteration++;
-
-			return true;
-		}
-
-		// Command - C
-		static bool parseCubicTo(ByteSpan& s, BLPath& apath, int& iteration) noexcept
-		{
-			double x1{ 0 };
-			double y1{ 0 };
-			double x2{ 0 };
-			double y2{ 0 };
-			double x3{ 0 };
-			double y3{ 0 };
-			BLResult res = BL_SUCCESS;
-			
-			if (!parseNextNumber(s, x1))
-				return false;
-			if (!parseNextNumber(s, y1))
-				return false;
-			if (!parseNextNumber(s, x2))
-				return false;
-			if (!parseNextNumber(s, y2))
-				return false;
-			if (!parseNextNumber(s, x3))
-				return false;
-			if (!parseNextNumber(s, y3))
-				return false;
-
-			res = apath.cubicTo(x1, y1, x2, y2, x3, y3);
-
-#ifdef PATH_COMMAND_DEBUG
-			printf("apath.cubicTo(%f,%f,%f,%f,%f,%f);\n", x1, y1, x2, y2, x3, y3);
-#endif
-			
-			iteration++;
-
-			return true;
-		}
-
-		// Command - c
-		static bool parseCubicBy(ByteSpan& s, BLPath& apath, int& iteration) noexcept
-		{
-			double x1{ 0 };
-			double y1{ 0 };
-			double x2{ 0 };
-			double y2{ 0 };
-			double x3{ 0 };
-			double y3{ 0 };
-			BLResult res = BL_SUCCESS;
-			
-			if (!parseNextNumber(s, x1))
-				return false;
-			if (!parseNextNumber(s, y1))
-				return false;
-			if (!parseNextNumber(s, x2))
-				return false;
-			if (!parseNextNumber(s, y2))
-				return false;
-			if (!parseNextNumber(s, x3))
-				return false;
-			if (!parseNextNumber(s, y3))
-				return false;
-
-			BLPoint lastPos{};
-			apath.getLastVertex(&lastPos);
-
-			res = apath.cubicTo(lastPos.x + x1, lastPos.y + y1, lastPos.x + x2, lastPos.y + y2, lastPos.x + x3, lastPos.y + y3);
-
-#ifdef PATH_COMMAND_DEBUG
-			//printf("apath.cubicBy(%f,%f,%f,%f,%f,%f);\n", x1, y1, x2, y2, x3, y3);
-
-			printf("apath.cubicTo(%f,%f,%f,%f,%f,%f);\n", lastPos.x + x1, lastPos.y + y1, lastPos.x + x2, lastPos.y + y2, lastPos.x + x3, lastPos.y + y3);
-#endif
-			
-			iteration++;
-
-			return true;
-		}
-
-		// Command - S
-		static bool parseSmoothCubicTo(ByteSpan& s, BLPath& apath, int& iteration) noexcept
-		{
-			double x2{ 0 };
-			double y2{ 0 };
-			double x3{ 0 };
-			double y3{ 0 };
-			BLResult res = BL_SUCCESS;
-			
-			if (!parseNextNumber(s, x2))
-				return false;
-			if (!parseNextNumber(s, y2))
-				return false;
-			if (!parseNextNumber(s, x3))
-				return false;
-			if (!parseNextNumber(s, y3))
-				return false;
-
-			res = apath.smoothCubicTo(x2, y2, x3, y3);
-
-#ifdef PATH_COMMAND_DEBUG
-			printf("apath.smoothCubicTo(%f,%f,%f,%f);\n", x2, y2, x3, y3);
-#endif
-			
-			iteration++;
-
-			return true;
-		}
-
-		// Command - s
-		static bool parseSmoothCubicBy(ByteSpan& s, BLPath& apath, int& iteration) noexcept
+		// estimateVertexCount()
+		// A quick pass over the path data, counting the commands
+		// and the numbers, to guess how many vertices the path will 
+		// end up with, so the path can be sized once up front.
+		// Most numbers come in pairs, one vertex each.  An arc can
+		// turn into as many as four cubics, twelve vertices, from
+		// seven numbers.
+		//
+		// Any letter other than 'e' is counted as a command, and a
+		// number is a run of digits and '.', so an exponent counts as
+		// a number of its own.  Close enough for a guess.
+		//
+		// This has to be a good deal cheaper than the parse itself, so
+		// where SSE2 is available, 16 bytes are classified at a time, 
+		// and the counts kept in byte lanes, which are added up before
+		// they can overflow.
+		static size_t estimateVertexCount(const ByteSpan& inSpan) noexcept
 		{
-			double x2{ 0 };
-			double y2{ 0 };
-			double x3{ 0 };
-			double y3{ 0 };
-			BLResult res = BL_SUCCESS;
-			
-			if (!parseNextNumber(s, x2))
-				return false;
-			if (!parseNextNumber(s, y2))
-				return false;
-			if (!parseNextNumber(s, x3))
-				return false;
-			if (!parseNextNumber(s, y3))
-				return false;
-
-			BLPoint lastPos{};
-			apath.getLastVertex(&lastPos);
-
-			res = apath.smoothCubicTo(lastPos.x + x2, lastPos.y + y2, lastPos.x + x3, lastPos.y + y3);
+			const uint8_t* p = inSpan.fStart;
+			const uint8_t* end = inSpan.fEnd;
+
+			size_t numCommands = 0;
+			size_t numNumbers = 0;
+			size_t numArcs = 0;
+			uint32_t prevDigit = 0;
+
+#if defined(WAAVS_MEMSCAN_AVX2) || defined(WAAVS_MEMSCAN_SSE2)
+			const __m128i kZero = _mm_setzero_si128();
+			const __m128i kDigit0 = _mm_set1_epi8('0');
+			const __m128i kNine = _mm_set1_epi8(9);
+			const __m128i kDot = _mm_set1_epi8('.');
+			const __m128i kLowerCase = _mm_set1_epi8(0x20);
+			const __m128i kLetterA = _mm_set1_epi8('a');
+			const __m128i kLetterE = _mm_set1_epi8('e');
+			const __m128i kTwentyFive = _mm_set1_epi8(25);
+
+			// add up the byte lanes of a counter
+			auto laneSum = [&kZero](__m128i v) {
+				__m128i s = _mm_sad_epu8(v, kZero);
+				return (size_t)_mm_cvtsi128_si32(s) + (size_t)_mm_extract_epi16(s, 4);
+			};
+
+			__m128i prevDigits = kZero;
+			while (end - p >= 16)
+			{
+				__m128i numbers = kZero;
+				__m128i commands = kZero;
+				__m128i arcs = kZero;
 
-#ifdef PATH_COMMAND_DEBUG
-			printf("apath.smoothCubicTo(%f,%f,%f,%f);\n", lastPos.x + x2, lastPos.y + y2, lastPos.x + x3, lastPos.y + y3);
-#endif
-			iteration++;
+				// each lane counts by one at most per block, so 255 blocks fit
+				for (int i = 0; i < 255 && end - p >= 16; i++, p += 16)
+				{
+					__m128i b = _mm_loadu_si128((const __m128i*)p);
 
-			return true;
-		}
+					// '0'..'9' are those that come to 0..9 after subtracting '0'
+					__m128i d = _mm_sub_epi8(b, kDigit0);
+					__m128i digits = _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(d, kNine), d), _mm_cmpeq_epi8(b, kDot));
 
+					// and letters are 'a'..'z' once made lower case
+					__m128i lower = _mm_or_si128(b, kLowerCase);
+					__m128i l = _mm_sub_epi8(lower, kLetterA);
+					__m128i letters = _mm_andnot_si128(_mm_cmpeq_epi8(lower, kLetterE), _mm_cmpeq_epi8(_mm_min_epu8(l, kTwentyFive), l));
 
-		// Command - A
-		static bool parseArcTo(ByteSpan& s, BLPath& apath, int& iteration) noexcept
-		{
-			double rx{ 0 };
-			double ry{ 0 };
-			double xAxisRotation{ 0 };
-			double largeArcFlag{ 0 };
-			double sweepFlag{ 0 };
-			double x{ 0 };
-			double y{ 0 };
-			BLResult res = BL_SUCCESS;
-			
-			if (!parseNextNumber(s, rx))
-				return false;
-			if (!parseNextNumber(s, ry))
-				return false;
-			if (!parseNextNumber(s, xAxisRotation))
-				return false;
-			if (!parseNextNumber(s, largeArcFlag))
-				return false;
-			if (!parseNextNumber(s, sweepFlag))
-				return false;
-			if (!parseNextNumber(s, x))
-				return false;
-			if (!parseNextNumber(s, y))
-				return false;
-
-			bool larc = largeArcFlag > 0.5f;
-			bool swp = sweepFlag > 0.5f;
-			double xrot = radians(xAxisRotation);
-
-			res = apath.ellipticArcTo(BLPoint(rx, ry), xrot, larc, swp, BLPoint(x, y));
+					// a number starts at a digit that doesn't follow a digit
+					__m128i following = _mm_or_si128(_mm_slli_si128(digits, 1), _mm_srli_si128(prevDigits, 15));
 
-#ifdef PATH_COMMAND_DEBUG
-			printf("apath.ellipticArcTo(BLPoint(%f,%f) ,%f,%d, %d, BLPoint(%f, %f);\n",rx, ry, xrot, larc, swp, x, y);
-#endif
-			
-			iteration++;
+					// the masks are -1 where set, so subtracting them counts
+					numbers = _mm_sub_epi8(numbers, _mm_andnot_si128(following, digits));
+					commands = _mm_sub_epi8(commands, letters);
+					arcs = _mm_sub_epi8(arcs, _mm_cmpeq_epi8(lower, kLetterA));
 
-			return true;
-		}
-
-		// Command - a
-		static bool parseArcBy(ByteSpan& s, BLPath& apath, int& iteration) noexcept
-		{
-			double rx{ 0 };
-			double ry{ 0 };
-			double xAxisRotation{ 0 };
-			double largeArcFlag{ 0 };
-			double sweepFlag{ 0 };
-			double x{ 0 };
-			double y{ 0 };
-			BLResult res = BL_SUCCESS;
-			
-			if (!parseNextNumber(s, rx))
-				return false;
-			if (!parseNextNumber(s, ry))
-				return false;
-			if (!parseNextNumber(s, xAxisRotation))
-				return false;
-			if (!parseNextNumber(s, largeArcFlag))
-				return false;
-			if (!parseNextNumber(s, sweepFlag))
-				return false;
-			if (!parseNextNumber(s, x))
-				return false;
-			if (!parseNextNumber(s, y))
-				return false;
-
-			bool larc = largeArcFlag > 0.5f;
-			bool swp = sweepFlag > 0.5f;
-			double xrot = radians(xAxisRotation);
-
-			BLPoint lastPos{};
-			apath.getLastVertex(&lastPos);
-
-			res = apath.ellipticArcTo(BLPoint(rx, ry), xrot, larc, swp, BLPoint(lastPos.x + x, lastPos.y + y));
+					prevDigits = digits;
+				}
 
-#ifdef PATH_COMMAND_DEBUG
-			printf("apath.ellipticArcTo(BLPoint(%f,%f) ,%f,%d, %d, BLPoint(%f, %f);\n", rx, ry, xrot, larc, swp, lastPos.x + x, lastPos.y + y);
+				numNumbers += laneSum(numbers);
+				numCommands += laneSum(commands);
+				numArcs += laneSum(arcs);
+			}
+			prevDigit = ((uint32_t)_mm_movemask_epi8(prevDigits) >> 15) & 1;
 #endif
-			
-			iteration++;
-
-			return true;
-		}
 
-		// Command - Z, z
-		static bool parseClose(ByteSpan& s, BLPath& apath, int& iteration) noexcept
-		{
-			BLResult res = BL_SUCCESS;
-			
-			if (iteration > 0)
+			// scalar tail, or the whole thing if there is no vector support
+			for (; p < end; p++)
 			{
-				// consume the character and return
-				// This deals with the odd case where there is a number
-				// typically '0' after a 'z' close
-
-#ifdef PATH_COMMAND_DEBUG
-				printf("PARSECLOSE(), unknown character after first command (%c), ignoring\n", *s);
-#endif
-				s++;
-				iteration++;
-
-
-				return false;
+				uint32_t digit = ((uint8_t)(*p - '0') < 10 || *p == '.') ? 1 : 0;
+				numNumbers += digit & ~prevDigit;
+				prevDigit = digit;
+
+				uint8_t lower = *p | 0x20;
+				if ((uint8_t)(lower - 'a') < 26 && lower != 'e')
+					numCommands++;
+				if (lower == 'a')
+					numArcs++;
 			}
-			
-			res = apath.close();
-			
-#ifdef PATH_COMMAND_DEBUG
-			printf("// z\n");
-			printf("apath.close();\n");
-#endif
-			// No parameters expected to follow
-			// so we increment the iteration and 
-			// if we enter here with it other than '0'
-			// we know we have an error
-			iteration++;
-			
-			return true;
-		}
-
 
+			return numNumbers / 2 + numCommands + numArcs * 9;
+		}
 
 
 		static bool parsePath(const waavs::ByteSpan& inSpan, BLPath& apath) noexcept
@@ -698,13 +191,20 @@ namespace waavs
 			ByteSpan s = inSpan;
 			SegmentCommand currentCommand = SegmentCommand::INVALID;
 			int iteration = 0;
-			std::function<bool(ByteSpan&, BLPath&, int&)> pFunc{ nullptr };
 			bool success = false;
-			
+
+			// The current point, and where the current figure started,
+			// which is where the current point goes on a close
+			BLPoint lastPos{};
+			apath.getLastVertex(&lastPos);
+			BLPoint figureStart = lastPos;
+
+			double args[7]{};
+
+			apath.reserve(apath.size() + estimateVertexCount(inSpan));
+
 			while (s)
 			{
-
-				
 				// always ignore leading whitespace
 				s = chunk_ltrim(s, chrWspChars);
 
@@ -724,61 +224,223 @@ namespace waavs
 					// move past the command character
 					s++;
 				}
-				else {
-					// The tricky part here is, the character we're sitting
-					// on is not a valid command character, so we're either
-					// sitting at the beginning of a number, or we're sitting
-					// at an invalid command.
-					// We'll just assume we're sitting at a number, and 
-					// process it as if it's a continuation of the last command
-			        // to be more robust, we can check whether it's the beginning
-					// of a number or not.  If not, then return false
-					//if (!leadingChars[*s])
-					// {
-					//	 return false;
-					// }
-				}
-				
+				// Otherwise, we assume we're sitting at a number, and 
+				// process it as a continuation of the last command.
+				// If it's not a number, the command will fail to parse.
+
 #ifdef PATH_COMMAND_DEBUG
-				//printf("// Command: %c [%d]\n", currentCommand, iteration);
+				printf("// Command: %c [%d]\n", (char)currentCommand, iteration);
 #endif
-				
+
+				// The relative (lowercase) commands are their absolute 
+				// counterparts, offset by the current point
+				bool relative = (uint8_t)currentCommand >= 'a';
+				bool ok = false;
+
 				switch (currentCommand)
 				{
-					case SegmentCommand::MoveTo: pFunc = parseMoveTo; break;
-					case SegmentCommand::MoveBy: pFunc = parseMoveBy; break;
-					case SegmentCommand::LineTo: pFunc = parseLineTo; break;
-					case SegmentCommand::LineBy: pFunc = parseLineBy; break;
-					case SegmentCommand::HLineTo: pFunc = parseHLineTo; break;
-					case SegmentCommand::HLineBy: pFunc = parseHLineBy; break;
-					case SegmentCommand::VLineTo: pFunc = parseVLineTo; break;
-					case SegmentCommand::VLineBy: pFunc = parseVLineBy; break;
-					case SegmentCommand::CubicTo: pFunc = parseCubicTo; break;
-					case SegmentCommand::CubicBy: pFunc = parseCubicBy; break;
-					case SegmentCommand::SCubicTo: pFunc = parseSmoothCubicTo; break;
-					case SegmentCommand::SCubicBy: pFunc = parseSmoothCubicBy; break;
-					case SegmentCommand::QuadTo: pFunc = parseQuadTo; break;
-					case SegmentCommand::QuadBy: pFunc = parseQuadBy; break;
-					case SegmentCommand::SQuadTo: pFunc = parseSmoothQuadTo; break;
-					case SegmentCommand::SQuadBy: pFunc = parseSmoothQuadBy; break;
-					case SegmentCommand::ArcTo: pFunc = parseArcTo; break;
-					case SegmentCommand::ArcBy: pFunc = parseArcBy; break;
-					case SegmentCommand::CloseTo: pFunc = parseClose; break;
-					case SegmentCommand::CloseBy: pFunc = parseClose; break;
-						
+					// Command - M, m
+					// Pairs after the first are lines
+					case SegmentCommand::MoveTo:
+					case SegmentCommand::MoveBy:
+					{
+						if (parseNumberList(s, args, 2) != 2)
+							break;
+
+						BLPoint p(args[0], args[1]);
+						if (relative)
+							p += lastPos;
+
+						if (iteration == 0) {
+							apath.moveTo(p);
+							figureStart = p;
+						}
+						else {
+							apath.lineTo(p);
+						}
+
+						lastPos = p;
+						ok = true;
+					}
+					break;
+
+					// Command - L, l
+					case SegmentCommand::LineTo:
+					case SegmentCommand::LineBy:
+					{
+						if (parseNumberList(s, args, 2) != 2)
+							break;
+
+						BLPoint p(args[0], args[1]);
+						if (relative)
+							p += lastPos;
+
+						apath.lineTo(p);
+						lastPos = p;
+						ok = true;
+					}
+					break;
+
+					// Command - H, h
+					case SegmentCommand::HLineTo:
+					case SegmentCommand::HLineBy:
+					{
+						if (parseNumberList(s, args, 1) != 1)
+							break;
+
+						lastPos.x = relative ? lastPos.x + args[0] : args[0];
+						apath.lineTo(lastPos);
+						ok = true;
+					}
+					break;
+
+					// Command - V, v
+					case SegmentCommand::VLineTo:
+					case SegmentCommand::VLineBy:
+					{
+						if (parseNumberList(s, args, 1) != 1)
+							break;
+
+						lastPos.y = relative ? lastPos.y + args[0] : args[0];
+						apath.lineTo(lastPos);
+						ok = true;
+					}
+					break;
+
+					// Command - C, c
+					case SegmentCommand::CubicTo:
+					case SegmentCommand::CubicBy:
+					{
+						if (parseNumberList(s, args, 6) != 6)
+							break;
+
+						BLPoint p1(args[0], args[1]);
+						BLPoint p2(args[2], args[3]);
+						BLPoint p3(args[4], args[5]);
+						if (relative) {
+							p1 += lastPos;
+							p2 += lastPos;
+							p3 += lastPos;
+						}
+
+						apath.cubicTo(p1, p2, p3);
+						lastPos = p3;
+						ok = true;
+					}
+					break;
+
+					// Command - S, s
+					case SegmentCommand::SCubicTo:
+					case SegmentCommand::SCubicBy:
+					{
+						if (parseNumberList(s, args, 4) != 4)
+							break;
+
+						BLPoint p2(args[0], args[1]);
+						BLPoint p3(args[2], args[3]);
+						if (relative) {
+							p2 += lastPos;
+							p3 += lastPos;
+						}
+
+						apath.smoothCubicTo(p2, p3);
+						lastPos = p3;
+						ok = true;
+					}
+					break;
+
+					// Command - Q, q
+					case SegmentCommand::QuadTo:
+					case SegmentCommand::QuadBy:
+					{
+						if (parseNumberList(s, args, 4) != 4)
+							break;
+
+						BLPoint p1(args[0], args[1]);
+						BLPoint p2(args[2], args[3]);
+						if (relative) {
+							p1 += lastPos;
+							p2 += lastPos;
+						}
+
+						apath.quadTo(p1, p2);
+						lastPos = p2;
+						ok = true;
+					}
+					break;
+
+					// Command - T, t
+					case SegmentCommand::SQuadTo:
+					case SegmentCommand::SQuadBy:
+					{
+						if (parseNumberList(s, args, 2) != 2)
+							break;
+
+						BLPoint p2(args[0], args[1]);
+						if (relative)
+							p2 += lastPos;
+
+						apath.smoothQuadTo(p2);
+						lastPos = p2;
+						ok = true;
+					}
+					break;
+
+					// Command - A, a
+					case SegmentCommand::ArcTo:
+					case SegmentCommand::ArcBy:
+					{
+						if (parseNumberList(s, args, 7) != 7)
+							break;
+
+						BLPoint p(args[5], args[6]);
+						if (relative)
+							p += lastPos;
+
+						bool larc = args[3] > 0.5;
+						bool swp = args[4] > 0.5;
+						double xrot = radians(args[2]);
+
+						apath.ellipticArcTo(BLPoint(args[0], args[1]), xrot, larc, swp, p);
+						lastPos = p;
+						ok = true;
+					}
+					break;
+
+					// Command - Z, z
+					// No parameters expected to follow, so if we 
+					// come around again without a new command, we 
+					// typically have a number, like '0', after the 'z',
+					// which is an error
+					case SegmentCommand::CloseTo:
+					case SegmentCommand::CloseBy:
+					{
+						if (iteration > 0)
+						{
+							// consume the character and return
+							s++;
+							break;
+						}
+
+						apath.close();
+						lastPos = figureStart;
+						ok = true;
+					}
+					break;
+
 					default:
 						printf("parsePath: INVALID COMMAND: %c\n", *s);
 						return false;
 				}
-				
-				if (pFunc != nullptr)
-					success = pFunc(s, apath, iteration);
-				
-				if (!success)
+
+				if (!ok)
 				{
 					printf("parsePath: failed to parse command: %c\n", *s);
 					return false;
 				}
+
+				success = true;
+				iteration++;
 			}
 
 #ifdef PATH_COMMAND_DEBUG
@@ -788,4 +450,4 @@ namespace waavs
 			return success;
 		}
 	}
-}
\ No newline at end of file
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+//
+// svgpathcache
+// Sharing the parsed path data of a document.
+//
+// Maps, icon sheets, and what a lot of tools export, repeat the same
+// 'd' attribute over and over, for a glyph or symbol that is drawn in
+// many places.  Parsing every one of those into a path of its own is
+// time spent for nothing, and a copy of the vertices each.
+//
+// The SVGPathCache keeps the paths parsed while a document is loading,
+// keyed by the text of their path data.  When the same text comes up
+// again, the path that was already parsed is handed out.  BLPath is 
+// reference counted, and copy on write, so all the nodes share the one
+// set of vertices.  The simplified versions of a large path, for 
+// drawing it small, are shared the same way.
+//
+// The keys point into the document's source, so the cache is only
+// used while the document is loading, and emptied once it is done.
+// The statistics are kept.
+//
+
+#include <memory>
+#include <unordered_map>
+
+#include "blend2d.h"
+#include "bspan.h"
+#include "svgpath.h"
+#include "pathsimplify.h"
+#include "arena.h"
+
+
+namespace waavs
+{
+    // pathDataHash()
+    // Path data can run to megabytes, so it is hashed 8 bytes at a
+    // time, rather than a byte at a time like ByteSpanHash.
+    static inline uint64_t pathDataHash(const ByteSpan& span) noexcept
+    {
+        static constexpr uint64_t kMultiplier = 0x9E3779B97F4A7C15ull;
+
+        const uint8_t* p = span.fStart;
+        size_t n = span.size();
+        uint64_t h = (uint64_t)n * kMultiplier;
+
+        for (; n >= 8; n -= 8, p += 8)
+        {
+            uint64_t w;
+            memcpy(&w, p, 8);
+            h = (h ^ w) * kMultiplier;
+            h ^= h >> 29;
+        }
+
+        for (; n > 0; n--, p++)
+            h = (h ^ *p) * kMultiplier;
+
+        return h ^ (h >> 32);
+    }
+
+
+    struct SVGPathCache
+    {
+        struct Entry {
+            ByteSpan fData{};
+            BLPath fPath{};
+            std::shared_ptr<PathLevelsOfDetail> fLevelsOfDetail{};
+            bool fParsed{ false };
+        };
+
+        // Keyed by the hash of the path data, rather than the data
+        // itself, so growing the map doesn't hash all of it again
+        std::unordered_map<uint64_t, Entry> fEntries{};
+
+        // Some statistics
+        size_t fLookups{ 0 };
+        size_t fHits{ 0 };
+        size_t fBytesSkipped{ 0 };          // path data that didn't need parsing
+        size_t fVerticesShared{ 0 };        // vertices that didn't need their own copy
+
+
+        // parse()
+        // Parse the path data 'd' into 'path', or hand out the path 
+        // already parsed from the same data.  'levels' is where the 
+        // simplified versions of the path will go, if it is big enough
+        // to have them.  Returns whether the path data parsed.
+        bool parse(const ByteSpan& d, BLPath& path, std::shared_ptr<PathLevelsOfDetail>& levels)
+        {
+            fLookups++;
+
+            uint64_t key = pathDataHash(d);
+
+            auto it = fEntries.find(key);
+            if (it != fEntries.end() && it->second.fData == d)
+            {
+                fHits++;
+                fBytesSkipped += d.size();
+                fVerticesShared += it->second.fPath.size();
+
+                path = it->second.fPath;
+                levels = it->second.fLevelsOfDetail;
+
+                return it->second.fParsed;
+            }
+
+            Entry entry{};
+            entry.fData = d;
+            entry.fParsed = blpathparser::parsePath(d, entry.fPath);
+            entry.fPath.shrink();
+
+            if (entry.fPath.size() >= PathLevelsOfDetail::kMinVertices)
+                entry.fLevelsOfDetail = arena_make_shared<PathLevelsOfDetail>();
+
+            path = entry.fPath;
+            levels = entry.fLevelsOfDetail;
+            bool parsed = entry.fParsed;
+
+            // On the rare chance of two different path data with the
+            // same hash, the first one stays
+            fEntries.emplace(key, std::move(entry));
+
+            return parsed;
+        }
+
+        size_t size() const { return fEntries.size(); }
+        double hitRate() const { return fLookups > 0 ? (double)fHits / (double)fLookups : 0.0; }
+
+        // clear()
+        // Let go of the entries.  The nodes hold on to their paths.
+        void clear()
+        {
+            fEntries.clear();
+        }
+    };
+}
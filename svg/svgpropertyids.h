@@ -0,0 +1,150 @@
+#pragma once
+
+//
+// svgpropertyids
+// Compact integer identifiers for the SVG attribute and property
+// names that turn into visual properties.
+//
+// Rather than hashing a ByteSpan into a std::unordered_map every time
+// a property is set or looked up, the name is turned into an
+// SVG_PROPERTY_ID once, when the attribute is first seen.  From then
+// on, everything is indexed by that id.
+//
+// The name to id mapping is a perfect hash that is computed entirely
+// at compile time (see svgnamehash.h).
+//
+// To add a new property, add an id to the enum, and an entry to the
+// gSVGPropertyNames table.  If the new name causes a collision, a
+// different seed will be found automatically.
+//
+
+#include <cstdint>
+
+#include "svgnamehash.h"
+
+
+namespace waavs
+{
+    // The order of these ids is also the order in which
+    // the properties are applied to a drawing context
+    enum SVG_PROPERTY_ID : uint8_t
+    {
+        SVG_PROPERTY_INVALID = 0,
+
+        SVG_PROPERTY_OPACITY,
+
+        SVG_PROPERTY_FILL,
+        SVG_PROPERTY_FILL_OPACITY,
+        SVG_PROPERTY_FILL_RULE,
+
+        SVG_PROPERTY_STROKE,
+        SVG_PROPERTY_STROKE_OPACITY,
+        SVG_PROPERTY_STROKE_WIDTH,
+        SVG_PROPERTY_STROKE_LINECAP,
+        SVG_PROPERTY_STROKE_LINECAP_START,
+        SVG_PROPERTY_STROKE_LINECAP_END,
+        SVG_PROPERTY_STROKE_LINEJOIN,
+        SVG_PROPERTY_STROKE_MITERLIMIT,
+        SVG_PROPERTY_PAINT_ORDER,
+        SVG_PROPERTY_VECTOR_EFFECT,
+
+        SVG_PROPERTY_FONT_FAMILY,
+        SVG_PROPERTY_FONT_SIZE,
+        SVG_PROPERTY_TEXT_ANCHOR,
+        SVG_PROPERTY_TEXT_ALIGN,
+
+        SVG_PROPERTY_MARKER,
+        SVG_PROPERTY_MARKER_START,
+        SVG_PROPERTY_MARKER_MID,
+        SVG_PROPERTY_MARKER_END,
+
+        SVG_PROPERTY_CLIP_PATH,
+        SVG_PROPERTY_TRANSFORM,
+        SVG_PROPERTY_VIEWBOX,
+        SVG_PROPERTY_EXTEND_MODE,
+        SVG_PROPERTY_SYSTEM_LANGUAGE,
+
+        SVG_PROPERTY_COUNT
+    };
+
+    // Presence of properties on a node is tracked in a 64-bit mask
+    static_assert(SVG_PROPERTY_COUNT <= 64, "SVG_PROPERTY_ID must fit in a 64-bit mask");
+
+
+    static constexpr SVGNameEntry gSVGPropertyNames[] = {
+        { "opacity", SVG_PROPERTY_OPACITY },
+
+        { "fill", SVG_PROPERTY_FILL },
+        { "fill-opacity", SVG_PROPERTY_FILL_OPACITY },
+        { "fill-rule", SVG_PROPERTY_FILL_RULE },
+
+        { "stroke", SVG_PROPERTY_STROKE },
+        { "stroke-opacity", SVG_PROPERTY_STROKE_OPACITY },
+        { "stroke-width", SVG_PROPERTY_STROKE_WIDTH },
+        { "stroke-linecap", SVG_PROPERTY_STROKE_LINECAP },
+        { "stroke-linecap-start", SVG_PROPERTY_STROKE_LINECAP_START },
+        { "stroke-linecap-end", SVG_PROPERTY_STROKE_LINECAP_END },
+        { "stroke-linejoin", SVG_PROPERTY_STROKE_LINEJOIN },
+        { "stroke-miterlimit", SVG_PROPERTY_STROKE_MITERLIMIT },
+        { "paint-order", SVG_PROPERTY_PAINT_ORDER },
+        { "vector-effect", SVG_PROPERTY_VECTOR_EFFECT },
+
+        { "font-family", SVG_PROPERTY_FONT_FAMILY },
+        { "font-size", SVG_PROPERTY_FONT_SIZE },
+        { "text-anchor", SVG_PROPERTY_TEXT_ANCHOR },
+        { "text-align", SVG_PROPERTY_TEXT_ALIGN },
+
+        { "marker", SVG_PROPERTY_MARKER },
+        { "marker-start", SVG_PROPERTY_MARKER_START },
+        { "marker-mid", SVG_PROPERTY_MARKER_MID },
+        { "marker-end", SVG_PROPERTY_MARKER_END },
+
+        { "clip-path", SVG_PROPERTY_CLIP_PATH },
+        { "transform", SVG_PROPERTY_TRANSFORM },
+        { "viewBox", SVG_PROPERTY_VIEWBOX },
+        { "extendMode", SVG_PROPERTY_EXTEND_MODE },
+        { "systemLanguage", SVG_PROPERTY_SYSTEM_LANGUAGE },
+    };
+
+    static_assert(sizeof(gSVGPropertyNames) / sizeof(gSVGPropertyNames[0]) == SVG_PROPERTY_COUNT - 1, "every SVG_PROPERTY_ID needs a name");
+    static_assert(svg_names_in_order(gSVGPropertyNames), "gSVGPropertyNames must be in SVG_PROPERTY_ID order");
+
+    static constexpr SVGNameTable<128> gSVGPropertyTable = svg_name_build_table<128>(gSVGPropertyNames);
+    static_assert(svg_name_seed_is_perfect<128>(gSVGPropertyNames, gSVGPropertyTable.fSeed), "no perfect hash seed for SVG property names");
+
+
+    //
+    // svgPropertyId()
+    //
+    // Turn a property name into its id.  Returns SVG_PROPERTY_INVALID
+    // if the name is not one of the known properties.
+    //
+    static inline SVG_PROPERTY_ID svgPropertyId(const ByteSpan& name) noexcept
+    {
+        return (SVG_PROPERTY_ID)svg_name_lookup(gSVGPropertyNames, gSVGPropertyTable, name);
+    }
+
+    // svgPropertyName()
+    // Return the name associated with a property id
+    static inline ByteSpan svgPropertyName(SVG_PROPERTY_ID id) noexcept
+    {
+        if ((id == SVG_PROPERTY_INVALID) || (id >= SVG_PROPERTY_COUNT))
+            return {};
+
+        return ByteSpan(gSVGPropertyNames[id - 1].fName);
+    }
+
+    // Number of bits set in a 64-bit mask
+    static inline unsigned svg_popcount64(uint64_t mask) noexcept
+    {
+#if defined(_MSC_VER)
+        // __popcnt64 requires the POPCNT instruction, so stay portable
+        mask = mask - ((mask >> 1) & 0x5555555555555555ull);
+        mask = (mask & 0x3333333333333333ull) + ((mask >> 2) & 0x3333333333333333ull);
+        mask = (mask + (mask >> 4)) & 0x0f0f0f0f0f0f0f0full;
+        return (unsigned)((mask * 0x0101010101010101ull) >> 56);
+#else
+        return (unsigned)__builtin_popcountll(mask);
+#endif
+    }
+}
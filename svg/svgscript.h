@@ -21,7 +21,7 @@ namespace waavs {
         static void registerFactory()
         {
             gSVGGraphicsElementCreation["script"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-                auto node = std::make_shared<SVGScriptElement>(aroot);
+                auto node = arena_make_shared<SVGScriptElement>(aroot);
                 node->loadFromXmlIterator(iter);
                 return node;
                 };
@@ -7,6 +7,8 @@
 
 #include "svgattributes.h"
 #include "svgpath.h"
+#include "pathsimplify.h"
+#include "svgpathcache.h"
 #include "svgtext.h"
 #include "viewport.h"
 
@@ -26,7 +28,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["marker"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGMarkerNode>(aroot);
+				auto node = arena_make_shared<SVGMarkerNode>(aroot);
 				node->loadFromXmlIterator(iter);
 				return node;
 			};
@@ -166,6 +168,29 @@ namespace waavs {
 
 	};
 
+	// pathHasOpenFigure()
+	// Whether any figure of the path is left without a close
+	static bool pathHasOpenFigure(const BLPath& apath)
+	{
+		const uint8_t* cmd = apath.commandData();
+		const uint8_t* end = apath.commandDataEnd();
+		bool inFigure = false;
+
+		for (; cmd < end; cmd++)
+		{
+			if (*cmd == BL_PATH_CMD_MOVE)
+			{
+				if (inFigure)
+					return true;
+				inFigure = true;
+			}
+			else if (*cmd == BL_PATH_CMD_CLOSE)
+				inFigure = false;
+		}
+
+		return inFigure;
+	}
+
 	
 	//===================================================
 	// SVGGeometryElement
@@ -175,10 +200,38 @@ namespace waavs {
 	
 	struct SVGGeometryElement : public SVGGraphicsElement
 	{
+		// The simple shapes also keep their geometry in its own form,
+		// so they can be drawn with the blend2d calls for that kind of
+		// geometry, which skip building up and processing a general 
+		// path.  fPath is still there, for markers, hit testing, and 
+		// bounds.  Polygons and polylines draw straight from the
+		// vertices of fPath, so they don't need anything more.
+		union NativeGeometry {
+			BLRect fRect;
+			BLRoundRect fRoundRect;
+			BLCircle fCircle;
+			BLEllipse fEllipse;
+			BLLine fLine;
+		};
+
 		BLPath fPath{};
 		BLPath fStrokedPath{};
 		bool fIsStroked{ false };
 		bool fHasMarkers{ false };
+
+		BLGeometryType fGeometryType{ BL_GEOMETRY_TYPE_PATH };
+		NativeGeometry fNative{};
+
+		// Simplified versions of large paths, for when they're drawn small.
+		// Shared between the nodes that share the same path data.
+		std::shared_ptr<PathLevelsOfDetail> fLevelsOfDetail{};
+
+		// Bounds of fPath, worked out once
+		BLBox fPathBounds{};
+		bool fHasPathBounds{ false };
+
+		// A line, polyline, or path with a figure that isn't closed
+		bool fIsOpen{ false };
 		
 		SVGGeometryElement(IAmGroot* iMap) :SVGGraphicsElement(iMap) {}
 		
@@ -216,34 +269,157 @@ namespace waavs {
 		
 		bool contains(double x, double y) override
 		{
-			BLPoint localPoint(x, y);
-			
 			// check to see if we have a transform property
-			// if we do, transform the points through that transform
-			// then check to see if the point is inside the transformed path
-			if (fHasTransform)
+			// if we do, transform the point through the inverse
+			// then check to see if the point is inside the path
+			BLPoint localPoint = toChildSpace(BLPoint(x, y));
+
+			// BUGBUG - this only knows about our own fill-rule, hitTestPoint()
+			// also knows about the one that is inherited
+			BLHitTest ahit = fPath.hitTest(localPoint, fillRule(BL_FILL_RULE_NON_ZERO));
+			return (ahit == BLHitTest::BL_HIT_TEST_IN);
+		}
+
+		SVGVisualNode* hitTestPoint(const BLPoint& pt, BLFillRule inheritedRule) override
+		{
+			if (!visible())
+				return nullptr;
+
+			BLPoint localPoint = toChildSpace(pt);
+
+			BLHitTest ahit = fPath.hitTest(localPoint, fillRule(inheritedRule));
+			if (ahit == BLHitTest::BL_HIT_TEST_IN)
+				return this;
+
+			return nullptr;
+		}
+
+		void hitTestRect(const BLBox& area, std::vector<SVGVisualNode*>& found) override
+		{
+			if (!visible())
+				return;
+
+			BLBox bbox{};
+			if (fPath.getBoundingBox(&bbox) != BL_SUCCESS)
+				return;
+
+			if (BoundsHierarchy::overlaps(bbox, toChildSpace(area)))
+				found.push_back(this);
+		}
+
+		bool cullingBounds(BLBox& bounds, double& strokeScale) const override
+		{
+			// Markers draw outside the path, and a non-scaling stroke
+			// does not follow the user space, so don't try to guess
+			if (fHasMarkers || hasVisualProperty(SVG_PROPERTY_VECTOR_EFFECT))
+				return false;
+
+			if (fPath.getBoundingBox(&bounds) != BL_SUCCESS)
+				return false;
+
+			bounds = boxInflate(bounds, strokeCullingPadding());
+			strokeScale = 1.0;
+
+			if (fHasTransform) {
+				bounds = boxTransform(bounds, fTransform);
+				strokeScale = transformScale(fTransform);
+			}
+
+			return true;
+		}
+
+		// Once the geometry is known, work out the simplified
+		// versions of it, if it's big enough to need them
+		void bindToGroot(IAmGroot* groot) override
+		{
+			SVGGraphicsElement::bindToGroot(groot);
+
+			fHasPathBounds = (fPath.getBoundingBox(&fPathBounds) == BL_SUCCESS);
+			fIsOpen = (fGeometryType == BL_GEOMETRY_TYPE_LINE) ||
+				(fGeometryType == BL_GEOMETRY_TYPE_POLYLINED) ||
+				(fGeometryType == BL_GEOMETRY_TYPE_PATH && pathHasOpenFigure(fPath));
+
+			if (fPath.size() >= PathLevelsOfDetail::kMinVertices)
 			{
-				// get the inverse transform
-				auto inverse = fTransform;
-				inverse.invert();
-				localPoint = inverse.mapPoint(localPoint);
+				if (nullptr == fLevelsOfDetail)
+					fLevelsOfDetail = arena_make_shared<PathLevelsOfDetail>();
+
+				if (!fLevelsOfDetail->built())
+					fLevelsOfDetail->build(fPath);
 			}
+		}
 
-		
-			
-			// BUGBUG - should use the fill-rule attribute that will actually apply
-			BLHitTest ahit = fPath.hitTest(localPoint, BLFillRule::BL_FILL_RULE_NON_ZERO);
-			return (ahit == BLHitTest::BL_HIT_TEST_IN);
+		// loadPathData()
+		//
+		// Parse the path data 'd' into fPath.  While the document is
+		// loading, this goes through its path cache, so nodes with the
+		// same path data share one parsed path.
+		bool loadPathData(const ByteSpan& d)
+		{
+			SVGPathCache* cache = (nullptr != root()) ? root()->pathCache() : nullptr;
+			if (nullptr != cache)
+				return cache->parse(d, fPath, fLevelsOfDetail);
+
+			bool success = blpathparser::parsePath(d, fPath);
+			fPath.shrink();
+
+			return success;
+		}
+
+		// drawSmall()
+		//
+		// If the shape, stroke and all, comes out smaller than the 
+		// context's threshold on the drawing surface, draw its bounding
+		// box instead, which covers about the same pixels, and return 
+		// true.  Otherwise, return false, and it is drawn as normal.
+		//
+		// The box of a line, or an open shape, covers a lot more than
+		// the shape does, so only its stroke stands in for the shape.
+		// With no stroke, a line shows nothing, and other open shapes
+		// are drawn as normal, as what their fill covers depends on
+		// their shape.
+		bool drawSmall(IRenderSVG* ctx)
+		{
+			double threshold = ctx->smallGeometryThreshold();
+			// A non-scaling stroke keeps its width, however small the shape
+			if (threshold <= 0 || !fHasPathBounds || fHasMarkers || hasVisualProperty(SVG_PROPERTY_VECTOR_EFFECT))
+				return false;
+
+			const BLMatrix2D& tm = ctx->finalTransform();
+
+			// The context reports a width of 1 even when there is no
+			// stroke, so only a stroke that will be drawn counts.
+			bool stroked = ctx->strokeStyleType() != BL_OBJECT_TYPE_NULL;
+			if (stroked)
+			{
+				double scale = transformScale(tm);
+				if (std::abs(ctx->strokeWidth()) * scale >= threshold)
+					return false;
+			}
+
+			BLBox dev = boxTransform(fPathBounds, tm);
+			if ((dev.x1 - dev.x0) >= threshold || (dev.y1 - dev.y0) >= threshold)
+				return false;
+
+			if (fIsOpen && !stroked)
+				return fGeometryType == BL_GEOMETRY_TYPE_LINE;
+
+			BLRect box(fPathBounds.x0, fPathBounds.y0, fPathBounds.x1 - fPathBounds.x0, fPathBounds.y1 - fPathBounds.y0);
+			if (!fIsOpen)
+				ctx->fillGeometry(BL_GEOMETRY_TYPE_RECTD, &box);
+			ctx->strokeGeometry(BL_GEOMETRY_TYPE_RECTD, &box);
+
+			return true;
 		}
 
 		void bindPropertiesToGroot(IAmGroot* groot) override
 		{
 			SVGGraphicsElement::bindPropertiesToGroot(groot);
 			
-			if (((fVisualProperties.find("marker-start") != fVisualProperties.end()) && fVisualProperties["marker-start"]->isSet()) ||
-				((fVisualProperties.find("marker-mid") != fVisualProperties.end()) && fVisualProperties["marker-mid"]->isSet()) ||
-				((fVisualProperties.find("marker-end") != fVisualProperties.end()) && fVisualProperties["marker-end"]->isSet()) ||
-				((fVisualProperties.find("marker") != fVisualProperties.end()) && fVisualProperties["marker"]->isSet()))
+			if ((hasVisualProperty(SVG_PROPERTY_MARKER_START) && getVisualProperty(SVG_PROPERTY_MARKER_START)->isSet()) ||
+				(hasVisualProperty(SVG_PROPERTY_MARKER_MID) && getVisualProperty(SVG_PROPERTY_MARKER_MID)->isSet()) ||
+				(hasVisualProperty(SVG_PROPERTY_MARKER_END) && getVisualProperty(SVG_PROPERTY_MARKER_END)->isSet()) ||
+				(hasVisualProperty(SVG_PROPERTY_MARKER) && getVisualProperty(SVG_PROPERTY_MARKER)->isSet()))
 			{
 				fHasMarkers = true;
 			}
@@ -321,12 +497,12 @@ namespace waavs {
 		void drawMarkers(IRenderSVG* ctx)
 		{
 			// get general marker if it exists
-			auto marker = getVisualProperty("marker");
+			auto marker = getVisualProperty(SVG_PROPERTY_MARKER);
 			if (marker!=nullptr && marker->needsBinding())
 				marker->bindToGroot(root());
 			
 			// draw first marker
-			auto markerStart = getVisualProperty("marker-start");
+			auto markerStart = getVisualProperty(SVG_PROPERTY_MARKER_START);
 			if (markerStart != nullptr && markerStart->isSet() && fPath.size() >=2)
 			{
 				// do the binding if necessary
@@ -343,7 +519,7 @@ namespace waavs {
 
 			
 			// draw mid-markers
-			auto markerMid = getVisualProperty("marker-mid");
+			auto markerMid = getVisualProperty(SVG_PROPERTY_MARKER_MID);
 
 			if (nullptr != markerMid && markerMid->isSet() && fPath.size() >= 2)
 			{
@@ -362,7 +538,7 @@ namespace waavs {
 			}
 			
 			// draw last marker
-			auto markerEnd = getVisualProperty("marker-end");
+			auto markerEnd = getVisualProperty(SVG_PROPERTY_MARKER_END);
 
 			if (nullptr != markerEnd && markerEnd->isSet() && fPath.size() >= 2)
 			{
@@ -379,6 +555,31 @@ namespace waavs {
 			
 		}
 		
+		// drawNative()
+		// Draw the shape using its native geometry
+		void drawNative(IRenderSVG* ctx)
+		{
+			if (fGeometryType == BL_GEOMETRY_TYPE_POLYGOND || fGeometryType == BL_GEOMETRY_TYPE_POLYLINED)
+			{
+				// The points are the vertices of the path, 
+				// less the close at the end of a polygon
+				size_t count = fPath.size();
+				if (fGeometryType == BL_GEOMETRY_TYPE_POLYGOND && count > 0)
+					count--;
+
+				BLArrayView<BLPoint> points{};
+				points.reset(fPath.vertexData(), count);
+
+				ctx->fillGeometry(fGeometryType, &points);
+				ctx->strokeGeometry(fGeometryType, &points);
+
+				return;
+			}
+
+			ctx->fillGeometry(fGeometryType, &fNative);
+			ctx->strokeGeometry(fGeometryType, &fNative);
+		}
+
 		void drawSelf(IRenderSVG *ctx) override
 		{
 			// The paint-order attribute can change which
@@ -386,8 +587,26 @@ namespace waavs {
 			//ctx->path(fPath);
 			//printf("SVGGeometryElement::drawSelf(%s)\n", id().c_str());
 			
-			ctx->fillPath(fPath);
-			ctx->strokePath(fPath);
+			if (drawSmall(ctx))
+				return;
+
+			const BLPath* lod = nullptr;
+			if (nullptr != fLevelsOfDetail && !fLevelsOfDetail->empty() && ctx->useLevelsOfDetail())
+				lod = fLevelsOfDetail->select(transformScale(ctx->finalTransform()));
+
+			if (nullptr != lod)
+			{
+				ctx->fillPath(*lod);
+				ctx->strokePath(*lod);
+			}
+			else if (fGeometryType == BL_GEOMETRY_TYPE_PATH || !ctx->useNativeGeometry())
+			{
+				ctx->fillPath(fPath);
+				ctx->strokePath(fPath);
+			}
+			else {
+				drawNative(ctx);
+			}
 			//ctx->flush();
 			
 			// draw markers if we have any
@@ -403,7 +622,7 @@ namespace waavs {
 	{
 		static void registerFactory() {
 			gShapeCreationMap["line"] = [](IAmGroot* root, const XmlElement& elem) {
-				auto node = std::make_shared<SVGLineElement>(root);
+				auto node = arena_make_shared<SVGLineElement>(root);
 				node->loadFromXmlElement(elem);
 				return node;
 			};
@@ -455,6 +674,9 @@ namespace waavs {
 			geom.y1 = y2;
 			
 			fPath.addLine(geom);
+
+			fNative.fLine = geom;
+			fGeometryType = BL_GEOMETRY_TYPE_LINE;
 		}
 		
 		void loadVisualProperties(const XmlAttributeCollection& attrs) override
@@ -475,7 +697,7 @@ namespace waavs {
 	{
 		static void registerSingular() {
 			gShapeCreationMap["rect"] = [](IAmGroot* root, const XmlElement& elem) {
-				auto node = std::make_shared<SVGRectElement>(root);
+				auto node = arena_make_shared<SVGRectElement>(root);
 				node->loadFromXmlElement(elem);
 				return node;
 			};
@@ -483,7 +705,7 @@ namespace waavs {
 		
 		static void registerFactory() {
 			gSVGGraphicsElementCreation["rect"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGRectElement>(aroot);
+				auto node = arena_make_shared<SVGRectElement>(aroot);
 				node->loadFromXmlIterator(iter);
 				return node;
 				};
@@ -551,10 +773,22 @@ namespace waavs {
 					geom.ry = fRx.calculatePixels(w);
 				}
 				fPath.addRoundRect(geom);
+
+				if (geom.w > 0 && geom.h > 0)
+				{
+					fNative.fRoundRect = geom;
+					fGeometryType = BL_GEOMETRY_TYPE_ROUND_RECT;
+				}
 			}
 			else if (fWidth.isSet() && fHeight.isSet())
 			{
 				fPath.addRect(geom.x, geom.y, geom.w, geom.h);
+
+				if (geom.w > 0 && geom.h > 0)
+				{
+					fNative.fRect = BLRect(geom.x, geom.y, geom.w, geom.h);
+					fGeometryType = BL_GEOMETRY_TYPE_RECTD;
+				}
 			}
 
 			// BUGBUG - fill-rule 
@@ -592,7 +826,7 @@ namespace waavs {
 	{
 		static void registerSingular() {
 			gShapeCreationMap["circle"] = [](IAmGroot* root, const XmlElement& elem) {
-				auto node = std::make_shared<SVGCircleElement>(root);
+				auto node = arena_make_shared<SVGCircleElement>(root);
 				node->loadFromXmlElement(elem);
 				return node;
 				};
@@ -600,7 +834,7 @@ namespace waavs {
 
 		static void registerFactory() {
 			gSVGGraphicsElementCreation["circle"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGCircleElement>(aroot);
+				auto node = arena_make_shared<SVGCircleElement>(aroot);
 				node->loadFromXmlIterator(iter);
 				return node;
 				};
@@ -637,6 +871,12 @@ namespace waavs {
 			geom.r = fR.calculatePixels(w, h, dpi);
 
 			fPath.addCircle(geom);
+
+			if (geom.r > 0)
+			{
+				fNative.fCircle = geom;
+				fGeometryType = BL_GEOMETRY_TYPE_CIRCLE;
+			}
 		}
 		
 		void loadVisualProperties(const XmlAttributeCollection& attrs) override
@@ -657,7 +897,7 @@ namespace waavs {
 	{
 		static void registerFactory() {
 			gShapeCreationMap["ellipse"] = [](IAmGroot* root, const XmlElement& elem) {
-				auto node = std::make_shared<SVGEllipseElement>(root);
+				auto node = arena_make_shared<SVGEllipseElement>(root);
 				node->loadFromXmlElement(elem);
 				return node;
 			};
@@ -695,6 +935,12 @@ namespace waavs {
 
 			fPath.addEllipse(geom);
 
+			if (geom.rx > 0 && geom.ry > 0)
+			{
+				fNative.fEllipse = geom;
+				fGeometryType = BL_GEOMETRY_TYPE_ELLIPSE;
+			}
+
 		}
 
 		void loadVisualProperties(const XmlAttributeCollection& attrs) override
@@ -713,11 +959,48 @@ namespace waavs {
 
 	};
 	
+	// parsePoints()
+	// Turn the 'points' of a polyline or polygon into a path,
+	// a batch of numbers at a time.  Returns the number of points.
+	static size_t parsePoints(const ByteSpan& pts, BLPath& apath)
+	{
+		static constexpr size_t kBatchPoints = 128;
+
+		ByteSpan points = pts;
+		BLPoint batch[kBatchPoints];
+		size_t total = 0;
+
+		while (points)
+		{
+			size_t na = parseNumberList(points, (double*)batch, kBatchPoints * 2);
+			size_t count = na / 2;
+			if (count == 0)
+				break;
+
+			if (total == 0)
+			{
+				apath.moveTo(batch[0]);
+				apath.polyTo(batch + 1, count - 1);
+			}
+			else {
+				apath.polyTo(batch, count);
+			}
+
+			total += count;
+
+			// A short batch means we ran out of numbers
+			if (na < kBatchPoints * 2)
+				break;
+		}
+
+		return total;
+	}
+
 	struct SVGPolylineElement : public SVGGeometryElement
 	{
 		static void registerFactory() {
 			gShapeCreationMap["polyline"] = [](IAmGroot* root, const XmlElement& elem) {
-				auto node = std::make_shared<SVGPolylineElement>(root);
+				auto node = arena_make_shared<SVGPolylineElement>(root);
 				node->loadFromXmlElement(elem);
 				return node;
 			};
@@ -731,28 +1014,11 @@ namespace waavs {
 			if (!pts)
 				return;
 			
-			ByteSpan points = pts;
-			
-			// Assume there's at least one point
-			// if not, then we should error out
-			// and mark this as not visible
-			BLPoint pt{};
-			if (!parseNextNumber(points, pt.x))
-				return;
-			if (!parseNextNumber(points, pt.y))
+			// There should be at least one point
+			if (parsePoints(pts, fPath) == 0)
 				return;
 
-			fPath.moveTo(pt);
-
-			while (points)
-			{
-				if (!parseNextNumber(points, pt.x))
-					break;
-				if (!parseNextNumber(points, pt.y))
-					break;
-
-				fPath.lineTo(pt);
-			}
+			fGeometryType = BL_GEOMETRY_TYPE_POLYLINED;
 
 			needsBinding(true);
 		}
@@ -773,7 +1039,7 @@ namespace waavs {
 		static void registerSingularNode()
 		{
 			gShapeCreationMap["polygon"] = [](IAmGroot* root, const XmlElement& elem) {
-				auto node = std::make_shared<SVGPolygonElement>(root);
+				auto node = arena_make_shared<SVGPolygonElement>(root);
 				node->loadFromXmlElement(elem);
 				return node;
 				};
@@ -781,7 +1047,7 @@ namespace waavs {
 
 		static void registerFactory() {
 			gSVGGraphicsElementCreation["polygon"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGPolygonElement>(aroot);
+				auto node = arena_make_shared<SVGPolygonElement>(aroot);
 				node->loadFromXmlIterator(iter);
 				return node;
 				};
@@ -797,25 +1063,16 @@ namespace waavs {
 			SVGGeometryElement::loadVisualProperties(attrs);
 
 			auto points = attrs.getAttribute("points");
+			if (!points)
+				return;
 
-			BLPoint pt{};
-			parseNextNumber(points, pt.x);
-			parseNextNumber(points, pt.y);
-
-
-			fPath.moveTo(pt);
-
-			while (points)
-			{
-				if (!parseNextNumber(points, pt.x))
-					break;
-				if (!parseNextNumber(points, pt.y))
-					break;
+			if (parsePoints(points, fPath) == 0)
+				return;
 
-				fPath.lineTo(pt);
-			}
 			fPath.close();
 
+			fGeometryType = BL_GEOMETRY_TYPE_POLYGOND;
+
 			needsBinding(true);
 		}
 		
@@ -831,7 +1088,7 @@ namespace waavs {
 	{
 		static void registerSingularNode() {
 			gShapeCreationMap["path"] = [](IAmGroot* root, const XmlElement& elem) {
-				auto node = std::make_shared<SVGPathElement>(root);
+				auto node = arena_make_shared<SVGPathElement>(root);
 				node->loadFromXmlElement(elem);
 				return node;
 			};
@@ -840,7 +1097,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["path"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGPathElement>(aroot);
+				auto node = arena_make_shared<SVGPathElement>(aroot);
 				node->loadFromXmlIterator(iter);
 				return node;
 			};
@@ -888,14 +1145,12 @@ namespace waavs {
 			if (!d)
 				return;
 			
-			auto success = blpathparser::parsePath(d, fPath);
+			auto success = loadPathData(d);
 			if (!success)
 			{
 				printf("loadSelfFromXmlElement - failed parsePath: %d\n", success);
 			}
 			
-			fPath.shrink();
-			
 			needsBinding(true);
 		}
 		//*/
@@ -912,7 +1167,7 @@ namespace waavs {
 		static void registerSingularNode()
 		{
 			gShapeCreationMap["use"] = [](IAmGroot* aroot, const XmlElement& elem) {
-				auto node = std::make_shared<SVGUseElement>(aroot);
+				auto node = arena_make_shared<SVGUseElement>(aroot);
 				node->loadFromXmlElement(elem);
 				return node;
 			};
@@ -921,7 +1176,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["use"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGUseElement>(aroot);
+				auto node = arena_make_shared<SVGUseElement>(aroot);
 				node->loadFromXmlIterator(iter);
 				return node;
 			};
@@ -1002,6 +1257,11 @@ namespace waavs {
 				if (fWrappedNode)
 				{
 					fWrappedNode->bindToGroot(groot);
+
+					// A change to it shows up here too
+					auto visual = std::dynamic_pointer_cast<SVGVisualNode>(fWrappedNode);
+					if (visual)
+						visual->fReferenced = true;
 				}
 			}
 			
@@ -1080,7 +1340,7 @@ namespace waavs {
 		static void registerSingularNode()
 		{
 			gShapeCreationMap["image"] = [](IAmGroot* aroot, const XmlElement& elem) {
-				auto node = std::make_shared<SVGImageNode>(aroot);
+				auto node = arena_make_shared<SVGImageNode>(aroot);
 				node->loadFromXmlElement(elem);
 				return node;
 			};
@@ -1089,7 +1349,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["image"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGImageNode>(aroot);
+				auto node = arena_make_shared<SVGImageNode>(aroot);
 				node->loadFromXmlIterator(iter);
 				return node;
 			};
@@ -1239,7 +1499,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["style"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGStyleNode>(aroot);
+				auto node = arena_make_shared<SVGStyleNode>(aroot);
 				node->loadFromXmlIterator(iter);
 				return node;
 			};
@@ -1375,7 +1635,7 @@ namespace waavs {
 	{
 		static void registerFactory() {
 			gShapeCreationMap["solidColor"] = [](IAmGroot* root, const XmlElement& elem) {
-				auto node = std::make_shared<SVGSolidColorElement>(root);
+				auto node = arena_make_shared<SVGSolidColorElement>(root);
 				node->loadFromXmlElement(elem);
 				return node;
 			};
@@ -1608,7 +1868,7 @@ namespace waavs {
 		static void registerSingularNode()
 		{
 			gShapeCreationMap["linearGradient"] = [](IAmGroot* aroot, const XmlElement& elem)  {
-				auto node = std::make_shared<SVGLinearGradient>(aroot);
+				auto node = arena_make_shared<SVGLinearGradient>(aroot);
 				node->loadFromXmlElement(elem);
 				return node;
 			};
@@ -1617,7 +1877,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["linearGradient"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGLinearGradient>(aroot);
+				auto node = arena_make_shared<SVGLinearGradient>(aroot);
 				node->loadFromXmlIterator(iter);
 				return node;
 			};
@@ -1720,7 +1980,7 @@ namespace waavs {
 		static void registerSingularNode()
 		{
 			gShapeCreationMap["radialGradient"] = [](IAmGroot* aroot, const XmlElement& elem) {
-				auto node = std::make_shared<SVGRadialGradient>(aroot);
+				auto node = arena_make_shared<SVGRadialGradient>(aroot);
 				node->loadFromXmlElement(elem);
 				return node;
 			};
@@ -1729,7 +1989,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["radialGradient"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGRadialGradient>(aroot);
+				auto node = arena_make_shared<SVGRadialGradient>(aroot);
 				node->loadFromXmlIterator(iter);
 				return node;
 			};
@@ -1811,7 +2071,7 @@ namespace waavs {
 		static void registerSingularNode()
 		{
 			gShapeCreationMap["conicGradient"] = [](IAmGroot* aroot, const XmlElement& elem) {
-				auto node = std::make_shared<SVGConicGradient>(aroot);
+				auto node = arena_make_shared<SVGConicGradient>(aroot);
 				node->loadFromXmlElement(elem);
 				return node;
 			};
@@ -1820,7 +2080,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["conicGradient"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGConicGradient>(aroot);
+				auto node = arena_make_shared<SVGConicGradient>(aroot);
 				node->loadFromXmlIterator(iter);
 				return node;
 			};
@@ -1923,7 +2183,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["symbol"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGSymbolNode>(aroot); 
+				auto node = arena_make_shared<SVGSymbolNode>(aroot); 
 				node->loadFromXmlIterator(iter); 
 				return node; 
 			};
@@ -1980,10 +2240,10 @@ namespace waavs {
 			//printf("SVGSymbolNode::loadSelfClosingNode: \n");
 			//printXmlElement(elem);
 
-			auto it = gShapeCreationMap.find(elem.name());
-			if (it != gShapeCreationMap.end())
+			auto factory = gShapeCreationMap.find(elem.name());
+			if (factory != nullptr)
 			{
-				auto node = it->second(root(), elem);
+				auto node = (*factory)(root(), elem);
 				addNode(node);
 			}
 
@@ -2016,7 +2276,7 @@ namespace waavs {
 		static void registerSingularNode()
 		{
 			gShapeCreationMap["title"] = [](IAmGroot* aroot, const XmlElement& elem) {
-				auto node = std::make_shared<SVGTitleNode>(aroot);
+				auto node = arena_make_shared<SVGTitleNode>(aroot);
 				node->loadFromXmlElement(elem);
 				node->visible(false);
 				
@@ -2028,7 +2288,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["title"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGTitleNode>(aroot);
+				auto node = arena_make_shared<SVGTitleNode>(aroot);
 				node->loadFromXmlIterator(iter);
 				node->visible(false);
 				
@@ -2051,7 +2311,7 @@ namespace waavs {
 			
 			// Create a text content node and 
 			// add it to our node set
-			auto node = std::make_shared<SVGTextContentNode>(root());
+			auto node = arena_make_shared<SVGTextContentNode>(root());
 			node->text(elem.data());
 			addNode(node);
 		}
@@ -2062,7 +2322,7 @@ namespace waavs {
 		static void registerSingularNode()
 		{
 			gShapeCreationMap["desc"] = [](IAmGroot* aroot, const XmlElement& elem) {
-				auto node = std::make_shared<SVGDescNode>(aroot);
+				auto node = arena_make_shared<SVGDescNode>(aroot);
 				node->loadFromXmlElement(elem);
 
 				return node;
@@ -2073,7 +2333,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["desc"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGDescNode>(aroot);
+				auto node = arena_make_shared<SVGDescNode>(aroot);
 				node->loadFromXmlIterator(iter);
 
 				return node;
@@ -2099,7 +2359,7 @@ namespace waavs {
 
 			// Create a text content node and 
 			// add it to our node set
-			auto node = std::make_shared<SVGTextContentNode>(root());
+			auto node = arena_make_shared<SVGTextContentNode>(root());
 			node->text(elem.data());
 			addNode(node);
 		}
@@ -2114,7 +2374,7 @@ namespace waavs {
 		static void registerSingularNode()
 		{
 			gShapeCreationMap["a"] = [](IAmGroot* aroot, const XmlElement& elem) {
-				auto node = std::make_shared<SVGAElement>(aroot);
+				auto node = arena_make_shared<SVGAElement>(aroot);
 				node->loadFromXmlElement(elem);
 				return node;
 			};
@@ -2124,7 +2384,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["a"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGAElement>(aroot);
+				auto node = arena_make_shared<SVGAElement>(aroot);
 				node->loadFromXmlIterator(iter);
 				return node;
 			};
@@ -2137,6 +2397,11 @@ namespace waavs {
 		SVGAElement(IAmGroot* aroot)
 			: SVGGraphicsElement(aroot) {}
 
+		bool cullingBounds(BLBox& bounds, double& strokeScale) const override
+		{
+			return groupCullingBounds(bounds, strokeScale);
+		}
+
 	};
 
 	//================================================
@@ -2149,7 +2414,7 @@ namespace waavs {
 		static void registerSingularNode()
 		{
 			gShapeCreationMap["mask"] = [](IAmGroot* aroot, const XmlElement& elem) {
-				auto node = std::make_shared<SVGMaskNode>(aroot);
+				auto node = arena_make_shared<SVGMaskNode>(aroot);
 				node->loadFromXmlElement(elem);
 				return node;
 			};
@@ -2159,7 +2424,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["mask"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGMaskNode>(aroot);
+				auto node = arena_make_shared<SVGMaskNode>(aroot);
 				node->loadFromXmlIterator(iter);
 				return node;
 			};
@@ -2200,7 +2465,7 @@ namespace waavs {
 		static void registerSingularNode()
 		{
 			gShapeCreationMap["g"] = [](IAmGroot* aroot, const XmlElement& elem) {
-				auto node = std::make_shared<SVGGElement>(aroot);
+				auto node = arena_make_shared<SVGGElement>(aroot);
 				node->loadFromXmlElement(elem);
 				return node;
 			};
@@ -2210,7 +2475,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["g"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGGElement>(aroot);
+				auto node = arena_make_shared<SVGGElement>(aroot);
 				node->loadFromXmlIterator(iter);
 				return node;
 			};
@@ -2224,7 +2489,13 @@ namespace waavs {
 		SVGGElement(IAmGroot* aroot)
 			: SVGGraphicsElement(aroot)
 		{
-			//fUseCacheIsolation = true;
+			// group opacity is drawn through a layer
+			fUseCacheIsolation = true;
+		}
+
+		bool cullingBounds(BLBox& bounds, double& strokeScale) const override
+		{
+			return groupCullingBounds(bounds, strokeScale);
 		}
 	
 
@@ -2239,7 +2510,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["foreignObject"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGForeignObjectElement>(aroot);
+				auto node = arena_make_shared<SVGForeignObjectElement>(aroot);
 				node->loadFromXmlIterator(iter);
 				return node;
 			};
@@ -2308,7 +2579,7 @@ namespace waavs {
 		static void registerSingularNode()
 		{
 			gShapeCreationMap["defs"] = [](IAmGroot* aroot, const XmlElement& elem) {
-				auto node = std::make_shared<SVGDefsNode>(aroot);
+				auto node = arena_make_shared<SVGDefsNode>(aroot);
 				node->loadFromXmlElement(elem);
 				//node->visible(false);
 				
@@ -2320,7 +2591,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["defs"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGDefsNode>(aroot);
+				auto node = arena_make_shared<SVGDefsNode>(aroot);
 				node->loadFromXmlIterator(iter);
 				//node->visible(false);
 				
@@ -2360,7 +2631,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["clipPath"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGClipPath>(aroot);
+				auto node = arena_make_shared<SVGClipPath>(aroot);
 				node->loadFromXmlIterator(iter);
 				return node;
 			};
@@ -2374,6 +2645,14 @@ namespace waavs {
 		{
 			isStructural(false);
 		}
+
+		// The document is going away, so nothing
+		// is using the mask anymore
+		~SVGClipPath() override
+		{
+			fVar.reset();
+			SurfacePool::global().recycle(fImage);
+		}
 		
 		const BLVar& getVariant() override
 		{
@@ -2387,16 +2666,16 @@ namespace waavs {
 			// if it's valid
 			if (extent.w > 0 && extent.h > 0)
 			{
-				fImage.create((int)floor((float)extent.w+0.5f), (int)floor((float)extent.h+0.5f), BL_FORMAT_A8);
+				SurfacePool::global().acquireExact(fImage, (int)floor((float)extent.w+0.5f), (int)floor((float)extent.h+0.5f), BL_FORMAT_A8);
 
 				// Draw our content into the image
 				{
 					IRenderSVG ctx(root()->fontHandler());
 					ctx.begin(fImage);
 
-					ctx.setCompOp(BL_COMP_OP_SRC_COPY);
+					ctx.blendMode(BL_COMP_OP_SRC_COPY);
 					ctx.clearAll();
-					ctx.setFillStyle(BLRgba32(0xffffffff));
+					ctx.fill(BLRgba32(0xffffffff));
 					ctx.translate(-extent.x, -extent.y);
 					draw(&ctx);
 					ctx.flush();
@@ -2420,7 +2699,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["switch"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGSwitchElement>(aroot);
+				auto node = arena_make_shared<SVGSwitchElement>(aroot);
 				node->loadFromXmlIterator(iter);
 				return node;
 			};
@@ -2465,7 +2744,7 @@ namespace waavs {
 		bool addNode(std::shared_ptr<SVGVisualNode> node) override
 		{
 			// If the node has a language attribute, add it to the language map
-			auto lang = node->getVisualProperty("systemLanguage");
+			auto lang = node->getVisualProperty(SVG_PROPERTY_SYSTEM_LANGUAGE);
 			if (lang) {
 				fLanguageNodes[lang->rawValue()] = node;
 			}
@@ -2490,7 +2769,7 @@ namespace waavs {
 		static void registerSingularNode()
 		{
 			gShapeCreationMap["pattern"] = [](IAmGroot* aroot, const XmlElement& elem) {
-				auto node = std::make_shared<SVGPatternNode>(aroot);
+				auto node = arena_make_shared<SVGPatternNode>(aroot);
 				node->loadFromXmlElement(elem);
 				return node;
 			};
@@ -2500,7 +2779,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["pattern"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGPatternNode>(aroot);
+				auto node = arena_make_shared<SVGPatternNode>(aroot);
 				node->loadFromXmlIterator(iter);
 				return node;
 			};
@@ -2732,13 +3011,15 @@ namespace waavs {
 				}
 
 				// create the backing buffer based on the specified sizes
-				fCachedImage.create(iWidth, iHeight, BL_FORMAT_PRGB32);
+				// It is shared with any pattern that references this one,
+				// so it is never handed back to the pool
+				SurfacePool::global().acquireExact(fCachedImage, iWidth, iHeight, BL_FORMAT_PRGB32);
 
 				// Render out content into the backing buffer
 				IRenderSVG ctx(groot->fontHandler());
 				ctx.begin(fCachedImage);
 				ctx.clearAll();
-				ctx.setCompOp(BL_COMP_OP_SRC_COPY);
+				ctx.blendMode(BL_COMP_OP_SRC_COPY);
 				ctx.noStroke();
 				//ctx.setTransform(fPatternTransform);
 				
@@ -2810,7 +3091,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["svg"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGSVGElement>(aroot);
+				auto node = arena_make_shared<SVGSVGElement>(aroot);
 				node->loadFromXmlIterator(iter);
 				return node;
 			};
@@ -2844,6 +3125,24 @@ namespace waavs {
 		}
 		
 		
+		// draw() translates by our x and y, after our transform
+		BLPoint toChildSpace(const BLPoint& pt) const override
+		{
+			BLPoint local = SVGGraphicsElement::toChildSpace(pt);
+			return BLPoint(local.x - fX, local.y - fY);
+		}
+
+		BLBox toChildSpace(const BLBox& box) const override
+		{
+			BLBox local = SVGGraphicsElement::toChildSpace(box);
+			return BLBox(local.x0 - fX, local.y0 - fY, local.x1 - fX, local.y1 - fY);
+		}
+
+		BLBox fromChildSpace(const BLBox& box) const override
+		{
+			return SVGGraphicsElement::fromChildSpace(BLBox(box.x0 + fX, box.y0 + fY, box.x1 + fX, box.y1 + fY));
+		}
+
 		void bindSelfToGroot(IAmGroot* groot) override
 		{
 			// We need to resolve the size of the user space
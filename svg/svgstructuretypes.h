@@ -1,6 +1,8 @@
 #pragma once
 
 
+#include <algorithm>
+#include <functional>
 #include <memory>
 #include <vector>
 #include <map>
@@ -11,8 +13,13 @@
 #include "maths.h"
 
 #include "svgdatatypes.h"
+#include "svgpropertyids.h"
+#include "svgelementids.h"
+#include "arena.h"
+#include "bvh.h"
 
 #include "irendersvg.h"
+#include "svglayercache.h"
 #include "uievent.h"
 
 
@@ -64,6 +71,7 @@ namespace waavs {
 
 namespace waavs {
     struct IAmGroot;    // forward declaration
+    struct SVGPathCache;
 
     struct SVGObject
     {
@@ -163,6 +171,8 @@ namespace waavs {
     // Interface Am Graphics Root (IAmGroot) 
     // Core interface to hold document level state, primarily
     // for the purpose of looking up nodes, but also for style sheets
+    struct SVGVisualNode;   // forward declaration
+
     struct IAmGroot
     {
         virtual std::shared_ptr<SVGViewable> getElementById(const ByteSpan& name) = 0;
@@ -185,6 +195,26 @@ namespace waavs {
         
         virtual double dpi() const = 0;
         virtual void dpi(const double d) = 0;
+
+        // Once a document is loaded, it can keep track of changes to
+        // its nodes, so that only the parts that changed are redrawn.
+        // A node calls nodeChanging() just before it changes.
+        virtual bool trackingChanges() const { return false; }
+        virtual void nodeChanging(SVGVisualNode* node) { ; }
+
+        // A count that goes up every time something in the document
+        // changes, so anything cached from drawing it knows to start over
+        virtual uint64_t changeCount() const { return 0; }
+
+        // A count of the changes that could show up anywhere, not just
+        // inside the containers above the node that changed.  That's a
+        // change to something a <use> refers to, or to something that 
+        // isn't in the drawn tree, like a gradient, or the contents of defs.
+        virtual uint64_t sharedChangeCount() const { return 0; }
+
+        // Where nodes share the paths parsed from the same path data,
+        // while the document is loading.  nullptr if there is nowhere.
+        virtual SVGPathCache* pathCache() { return nullptr; }
     };
 
 }
@@ -258,13 +288,33 @@ namespace waavs {
 
     };
 
-    static std::unordered_map<ByteSpan, std::function<std::shared_ptr<SVGVisualProperty>(const ByteSpan&)>> gSVGAttributeCreation;
-    static std::unordered_map<ByteSpan, std::function<std::shared_ptr<SVGVisualProperty>(IAmGroot* aroot, const XmlAttributeCollection&)>> gSVGPropertyCreation;
+    // Factories for visual properties, indexed by SVG_PROPERTY_ID
+    static std::function<std::shared_ptr<SVGVisualProperty>(const ByteSpan&)> gSVGAttributeCreation[SVG_PROPERTY_COUNT];
+    static std::function<std::shared_ptr<SVGVisualProperty>(IAmGroot* aroot, const XmlAttributeCollection&)> gSVGPropertyCreation[SVG_PROPERTY_COUNT];
     
 	static void registerSVGAttribute(const ByteSpan& name, std::function<std::shared_ptr<SVGVisualProperty>(const ByteSpan&)> func)
 	{
-		gSVGAttributeCreation[name] = func;
+        SVG_PROPERTY_ID id = svgPropertyId(name);
+        if (id == SVG_PROPERTY_INVALID)
+        {
+            printf("registerSVGAttribute, ERROR - UNKNOWN PROPERTY NAME: %s\n", toString(name).c_str());
+            return;
+        }
+        
+		gSVGAttributeCreation[id] = func;
 	}
+
+    static void registerSVGProperty(const ByteSpan& name, std::function<std::shared_ptr<SVGVisualProperty>(IAmGroot* aroot, const XmlAttributeCollection&)> func)
+    {
+        SVG_PROPERTY_ID id = svgPropertyId(name);
+        if (id == SVG_PROPERTY_INVALID)
+        {
+            printf("registerSVGProperty, ERROR - UNKNOWN PROPERTY NAME: %s\n", toString(name).c_str());
+            return;
+        }
+
+        gSVGPropertyCreation[id] = func;
+    }
     
 }
 
@@ -279,11 +329,29 @@ namespace waavs {
     // Most things, other than basic attribute type, will be a sub-class of this
     struct SVGVisualNode : public SVGViewable
     {
-        // Xml Node stuff
-        std::unordered_map<ByteSpan, std::shared_ptr<SVGVisualProperty>, ByteSpanHash> fVisualProperties{};
+        // Visual properties are held in a sparse slot array.  
+        // fVisualPropertyMask has a bit set for each SVG_PROPERTY_ID
+        // that is present, and fVisualProperties holds only those
+        // properties, in id order.  The slot for an id is the number 
+        // of bits set below it in the mask.
+        uint64_t fVisualPropertyMask{ 0 };
+        ArenaVector<std::shared_ptr<SVGVisualProperty>> fVisualProperties{};
 
         bool fIsStructural{ true };
 
+        // The container this node was added to.  The container 
+        // owns us, not the other way around.
+        SVGVisualNode* fParentNode{ nullptr };
+
+        // Set by the document while it's holding on to where we
+        // painted before a change, so it only does that once
+        bool fChangePending{ false };
+
+        // Goes up when this node, or anything below it, changes
+        uint64_t fSubtreeChanges{ 0 };
+
+        // Set when a <use> draws this node somewhere else as well
+        bool fReferenced{ false };
 
         BLMatrix2D fTransform{};
 		BLMatrix2D fTransformInverse{};
@@ -305,7 +373,7 @@ namespace waavs {
         {
             for (auto& prop : fVisualProperties)
             {
-                prop.second->update();
+                prop->update();
             }
         }
         
@@ -323,6 +391,9 @@ namespace waavs {
         bool isStructural() const { return fIsStructural; }
         void isStructural(bool aStructural) { fIsStructural = aStructural; }
 
+        SVGVisualNode* parentNode() const { return fParentNode; }
+        void parentNode(SVGVisualNode* aParent) { fParentNode = aParent; }
+
 
         void moveTo(double x, double y) override
         {
@@ -330,6 +401,10 @@ namespace waavs {
             // should move the frame??
             //fTransform.reset();
             fTransform.translate(x, y);
+
+            // keep the cached inverse in sync
+            fTransformInverse = fTransform;
+            fTransformInverse.invert();
         }
 
         bool contains(double x, double y) override
@@ -337,15 +412,10 @@ namespace waavs {
             BLPoint localPoint(x, y);
 
             // check to see if we have a transform property
-            // if we do, transform the points through that transform
-            // then check to see if the point is inside the transformed path
+            // if we do, transform the points through the inverse
+            // which was computed when the transform was loaded
             if (fHasTransform)
-            {
-                // get the inverse transform
-                auto inverse = fTransform;
-                inverse.invert();
-                localPoint = inverse.mapPoint(localPoint);
-            }
+                localPoint = fTransformInverse.mapPoint(localPoint);
 
 			return containsRect(frame(), localPoint);
         }
@@ -358,6 +428,146 @@ namespace waavs {
             return nullptr;
         }
 
+        // fillRule()
+        //
+        // The fill-rule that applies to this node.  Its own fill-rule
+        // property if it has one, otherwise the one it inherits.
+        BLFillRule fillRule(BLFillRule inherited) const
+        {
+            auto fr = getVisualProperty(SVG_PROPERTY_FILL_RULE);
+            if (nullptr == fr || !fr->isSet())
+                return inherited;
+
+            uint32_t value = 0;
+            if (fr->getVariant().toUInt32(&value) != BL_SUCCESS)
+                return inherited;
+
+            return (BLFillRule)value;
+        }
+
+        // hitTestPoint()
+        //
+        // Return the topmost node that the point falls on, or nullptr.
+        // 'pt' is in the coordinate space of our parent, and 'inheritedRule'
+        // is the fill-rule in effect in the parent.
+        // By default, fall back on nodeAt()
+        virtual SVGVisualNode* hitTestPoint(const BLPoint& pt, BLFillRule inheritedRule)
+        {
+            if (!visible())
+                return nullptr;
+
+            return nodeAt(pt.x, pt.y);
+        }
+
+        // hitTestRect()
+        //
+        // Add every node that might paint into 'area' to 'found', in
+        // document order.  'area' is in the coordinate space of our parent.
+        // The test is against bounding boxes, so it can include nodes
+        // that come close to the area without actually touching it.
+        virtual void hitTestRect(const BLBox& area, std::vector<SVGVisualNode*>& found)
+        {
+            if (!visible())
+                return;
+
+            BLBox bounds{};
+            double strokeScale = 1.0;
+            if (!cullingBounds(bounds, strokeScale))
+            {
+                BLRect fr = frame();
+                bounds = BLBox(fr.x, fr.y, fr.x + fr.w, fr.y + fr.h);
+            }
+
+            if (BoundsHierarchy::overlaps(bounds, area))
+                found.push_back(this);
+        }
+
+        // cullingBounds()
+        //
+        // The area this node might paint into, in the coordinate space
+        // of its parent.  This includes the node's own stroke-width, but
+        // not a stroke-width it inherits, since that isn't known until
+        // drawing time.  'strokeScale' is how much the node's transforms
+        // can enlarge an inherited stroke width.
+        // Return false if the area is not known, in which case the node
+        // will always be drawn.
+        virtual bool cullingBounds(BLBox& bounds, double& strokeScale) const
+        {
+            return false;
+        }
+
+        // fromChildSpace()
+        //
+        // Map a box from the coordinate space of our children into
+        // the coordinate space of our parent.  Nodes without children
+        // leave it alone.
+        virtual BLBox fromChildSpace(const BLBox& box) const
+        {
+            return box;
+        }
+
+        // childBoundsChanged()
+        // One of our children now paints somewhere else
+        virtual void childBoundsChanged() { ; }
+
+        // worldBounds()
+        //
+        // The area this node might paint into, in the coordinate space
+        // of the document.  Unlike cullingBounds(), this includes the
+        // stroke-width the node inherits, which is found by looking
+        // up through the containers.
+        // Return false if the area is not known.  That includes nodes
+        // that aren't drawn where they are, like the contents of defs,
+        // symbol, marker, clipPath, mask, or pattern, whose containers
+        // don't lead up to the document.
+        bool worldBounds(BLBox& bounds) const
+        {
+            double strokeScale = 1.0;
+            if (!cullingBounds(bounds, strokeScale))
+                return false;
+
+            if (!hasVisualProperty(SVG_PROPERTY_STROKE_WIDTH))
+            {
+                // the default stroke-width of 1, unless a container says otherwise
+                double padding = 2.0;
+                for (const SVGVisualNode* p = fParentNode; p != nullptr; p = p->fParentNode)
+                {
+                    if (p->hasVisualProperty(SVG_PROPERTY_STROKE_WIDTH))
+                    {
+                        padding = p->strokeCullingPadding();
+                        break;
+                    }
+                }
+
+                bounds = boxInflate(bounds, padding * strokeScale);
+            }
+
+            const SVGVisualNode* top = this;
+            for (const SVGVisualNode* p = fParentNode; p != nullptr; p = p->fParentNode)
+            {
+                bounds = p->fromChildSpace(bounds);
+                top = p;
+            }
+
+            return (nullptr != root()) && (dynamic_cast<const IAmGroot*>(top) == root());
+        }
+
+        // How far a stroke using this node's own stroke-width might reach
+        // beyond the geometry. Half the width, stretched by the default miter
+        // limit of 4, which covers joins as well.
+        double strokeCullingPadding() const
+        {
+            auto sw = getVisualProperty(SVG_PROPERTY_STROKE_WIDTH);
+            if (nullptr == sw || !sw->isSet())
+                return 0;
+
+            double w = 0;
+            if (sw->getVariant().toDouble(&w) != BL_SUCCESS)
+                return 0;
+
+            return std::abs(w) * 2.0;
+        }
+
         virtual void bindPropertiesToGroot(IAmGroot* groot)
         {
             // This requires lookups, so if we don't have a root()
@@ -426,7 +636,7 @@ namespace waavs {
             // Bind all the accumulated visual properties
 			for (auto& prop : fVisualProperties)
 			{
-				prop.second->bindToGroot(groot);
+				prop->bindToGroot(groot);
 			}
         }
         
@@ -437,14 +647,45 @@ namespace waavs {
             needsBinding(false);
         }
 
-        //std::shared_ptr<SVGVisualProperty> getVisualProperty(const std::string& name)
-        std::shared_ptr<SVGVisualProperty> getVisualProperty(const ByteSpan& name)
+        size_t visualPropertySlot(SVG_PROPERTY_ID id) const
+        {
+            return svg_popcount64(fVisualPropertyMask & ((1ull << id) - 1));
+        }
+        
+        bool hasVisualProperty(SVG_PROPERTY_ID id) const
+        {
+            return (fVisualPropertyMask & (1ull << id)) != 0;
+        }
+        
+        std::shared_ptr<SVGVisualProperty> getVisualProperty(SVG_PROPERTY_ID id) const
         {
-            auto it = fVisualProperties.find(name);
-            if (it != fVisualProperties.end())
-                return it->second;
+            if (!hasVisualProperty(id))
+                return nullptr;
 
-            return nullptr;
+            return fVisualProperties[visualPropertySlot(id)];
+        }
+        
+        std::shared_ptr<SVGVisualProperty> getVisualProperty(const ByteSpan& name) const
+        {
+            return getVisualProperty(svgPropertyId(name));
+        }
+
+        // Add a property, replacing any that's already 
+        // there with the same id
+        void setVisualProperty(SVG_PROPERTY_ID id, std::shared_ptr<SVGVisualProperty> prop)
+        {
+            if ((id == SVG_PROPERTY_INVALID) || (prop == nullptr))
+                return;
+            
+            size_t slot = visualPropertySlot(id);
+            if (hasVisualProperty(id))
+            {
+                fVisualProperties[slot] = prop;
+                return;
+            }
+
+            fVisualProperties.insert(fVisualProperties.begin() + slot, prop);
+            fVisualPropertyMask |= (1ull << id);
         }
 
         //
@@ -460,12 +701,23 @@ namespace waavs {
             if (!value)
                 return;
             
-            if (gSVGAttributeCreation.find(name) != gSVGAttributeCreation.end())
+            SVG_PROPERTY_ID id = svgPropertyId(name);
+            if ((id != SVG_PROPERTY_INVALID) && gSVGAttributeCreation[id])
             {
-                auto prop = gSVGAttributeCreation[name](value);
+                auto prop = gSVGAttributeCreation[id](value);
                 if (prop)
                 {
-                    fVisualProperties[name] = prop;
+                    // If the document is already loaded, this is a live 
+                    // change, so let the document know, and bind the 
+                    // new property, since binding is already done
+                    bool live = (nullptr != root()) && root()->trackingChanges();
+                    if (live)
+                        root()->nodeChanging(this);
+
+                    setVisualProperty(id, prop);
+
+                    if (live)
+                        prop->bindToGroot(root());
                 }
             }
         }
@@ -502,7 +754,7 @@ namespace waavs {
             
             // Run through the attributes passed in 
             // add them into our attributes 
-            for (auto& attr : attrCollection.fAttributes)
+            for (auto& attr : attrCollection.attributes())
             {
 				setAttribute(attr.first, attr.second);
             }
@@ -563,8 +815,8 @@ namespace waavs {
             // as additional context for attributes such as gradients
             // that might need that
             for (auto& prop : fVisualProperties) {
-				if (prop.second->autoDraw() && prop.second->isSet())
-                    prop.second->draw(ctx);
+				if (prop->autoDraw() && prop->isSet())
+                    prop->draw(ctx);
             }
         }
 
@@ -613,12 +865,78 @@ namespace waavs {
 
 
 namespace waavs {
+    //============================================================
+    // SVGElementFactoryTable
+    // Element factories, indexed by SVG_ELEMENT_ID.
+    // 
+    // Registration looks like assignment into a map:
+    //   gShapeCreationMap["rect"] = [](IAmGroot* root, const XmlElement& elem) {...};
+    // 
+    // Known element names land in a slot of a fixed array, so there
+    // is no allocation when the factories are registered, and finding
+    // the factory for a tag is a perfect hash plus an array index.  
+    // Names that are not in gSVGElementNames, such as extension 
+    // elements, are kept in a regular map.
+    //============================================================
+    template <typename FactoryFunc>
+    struct SVGElementFactoryTable
+    {
+        std::function<FactoryFunc> fFactories[SVG_ELEMENT_COUNT]{};
+        std::unordered_map<ByteSpan, std::function<FactoryFunc>, ByteSpanHash> fExtensions{};
+
+        // Return the factory slot for the name, creating
+        // it if necessary.  Used for registration.
+        std::function<FactoryFunc>& operator[](const ByteSpan& name)
+        {
+            SVG_ELEMENT_ID id = svgElementId(name);
+            if (id != SVG_ELEMENT_INVALID)
+                return fFactories[id];
+
+            return fExtensions[name];
+        }
+
+        // Return the factory registered for the name, or 
+        // nullptr if there isn't one.
+        const std::function<FactoryFunc>* find(const ByteSpan& name) const
+        {
+            SVG_ELEMENT_ID id = svgElementId(name);
+            if (id != SVG_ELEMENT_INVALID)
+                return fFactories[id] ? &fFactories[id] : nullptr;
+
+            if (fExtensions.empty())
+                return nullptr;
+
+            auto it = fExtensions.find(name);
+            if (it != fExtensions.end())
+                return &it->second;
+
+            return nullptr;
+        }
+    };
+
+    using SVGGraphicsElementFactory = std::shared_ptr<SVGVisualNode>(IAmGroot* aroot, XmlElementIterator& iter);
+    using SVGShapeFactory = std::shared_ptr<SVGVisualNode>(IAmGroot* root, const XmlElement& elem);
+
+    // There is a single instance of each table for the whole program, 
+    // rather than one per translation unit including this header
+    inline SVGElementFactoryTable<SVGGraphicsElementFactory>& svgGraphicsElementFactories()
+    {
+        static SVGElementFactoryTable<SVGGraphicsElementFactory> table{};
+        return table;
+    }
+
+    inline SVGElementFactoryTable<SVGShapeFactory>& svgShapeFactories()
+    {
+        static SVGElementFactoryTable<SVGShapeFactory> table{};
+        return table;
+    }
+
     // compound node creation dispatch - 'g', 'symbol', 'pattern', 'linearGradient', 'radialGradient', 'conicGradient', 'image', 'style', 'text', 'tspan', 'use'
-    static std::unordered_map<ByteSpan, std::function<std::shared_ptr<SVGVisualNode>(IAmGroot* aroot, XmlElementIterator& iter)>, ByteSpanHash> gSVGGraphicsElementCreation{};
+    static SVGElementFactoryTable<SVGGraphicsElementFactory>& gSVGGraphicsElementCreation = svgGraphicsElementFactories();
 
     // Geometry node creation dispatch
     // Creating from a singular element
-    static std::unordered_map<ByteSpan, std::function<std::shared_ptr<SVGVisualNode>(IAmGroot* root, const XmlElement& elem)>, ByteSpanHash> gShapeCreationMap{};
+    static SVGElementFactoryTable<SVGShapeFactory>& gShapeCreationMap = svgShapeFactories();
 }
 
 
@@ -637,21 +955,34 @@ namespace waavs {
 
 
         std::shared_ptr<SVGGraphicsElement> fParent{ nullptr };
-        std::vector<std::shared_ptr<SVGVisualNode>> fNodes{};
+        ArenaVector<std::shared_ptr<SVGVisualNode>> fNodes{};
 
         int buildState = BUILD_STATE_OPEN;
         
         // Dealing with a cached image
+        // When fUseCacheIsolation is set, and there is opacity, the
+        // group is drawn through an offscreen layer, kept in fLayer
         bool fUseCacheIsolation{ false };
         bool fImageIsCached{ false };
-        BLRect fBBox{};
         BLImage fCachedImage{};
-        double fOpacity{ 1.0 };
+        SVGLayer fLayer{};
+
+        // Spatial index over the culling bounds of the children
+        // Children whose bounds are not known are in fUnboundedChildren
+        // and are always drawn.
+        BoundsHierarchy fChildIndex{};
+        ArenaVector<uint32_t> fUnboundedChildren{};
+        double fChildStrokeScale{ 1.0 };
 
         
         SVGGraphicsElement(IAmGroot* aroot)
             :SVGVisualNode(aroot) {}
 
+        virtual ~SVGGraphicsElement()
+        {
+            SVGLayerCache::global().release(fLayer);
+        }
+
 
 		// Return a reference to the cached image if it exists
         // Function returns 'true' when the image cache is active
@@ -691,18 +1022,27 @@ namespace waavs {
             
             bindSelfToGroot(groot);
 
-            // Do the image cache thing if necessary
-            auto opacity = getVisualProperty("opacity");
-            if (opacity)
-            {
-                BLResult res = opacity->getVariant().toDouble(&fOpacity);
+            // Now that the children know their geometry
+            buildChildIndex();
 
-                if (fUseCacheIsolation)
-                {
-                    drawIntoCache();
-                }
+            // Whatever layer there was is out of date
+            SVGLayerCache::global().release(fLayer);
+        }
 
-            }
+        // groupOpacity()
+        // Looked up each time, as it can be changed once the 
+        // document is live
+        double groupOpacity() const
+        {
+            auto opacity = getVisualProperty(SVG_PROPERTY_OPACITY);
+            if (nullptr == opacity || !opacity->isSet())
+                return 1.0;
+
+            double value = 1.0;
+            if (opacity->getVariant().toDouble(&value) != BL_SUCCESS)
+                return 1.0;
+
+            return value;
         }
 
 
@@ -749,12 +1089,95 @@ namespace waavs {
         }
 
 
+        // toChildSpace()
+        // 
+        // Map from the coordinate space of our parent into 
+        // the coordinate space of our children
+        virtual BLPoint toChildSpace(const BLPoint& pt) const
+        {
+            if (fHasTransform)
+                return fTransformInverse.mapPoint(pt);
+
+            return pt;
+        }
+
+        virtual BLBox toChildSpace(const BLBox& box) const
+        {
+            if (fHasTransform)
+                return boxTransform(box, fTransformInverse);
+
+            return box;
+        }
+
+        BLBox fromChildSpace(const BLBox& box) const override
+        {
+            if (fHasTransform)
+                return boxTransform(box, fTransform);
+
+            return box;
+        }
+
+        // The bounds of the children feed into the index, and into
+        // our own bounds, so rebuild it
+        void childBoundsChanged() override
+        {
+            buildChildIndex();
+        }
+
+        // hitTestPoint()
+        //
+        // Use the child index to find only those children whose
+        // bounds contain the point, and try them from the top down
+        SVGVisualNode* hitTestPoint(const BLPoint& pt, BLFillRule inheritedRule) override
+        {
+            if (!visible())
+                return nullptr;
+
+            // Nodes without children, which draw themselves
+            if (fNodes.empty())
+                return SVGVisualNode::hitTestPoint(pt, inheritedRule);
+
+            BLPoint local = toChildSpace(pt);
+            BLFillRule rule = fillRule(inheritedRule);
+
+            std::vector<uint32_t> candidates(fUnboundedChildren.begin(), fUnboundedChildren.end());
+            fChildIndex.queryPoint(local.x, local.y, [&candidates](uint32_t idx) { candidates.push_back(idx); });
+            std::sort(candidates.begin(), candidates.end(), std::greater<uint32_t>());
+
+            for (auto idx : candidates)
+            {
+                auto anode = fNodes[idx]->hitTestPoint(local, rule);
+                if (anode != nullptr)
+                    return anode;
+            }
+
+            return nullptr;
+        }
+
+        void hitTestRect(const BLBox& area, std::vector<SVGVisualNode*>& found) override
+        {
+            if (!visible())
+                return;
+
+            if (fNodes.empty())
+                return SVGVisualNode::hitTestRect(area, found);
+
+            BLBox local = toChildSpace(area);
+
+            std::vector<uint32_t> candidates(fUnboundedChildren.begin(), fUnboundedChildren.end());
+            fChildIndex.query(local, [&candidates](uint32_t idx) { candidates.push_back(idx); });
+            std::sort(candidates.begin(), candidates.end());
+
+            for (auto idx : candidates)
+                fNodes[idx]->hitTestRect(local, found);
+        }
+
         // Find the topmost node at a given position
         SVGVisualNode* nodeAt(double x, double y) override
         {
             // traverse through windows in reverse order
             // return when one of them contains the mouse point
-            std::vector<std::shared_ptr<SVGVisualNode> >::reverse_iterator rit = fNodes.rbegin();
+            auto rit = fNodes.rbegin();
             for (rit = fNodes.rbegin(); rit != fNodes.rend(); ++rit)
             {
                 // if the node is not visible, skip it
@@ -790,42 +1213,279 @@ namespace waavs {
 			}
         }
         
+        // buildChildIndex()
+        //
+        // Gather up the culling bounds of the children, and build
+        // the spatial index that drawChildren() uses to skip over the
+        // ones that can't be seen.  This needs to be done again if
+        // the geometry of any of the children changes.
+        void buildChildIndex()
+        {
+            std::vector<BLBox> boxes{};
+            std::vector<uint32_t> ids{};
+            boxes.reserve(fNodes.size());
+            ids.reserve(fNodes.size());
+
+            fChildIndex.clear();
+            fUnboundedChildren.clear();
+            fChildStrokeScale = 1.0;
+
+            for (size_t i = 0; i < fNodes.size(); i++)
+            {
+                BLBox box{};
+                double strokeScale = 1.0;
+
+                if (fNodes[i]->cullingBounds(box, strokeScale))
+                {
+                    boxes.push_back(box);
+                    ids.push_back((uint32_t)i);
+                    fChildStrokeScale = std::max(fChildStrokeScale, strokeScale);
+                }
+                else {
+                    fUnboundedChildren.push_back((uint32_t)i);
+                }
+            }
+
+            fChildIndex.build(boxes, ids);
+        }
+
+        // groupCullingBounds()
+        //
+        // For containers that draw nothing but their children, the
+        // culling bounds are the bounds of the children, plus our own 
+        // stroke-width, which the children inherit.
+        bool groupCullingBounds(BLBox& bounds, double& strokeScale) const
+        {
+            if (fChildIndex.empty() || !fUnboundedChildren.empty())
+                return false;
+
+            bounds = boxInflate(fChildIndex.bounds(), strokeCullingPadding() * fChildStrokeScale);
+            strokeScale = fChildStrokeScale;
+
+            if (fHasTransform)
+            {
+                bounds = boxTransform(bounds, fTransform);
+                strokeScale *= transformScale(fTransform);
+            }
+
+            return true;
+        }
+
+        // visibleArea()
+        //
+        // The part of the drawing surface that can be seen, in the
+        // coordinate space of our children, with room for the stroke 
+        // width they inherit from the context.  Returns false if that
+        // can't be determined, in which case nothing should be culled.
+        bool visibleArea(IRenderSVG* ctx, BLBox& area) const
+        {
+            BLBox device{};
+            if (!ctx->cullingArea(device))
+                return false;
+
+            BLMatrix2D inverse{};
+            if (BLMatrix2D::invert(inverse, ctx->finalTransform()) != BL_SUCCESS)
+                return false;
+
+            area = boxTransform(device, inverse);
+            area = boxInflate(area, std::abs(ctx->strokeWidth()) * 2.0 * fChildStrokeScale);
+
+            return true;
+        }
+
         virtual void drawChildren(IRenderSVG* ctx)
         {
-			for (auto& node : fNodes) {
-				node->draw(ctx);
-			}
+            BLBox area{};
+
+            if (fChildIndex.empty() || !visibleArea(ctx, area))
+            {
+                for (auto& node : fNodes) {
+                    node->draw(ctx);
+                }
+
+                return;
+            }
+
+            // Only draw the children that touch the visible area
+            // keeping them in document order
+            BoundsHierarchy::QueryMarks marks(fNodes.size());
+            for (auto idx : fUnboundedChildren)
+                marks.set(idx);
+
+            fChildIndex.queryInOrder(area, marks.fBits, [this, ctx](uint32_t idx) {
+                fNodes[idx]->draw(ctx);
+                });
         }
         
-        virtual void drawIntoCache()
-        {
-            // get the bounding box to determine how big
-            // the cache should be
-            fBBox = frame();
-            int iWidth = (int)fBBox.w;
-            int iHeight = (int)fBBox.h;
-
-            // Create a new image with the same size as the bounding box
-            fCachedImage.create(iWidth, iHeight, BLFormat::BL_FORMAT_PRGB32);
-
-            // Create the drawing context to go with the cache
-            IRenderSVG cachectx(root()->fontHandler());
-            cachectx.begin(fCachedImage);
-            cachectx.clearAll();
-            //cachectx.fillAll(BLRgba32(0xFFffffffu));
-            cachectx.setCompOp(BL_COMP_OP_SRC_COPY);
-            cachectx.noStroke();
-            cachectx.translate(-fBBox.x, -fBBox.y);
-
-
-            // Render out content into the backing buffer
-            fImageIsCached = false;
-            SVGGraphicsElement::draw(&cachectx);
-            fImageIsCached = true;
-            
-            cachectx.flush();
+        // renderLayer()
+        //
+        // Draw ourselves, and our children, into 'img', with 'toLayer' 
+        // going from the coordinates of our children to the image.  The
+        // paint comes from 'ctx', but not the opacity, which is for 
+        // drawing the layer itself.
+        void renderLayer(IRenderSVG* ctx, BLImage& img, const BLMatrix2D& toLayer)
+        {
+            IRenderSVG layerctx(ctx->fontHandler());
+            layerctx.begin(img);
+            layerctx.clearAll();
+            layerctx.inheritStyle(*ctx);
+            layerctx.setTransform(toLayer);
+
+            drawSelf(&layerctx);
+            drawChildren(&layerctx);
+
+            layerctx.end();
         }
-        
+
+        // drawCachedLayer()
+        //
+        // Draw through the layer that covers 'area', in the coordinates
+        // of our children, rendering it again if it isn't good for 'scale'
+        // anymore.  Returns false if the layer can't be kept, in which
+        // case nothing has been drawn.
+        bool drawCachedLayer(IRenderSVG* ctx, const BLBox& area, double scale)
+        {
+            // Only changes inside this group, or changes that could
+            // be showing up anywhere, mean rendering it again
+            auto& cache = SVGLayerCache::global();
+            uint64_t changes = fSubtreeChanges + ((nullptr != root()) ? root()->sharedChangeCount() : 0);
+
+            BLVar fillStyle{};
+            BLVar strokeStyle{};
+            ctx->getFillStyle(fillStyle);
+            ctx->getStrokeStyle(strokeStyle);
+            uint64_t styleKey = ctx->inheritedStyleKey();
+
+            std::lock_guard<std::mutex> lk(fLayer.fLock);
+
+            bool current = !fLayer.fImage.empty() &&
+                fLayer.fChangeCount == changes &&
+                SVGLayerCache::scaleFits(fLayer.fScale, scale) &&
+                fLayer.fArea.x0 == area.x0 && fLayer.fArea.y0 == area.y0 &&
+                fLayer.fArea.x1 == area.x1 && fLayer.fArea.y1 == area.y1 &&
+                fLayer.fStyleKey == styleKey &&
+                fLayer.fFillStyle.equals(fillStyle) &&
+                fLayer.fStrokeStyle.equals(strokeStyle);
+
+            if (current)
+            {
+                cache.touch(fLayer);
+            }
+            else {
+                // The old image may have been drawn from earlier in 
+                // this frame, by a context that hasn't flushed yet
+                ctx->recycleAfterFlush(fLayer.fImage);
+
+                double layerScale = SVGLayerCache::bucketScale(scale);
+                double w = std::ceil((area.x1 - area.x0) * layerScale);
+                double h = std::ceil((area.y1 - area.y0) * layerScale);
+
+                if (w < 1 || h < 1 || w > SVGLayerCache::kMaxLayerSize || h > SVGLayerCache::kMaxLayerSize)
+                {
+                    cache.release(fLayer);
+                    return false;
+                }
+
+                size_t bytes = SurfacePool::surfaceBytes(SurfacePool::sizeClass((int)w), SurfacePool::sizeClass((int)h), BL_FORMAT_PRGB32);
+                if (!cache.reserve(fLayer, bytes))
+                    return false;
+
+                if (!SurfacePool::global().acquire(fLayer.fImage, (int)w, (int)h, BL_FORMAT_PRGB32))
+                {
+                    cache.release(fLayer);
+                    return false;
+                }
+
+                BLMatrix2D toLayer(layerScale, 0, 0, layerScale, -area.x0 * layerScale, -area.y0 * layerScale);
+                renderLayer(ctx, fLayer.fImage, toLayer);
+
+                fLayer.fPixels = BLSizeI((int)w, (int)h);
+                fLayer.fArea = area;
+                fLayer.fScale = layerScale;
+                fLayer.fChangeCount = changes;
+                fLayer.fFillStyle.assign(fillStyle);
+                fLayer.fStrokeStyle.assign(strokeStyle);
+                fLayer.fStyleKey = styleKey;
+            }
+
+            // The used part of the image is a whole number of
+            // pixels, so it can reach a little past the area
+            BLRect dst(fLayer.fArea.x0, fLayer.fArea.y0,
+                fLayer.fPixels.w / fLayer.fScale,
+                fLayer.fPixels.h / fLayer.fScale);
+            ctx->blitImage(dst, fLayer.fImage, BLRectI(0, 0, fLayer.fPixels.w, fLayer.fPixels.h));
+
+            return true;
+        }
+
+        // drawIsolated()
+        //
+        // When a layer can't be kept, render one just for this frame,
+        // covering only the part of the surface that can be seen.
+        bool drawIsolated(IRenderSVG* ctx)
+        {
+            BLBox device{};
+            if (!ctx->cullingArea(device))
+                return false;
+
+            int x0 = (int)std::floor(device.x0);
+            int y0 = (int)std::floor(device.y0);
+            int w = (int)std::ceil(device.x1) - x0;
+            int h = (int)std::ceil(device.y1) - y0;
+            if (w <= 0 || h <= 0)
+                return true;
+
+            BLMatrix2D toDevice = ctx->finalTransform();
+            BLMatrix2D fromMeta{};
+            if (BLMatrix2D::invert(fromMeta, ctx->metaTransform()) != BL_SUCCESS)
+                return false;
+
+            auto& pool = SurfacePool::global();
+            BLImage img{};
+            if (!pool.acquire(img, w, h, BL_FORMAT_PRGB32))
+                return false;
+
+            toDevice.postTranslate(-x0, -y0);
+            renderLayer(ctx, img, toDevice);
+
+            // Draw it where it goes on the surface
+            ctx->push();
+            ctx->setTransform(fromMeta);
+            ctx->blitImage(BLRect(x0, y0, w, h), img, BLRectI(0, 0, w, h));
+            ctx->pop();
+
+            // The context may not have drawn from it yet
+            ctx->recycleAfterFlush(img);
+
+            return true;
+        }
+
+        // drawLayer()
+        //
+        // Draw ourselves with group opacity, through a layer.
+        // Returns false if that can't be done.
+        bool drawLayer(IRenderSVG* ctx, double opacity)
+        {
+            // Nothing to see
+            if (opacity <= 0)
+                return true;
+
+            double scale = transformScale(ctx->finalTransform());
+            if (scale <= 0)
+                return false;
+
+            // The cached layer covers all of the children, 
+            // so their bounds must be known
+            if (!fChildIndex.empty() && fUnboundedChildren.empty())
+            {
+                BLBox area = boxInflate(fChildIndex.bounds(), std::abs(ctx->strokeWidth()) * 2.0 * fChildStrokeScale);
+                if (drawCachedLayer(ctx, area, scale))
+                    return true;
+            }
+
+            return drawIsolated(ctx);
+        }
+
         void draw(IRenderSVG *ctx) override
         {
             if (!visible())
@@ -833,15 +1493,14 @@ namespace waavs {
 
             ctx->push();
             
-            if (fUseCacheIsolation && fImageIsCached && !fCachedImage.empty())
+            applyAttributes(ctx);
+
+            bool layered = fUseCacheIsolation && ctx->useLayers() && !fNodes.empty();
+            double opacity = layered ? groupOpacity() : 1.0;
+
+            if (!layered || opacity >= 1.0 || !drawLayer(ctx, opacity))
             {
-                ctx->setGlobalAlpha(fOpacity);
-                ctx->blitImage(fBBox, fCachedImage);
-            }
-            else {
-                applyAttributes(ctx);
                 drawSelf(ctx);
-
                 drawChildren(ctx);
             }
             
@@ -857,6 +1516,7 @@ namespace waavs {
                 root()->addDefinition(node->id(), node);
             
             if (node->isStructural()) {
+                node->parentNode(this);
                 fNodes.push_back(node);
             }
 
@@ -867,10 +1527,10 @@ namespace waavs {
         {
             //printf("SVGGraphicsElement::loadSelfClosingNode: \n");
 
-            auto it = gShapeCreationMap.find(elem.name());
-            if (it != gShapeCreationMap.end())
+            auto factory = gShapeCreationMap.find(elem.name());
+            if (factory != nullptr)
             {
-                auto node = it->second(root(), elem);
+                auto node = (*factory)(root(), elem);
                 addNode(node);
             }
             else {
@@ -910,12 +1570,10 @@ namespace waavs {
             // then create a new node of that type and add it
             // to the list of nodes.
 			auto aname = elem.name();
-			auto it = gSVGGraphicsElementCreation.find(aname);
-            if (it != gSVGGraphicsElementCreation.end())
+			auto factory = gSVGGraphicsElementCreation.find(aname);
+            if (factory != nullptr)
             {
-                //auto& func = gSVGGraphicsElementCreation[aname];
-                //auto node = func(root(), iter);
-                auto node = it->second(root(), iter);
+                auto node = (*factory)(root(), iter);
                 addNode(node);
             }
             else {
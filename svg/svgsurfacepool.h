@@ -0,0 +1,207 @@
+#pragma once
+
+//
+// svgsurfacepool
+// A pool of images to draw into offscreen.
+//
+// Layers, isolated groups, clip paths, and patterns each draw into an
+// image of their own.  Creating those fresh every time, only to let go
+// of them right after, is a steady stream of large allocations.  The
+// SurfacePool keeps the images that are handed back, and hands them out
+// again for the next surface of the same format and size.
+//
+// acquire() rounds the size up to a multiple of kSizeStep, for those
+// who can draw into part of a bigger image.  That way, surfaces whose
+// sizes only differ by a few pixels, like the visible part of a group
+// while panning, share the same images.  acquireExact() is for those
+// who need the size they asked for.
+//
+// At most fMaxPooledBytes of idle images are held.  An image handed back
+// beyond that is let go.  The bytes handed out, and the peak of those
+// plus the ones held, are tracked.
+//
+// An image must only be handed back once nothing else refers to it,
+// including a drawing context that hasn't been flushed.  Its contents
+// are whatever was last drawn into it, so clear it before use.
+//
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "blend2d.h"
+
+
+namespace waavs
+{
+    struct SurfaceKey
+    {
+        uint32_t fFormat{ 0 };
+        int fWidth{ 0 };
+        int fHeight{ 0 };
+
+        bool operator==(const SurfaceKey& other) const { return fFormat == other.fFormat && fWidth == other.fWidth && fHeight == other.fHeight; }
+        bool operator!=(const SurfaceKey& other) const { return !(*this == other); }
+    };
+
+    struct SurfaceKeyHash
+    {
+        size_t operator()(const SurfaceKey& k) const noexcept
+        {
+            uint64_t h = (uint64_t)k.fFormat * 0x9E3779B97F4A7C15ull;
+            h ^= ((uint64_t)(uint32_t)k.fWidth + 0x632BE59BD9B4E019ull) + (h << 6) + (h >> 2);
+            h ^= ((uint64_t)(uint32_t)k.fHeight + 0x85EBCA77C2B2AE63ull) + (h << 6) + (h >> 2);
+            return (size_t)h;
+        }
+    };
+
+
+    struct SurfacePool
+    {
+        static constexpr int kSizeStep = 64;
+
+        std::mutex fLock{};
+        std::unordered_map<SurfaceKey, std::vector<BLImage>, SurfaceKeyHash> fFree{};
+        size_t fMaxPooledBytes{ 64 * 1024 * 1024 };
+
+        // Some statistics
+        size_t fAcquires{ 0 };
+        size_t fReuses{ 0 };
+        size_t fRecycled{ 0 };
+        size_t fDropped{ 0 };
+        size_t fBytesPooled{ 0 };
+        size_t fBytesInUse{ 0 };
+        size_t fPeakBytes{ 0 };
+
+
+        // The one pool shared by all documents and threads
+        static SurfacePool& global()
+        {
+            static SurfacePool* gSurfacePool = new SurfacePool();
+            return *gSurfacePool;
+        }
+
+        static int sizeClass(int n)
+        {
+            return ((n + kSizeStep - 1) / kSizeStep) * kSizeStep;
+        }
+
+        static size_t surfaceBytes(int w, int h, uint32_t format)
+        {
+            size_t depth = (format == BL_FORMAT_A8) ? 1 : 4;
+            return (size_t)w * (size_t)h * depth;
+        }
+
+        size_t maxPooledBytes() const { return fMaxPooledBytes; }
+        void maxPooledBytes(size_t bytes) { std::lock_guard<std::mutex> lk(fLock); fMaxPooledBytes = bytes; }
+
+        size_t peakBytes() { std::lock_guard<std::mutex> lk(fLock); return fPeakBytes; }
+        void resetPeak() { std::lock_guard<std::mutex> lk(fLock); fPeakBytes = fBytesInUse + fBytesPooled; }
+
+        // acquire()
+        // An image of at least w x h, in the size class that holds it
+        bool acquire(BLImage& img, int w, int h, BLFormat format)
+        {
+            return acquireExact(img, sizeClass(w), sizeClass(h), format);
+        }
+
+        // acquireExact()
+        // An image of exactly w x h
+        bool acquireExact(BLImage& img, int w, int h, BLFormat format)
+        {
+            if (w <= 0 || h <= 0)
+                return false;
+
+            SurfaceKey key{ (uint32_t)format, w, h };
+            size_t bytes = surfaceBytes(w, h, format);
+
+            {
+                std::lock_guard<std::mutex> lk(fLock);
+
+                fAcquires++;
+                fBytesInUse += bytes;
+
+                auto it = fFree.find(key);
+                if (it != fFree.end() && !it->second.empty())
+                {
+                    img = std::move(it->second.back());
+                    it->second.pop_back();
+                    fBytesPooled -= bytes;
+                    fReuses++;
+
+                    return true;
+                }
+
+                notePeak();
+            }
+
+            if (img.create(w, h, format) != BL_SUCCESS)
+            {
+                std::lock_guard<std::mutex> lk(fLock);
+                fBytesInUse -= bytes;
+
+                return false;
+            }
+
+            return true;
+        }
+
+        // recycle()
+        // Hand an image back, to be used again
+        void recycle(BLImage& img)
+        {
+            if (img.empty())
+                return;
+
+            SurfaceKey key{ img.format(), img.width(), img.height() };
+            size_t bytes = surfaceBytes(key.fWidth, key.fHeight, key.fFormat);
+
+            std::lock_guard<std::mutex> lk(fLock);
+
+            fBytesInUse -= std::min(bytes, fBytesInUse);
+
+            if (fBytesPooled + bytes > fMaxPooledBytes)
+            {
+                fDropped++;
+                img.reset();
+                return;
+            }
+
+            fFree[key].push_back(std::move(img));
+            img.reset();
+            fBytesPooled += bytes;
+            fRecycled++;
+        }
+
+        // discard()
+        // Let go of an image for good, when memory is tight
+        void discard(BLImage& img)
+        {
+            if (img.empty())
+                return;
+
+            size_t bytes = surfaceBytes(img.width(), img.height(), img.format());
+
+            std::lock_guard<std::mutex> lk(fLock);
+            fBytesInUse -= std::min(bytes, fBytesInUse);
+            img.reset();
+        }
+
+        // trim()
+        // Let go of all the idle images
+        void trim()
+        {
+            std::lock_guard<std::mutex> lk(fLock);
+            fFree.clear();
+            fBytesPooled = 0;
+        }
+
+    private:
+        // Called with fLock held
+        void notePeak()
+        {
+            fPeakBytes = std::max(fPeakBytes, fBytesInUse + fBytesPooled);
+        }
+    };
+}
@@ -51,7 +51,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["tspan"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGTSpanNode>(aroot);
+				auto node = arena_make_shared<SVGTSpanNode>(aroot);
 				node->loadFromXmlIterator(iter);
 				return node;
 				};
@@ -136,14 +136,14 @@ namespace waavs {
 		{
 			// Create a text content node and 
 			// add it to our node set
-			auto node = std::make_shared<SVGTextContentNode>(root());
+			auto node = arena_make_shared<SVGTextContentNode>(root());
 			node->text(elem.data());
 			addNode(node);
 		}
 
 		void loadSelfClosingNode(const XmlElement& elem) override
 		{
-			auto node = std::make_shared<SVGTSpanNode>(root());
+			auto node = arena_make_shared<SVGTSpanNode>(root());
 			node->fontSelection(fFontSelection);
 
 			node->loadFromXmlElement(elem);
@@ -156,7 +156,7 @@ namespace waavs {
 			auto& elem = *iter;
 			if ((*iter).tagName() == "tspan")
 			{
-				auto node = std::make_shared<SVGTSpanNode>(root());
+				auto node = arena_make_shared<SVGTSpanNode>(root());
 				node->fontSelection(fFontSelection);
 
 				node->loadFromXmlIterator(iter);
@@ -185,7 +185,7 @@ namespace waavs {
 		static void registerFactory()
 		{
 			gSVGGraphicsElementCreation["text"] = [](IAmGroot* aroot, XmlElementIterator& iter) {
-				auto node = std::make_shared<SVGTextNode>(aroot);
+				auto node = arena_make_shared<SVGTextNode>(aroot);
 				node->loadFromXmlIterator(iter);
 				return node;
 				};
@@ -281,7 +281,7 @@ namespace waavs {
 		{
 			// Create a text content node and 
 			// add it to our node set
-			auto node = std::make_shared<SVGTextContentNode>(root());
+			auto node = arena_make_shared<SVGTextContentNode>(root());
 			node->text(elem.data());
 			addNode(node);
 		}
@@ -289,7 +289,7 @@ namespace waavs {
 		// Typically a TSpan with no content?
 		void loadSelfClosingNode(const XmlElement& elem) override
 		{
-			auto node = std::make_shared<SVGTSpanNode>(root());
+			auto node = arena_make_shared<SVGTSpanNode>(root());
 			node->fontSelection(fFontSelection);
 
 			node->loadFromXmlElement(elem);
@@ -303,7 +303,7 @@ namespace waavs {
 			auto& elem = *iter;
 			if ((*iter).tagName() == "tspan")
 			{
-				auto node = std::make_shared<SVGTSpanNode>(root());
+				auto node = arena_make_shared<SVGTSpanNode>(root());
 				node->fontSelection(fFontSelection);
 
 				node->loadFromXmlIterator(iter);
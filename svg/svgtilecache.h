@@ -0,0 +1,378 @@
+#pragma once
+
+//
+// svgtilecache
+// A cache of rendered tiles of a document, for interactive pan and zoom.
+//
+// Redrawing the entire document every time the mouse moves is too slow
+// for large documents.  The TileCache keeps rendered pieces of the
+// document around, and puts the view together from those pieces.
+//
+// Tiles are kept in a pyramid of levels.  At level L, one unit of the
+// document covers 2^L pixels, and the document is cut up into square
+// tiles of fTileSize pixels.  A tile is identified by (level, x, y).
+//
+// When a view is drawn:
+//  - The level closest to the view's scale is selected
+//  - Tiles of that level that are already rendered are simply drawn,
+//    through the view's transform.  So panning mostly reuses tiles.
+//  - For a tile that isn't there yet, the closest coarser tile that is
+//    available is scaled up and drawn in its place (or the finer tiles,
+//    when zooming out), and the missing tile is rendered in the background.
+//  - When background tiles arrive, hasNewTiles() reports true, and the
+//    view should be drawn again.
+//
+// The tiles are kept in least recently used order, and the oldest ones
+// are dropped when the total size goes over the memory budget.
+//
+
+#include <atomic>
+#include <cmath>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "svgdocument.h"
+#include "svgtiledrenderer.h"
+#include "workpool.h"
+
+
+namespace waavs
+{
+    struct TileKey
+    {
+        int fLevel{ 0 };
+        int fX{ 0 };
+        int fY{ 0 };
+
+        bool operator==(const TileKey& other) const { return fLevel == other.fLevel && fX == other.fX && fY == other.fY; }
+        bool operator!=(const TileKey& other) const { return !(*this == other); }
+    };
+
+    struct TileKeyHash
+    {
+        size_t operator()(const TileKey& k) const noexcept
+        {
+            uint64_t h = (uint64_t)(uint32_t)k.fLevel * 0x9E3779B97F4A7C15ull;
+            h ^= ((uint64_t)(uint32_t)k.fX + 0x632BE59BD9B4E019ull) + (h << 6) + (h >> 2);
+            h ^= ((uint64_t)(uint32_t)k.fY + 0x85EBCA77C2B2AE63ull) + (h << 6) + (h >> 2);
+            return (size_t)h;
+        }
+    };
+
+
+    struct TileCache
+    {
+        static constexpr int kMaxCoarserLevels = 6;
+        static constexpr int kMinLevel = -16;
+        static constexpr int kMaxLevel = 16;
+
+        struct TileEntry {
+            BLImage fImage{};
+            std::list<TileKey>::iterator fLRUPos{};
+        };
+
+        FontHandler* fFontHandler{ nullptr };
+        int fTileSize{ 256 };
+        size_t fBudgetBytes{ 256 * 1024 * 1024 };
+
+        std::shared_ptr<SVGDocument> fDocument{};
+        uint64_t fGeneration{ 0 };
+
+        // Everything below is guarded by fLock
+        std::mutex fLock{};
+        std::unordered_map<TileKey, TileEntry, TileKeyHash> fTiles{};
+        std::list<TileKey> fLRU{};                  // most recently used at the front
+        std::unordered_set<TileKey, TileKeyHash> fInFlight{};
+        std::unordered_set<TileKey, TileKeyHash> fWanted{};
+        size_t fBytesUsed{ 0 };
+
+        // Some statistics
+        size_t fHits{ 0 };
+        size_t fMisses{ 0 };
+        size_t fEvictions{ 0 };
+
+        std::atomic<bool> fHasNewTiles{ false };
+
+        // The pool is declared last, so it is destroyed first, and
+        // its threads are gone before anything they touch
+        WorkStealingPool fPool;
+
+
+        // A thread count of 0 means one per hardware thread
+        TileCache(FontHandler* fh, size_t budgetBytes = 256 * 1024 * 1024, int tileSize = 256, size_t threadCount = 0)
+            : fFontHandler(fh)
+            , fTileSize(tileSize > 0 ? tileSize : 256)
+            , fBudgetBytes(budgetBytes)
+            , fPool(threadCount)
+        {}
+
+        ~TileCache()
+        {
+            // Let tiles in progress finish before we go away
+            {
+                std::lock_guard<std::mutex> lk(fLock);
+                fWanted.clear();
+            }
+            fPool.wait();
+        }
+
+        size_t bytesUsed() { std::lock_guard<std::mutex> lk(fLock); return fBytesUsed; }
+        size_t budget() const { return fBudgetBytes; }
+        void budget(size_t bytes) { std::lock_guard<std::mutex> lk(fLock); fBudgetBytes = bytes; evictOverBudget(); }
+
+        // Whether any tiles have arrived since the last time this was asked
+        bool hasNewTiles() { return fHasNewTiles.exchange(false); }
+
+        // document()
+        // Set the document to be drawn, which throws away all the tiles
+        // of the previous document.
+        void document(std::shared_ptr<SVGDocument> doc)
+        {
+            {
+                std::lock_guard<std::mutex> lk(fLock);
+                fWanted.clear();
+            }
+
+            // Wait for tiles of the old document that are in progress
+            fPool.wait();
+
+            std::lock_guard<std::mutex> lk(fLock);
+
+            fGeneration++;
+            fDocument = doc;
+            fTiles.clear();
+            fLRU.clear();
+            fInFlight.clear();
+            fBytesUsed = 0;
+
+            if (nullptr != fDocument)
+                TiledRenderer::prepareDocument(fFontHandler, fDocument.get());
+        }
+
+        // Throw away all the tiles, when the document changes
+        void invalidate()
+        {
+            document(fDocument);
+        }
+
+        // levelForScale()
+        // The pyramid level whose resolution is closest to the scale
+        static int levelForScale(double scale)
+        {
+            if (scale <= 0)
+                return 0;
+
+            int level = (int)std::floor(std::log2(scale) + 0.5);
+            return std::max(kMinLevel, std::min(kMaxLevel, level));
+        }
+
+        // draw()
+        //
+        // Draw the view, 'w' by 'h' pixels, of the document seen through
+        // 'view', using whatever tiles are available, and ask for
+        // the ones that are missing.
+        void draw(IRenderSVG* ctx, const BLMatrix2D& view, double w, double h)
+        {
+            if (nullptr == fDocument)
+                return;
+
+            BLMatrix2D inverse{};
+            if (BLMatrix2D::invert(inverse, view) != BL_SUCCESS)
+                return;
+
+            int level = levelForScale(transformScale(view));
+            double tileUnits = tileSizeInUnits(level);
+
+            // The part of the document that can be seen
+            BLBox area = boxTransform(BLBox(0, 0, w, h), inverse);
+            int tx0 = (int)std::floor(area.x0 / tileUnits);
+            int ty0 = (int)std::floor(area.y0 / tileUnits);
+            int tx1 = (int)std::floor(area.x1 / tileUnits);
+            int ty1 = (int)std::floor(area.y1 / tileUnits);
+
+            ctx->push();
+            ctx->setTransform(view);
+
+            std::unique_lock<std::mutex> lk(fLock);
+            fWanted.clear();
+
+            for (int ty = ty0; ty <= ty1; ty++)
+            {
+                for (int tx = tx0; tx <= tx1; tx++)
+                {
+                    TileKey key{ level, tx, ty };
+
+                    BLImage img{};
+                    if (findTile(key, img))
+                    {
+                        fHits++;
+                        blitTile(ctx, key, img, BLRectI(0, 0, fTileSize, fTileSize));
+                        continue;
+                    }
+
+                    fMisses++;
+                    fWanted.insert(key);
+                    requestTile(key);
+
+                    drawStandIn(ctx, key);
+                }
+            }
+
+            lk.unlock();
+
+            ctx->pop();
+        }
+
+    private:
+        // The size of a tile at a level, in document units
+        double tileSizeInUnits(int level) const
+        {
+            return (double)fTileSize / std::ldexp(1.0, level);
+        }
+
+        static int floorDiv(int a, int b)
+        {
+            int q = a / b;
+            if ((a % b != 0) && ((a < 0) != (b < 0)))
+                q--;
+            return q;
+        }
+
+        // Look up a tile, and mark it as recently used
+        bool findTile(const TileKey& key, BLImage& img)
+        {
+            auto it = fTiles.find(key);
+            if (it == fTiles.end())
+                return false;
+
+            fLRU.splice(fLRU.begin(), fLRU, it->second.fLRUPos);
+            img = it->second.fImage;
+
+            return true;
+        }
+
+        // Draw part of a tile image where the tile 'key' belongs in the document
+        void blitTile(IRenderSVG* ctx, const TileKey& key, const BLImage& img, const BLRectI& src)
+        {
+            double units = tileSizeInUnits(key.fLevel);
+            double scale = units / fTileSize;
+
+            BLRect dst(key.fX * units + src.x * scale, key.fY * units + src.y * scale, src.w * scale, src.h * scale);
+            ctx->blitImage(dst, img, src);
+        }
+
+        // drawStandIn()
+        // Something to show while a tile is being rendered.  Either part
+        // of a coarser tile, stretched, or the four finer tiles, shrunk.
+        void drawStandIn(IRenderSVG* ctx, const TileKey& key)
+        {
+            for (int up = 1; up <= kMaxCoarserLevels && key.fLevel - up >= kMinLevel; up++)
+            {
+                int factor = 1 << up;
+                TileKey coarse{ key.fLevel - up, floorDiv(key.fX, factor), floorDiv(key.fY, factor) };
+
+                BLImage img{};
+                if (!findTile(coarse, img))
+                    continue;
+
+                // The part of the coarse tile that covers our tile
+                int sub = fTileSize / factor;
+                if (sub < 1)
+                    break;
+
+                BLRectI src((key.fX - coarse.fX * factor) * sub, (key.fY - coarse.fY * factor) * sub, sub, sub);
+                blitTile(ctx, coarse, img, src);
+                return;
+            }
+
+            // Try the finer level, which is there when zooming out
+            if (key.fLevel + 1 <= kMaxLevel)
+            {
+                for (int j = 0; j < 2; j++)
+                {
+                    for (int i = 0; i < 2; i++)
+                    {
+                        TileKey fine{ key.fLevel + 1, key.fX * 2 + i, key.fY * 2 + j };
+                        BLImage img{};
+                        if (findTile(fine, img))
+                            blitTile(ctx, fine, img, BLRectI(0, 0, fTileSize, fTileSize));
+                    }
+                }
+            }
+        }
+
+        // requestTile()
+        // Queue up a tile to be rendered in the background
+        void requestTile(const TileKey& key)
+        {
+            if (fInFlight.count(key) > 0)
+                return;
+
+            fInFlight.insert(key);
+
+            std::shared_ptr<SVGDocument> doc = fDocument;
+            uint64_t generation = fGeneration;
+
+            fPool.submit([this, doc, key, generation]() {
+                renderTile(doc, key, generation);
+                });
+        }
+
+        void renderTile(std::shared_ptr<SVGDocument> doc, const TileKey& key, uint64_t generation)
+        {
+            // If the view has moved on by the time we get to this
+            // tile, don't bother rendering it
+            {
+                std::lock_guard<std::mutex> lk(fLock);
+                if (generation != fGeneration || fWanted.count(key) == 0)
+                {
+                    fInFlight.erase(key);
+                    return;
+                }
+            }
+
+            BLImage img(fTileSize, fTileSize, BL_FORMAT_PRGB32);
+
+            BLMatrix2D tm = BLMatrix2D::makeScaling(std::ldexp(1.0, key.fLevel));
+            tm.postTranslate(-(double)key.fX * fTileSize, -(double)key.fY * fTileSize);
+
+            IRenderSVG ctx(fFontHandler);
+            ctx.begin(img);
+            ctx.clearAll();
+            ctx.setTransform(tm);
+            doc->draw(&ctx);
+            ctx.end();
+
+            std::lock_guard<std::mutex> lk(fLock);
+            fInFlight.erase(key);
+
+            if (generation != fGeneration)
+                return;
+
+            fLRU.push_front(key);
+            fTiles[key] = TileEntry{ img, fLRU.begin() };
+            fBytesUsed += tileBytes();
+
+            evictOverBudget();
+
+            fHasNewTiles = true;
+        }
+
+        size_t tileBytes() const { return (size_t)fTileSize * fTileSize * 4; }
+
+        // Drop the least recently used tiles until we're within budget
+        void evictOverBudget()
+        {
+            while (fBytesUsed > fBudgetBytes && !fLRU.empty())
+            {
+                TileKey oldest = fLRU.back();
+                fLRU.pop_back();
+                fTiles.erase(oldest);
+                fBytesUsed -= tileBytes();
+                fEvictions++;
+            }
+        }
+    };
+}
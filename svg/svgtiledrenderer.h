@@ -0,0 +1,159 @@
+#pragma once
+
+//
+// svgtiledrenderer
+// Render a document into a large image, one tile at a time, with the
+// tiles spread across a pool of threads.
+//
+// The normal way to draw a document is a single traversal into a single
+// IRenderSVG.  blend2d can spread the rasterization of that one context
+// across worker threads, but the traversal of the document, and the
+// path processing, still happen on one thread.
+//
+// The TiledRenderer splits the target into tiles, and gives each tile
+// its own IRenderSVG, and its own traversal of the document.  Since
+// containers cull the children that fall outside of the target, each
+// traversal only deals with what's in its own tile.
+//
+// Each tile's context draws straight into its part of the target
+// image's pixels, so there is no separate stitching step, and no copy.
+//
+// Drawing a document from several threads at once requires that drawing
+// not change the document.  A few things, markers and paint servers,
+// are bound lazily, the first time they're drawn.  prepare() does a
+// single threaded pass over the whole document to get all of that out
+// of the way.  render() calls it the first time it sees a document.
+//
+
+#include <memory>
+
+#include "svgdocument.h"
+#include "workpool.h"
+
+
+namespace waavs
+{
+    struct TiledRenderer
+    {
+        FontHandler* fFontHandler{ nullptr };
+        WorkStealingPool fPool;
+        int fTileSize{ 256 };
+
+        // The document that has been prepared for threaded drawing
+        std::weak_ptr<SVGDocument> fPreparedDoc{};
+
+
+        // A thread count of 0 means one per hardware thread
+        TiledRenderer(FontHandler* fh, size_t threadCount = 0, int tileSize = 256)
+            : fFontHandler(fh)
+            , fPool(threadCount)
+            , fTileSize(tileSize > 0 ? tileSize : 256)
+        {}
+
+        size_t threadCount() const { return fPool.threadCount(); }
+
+        int tileSize() const { return fTileSize; }
+        void tileSize(int sz) { if (sz > 0) fTileSize = sz; }
+
+        // prepare()
+        //
+        // Draw the whole document once, into a tiny image, on the
+        // calling thread, so that anything that binds lazily at draw
+        // time has done so before several threads draw at once.
+        void prepare(std::shared_ptr<SVGDocument> doc)
+        {
+            if (nullptr == doc)
+                return;
+
+            prepareDocument(fFontHandler, doc.get());
+
+            fPreparedDoc = doc;
+        }
+
+        // The part of prepare() that can be shared with anyone
+        // else who wants to draw a document from several threads
+        static void prepareDocument(FontHandler* fh, SVGDocument* doc)
+        {
+            BLRect fr = doc->frame();
+
+            BLImage scratch(16, 16, BL_FORMAT_PRGB32);
+            IRenderSVG ctx(fh);
+            ctx.begin(scratch);
+
+            // fit the whole document into the scratch image
+            // so nothing gets culled
+            if (fr.w > 0 && fr.h > 0)
+            {
+                ctx.scale(16.0 / fr.w, 16.0 / fr.h);
+                ctx.translate(-fr.x, -fr.y);
+            }
+
+            doc->draw(&ctx);
+            ctx.end();
+        }
+
+        // render()
+        //
+        // Draw the document into 'target', which must be a 32-bit image,
+        // using 'transform' to go from the document to the target.
+        // The target is not cleared first.
+        bool render(std::shared_ptr<SVGDocument> doc, BLImage& target, const BLMatrix2D& transform)
+        {
+            if (nullptr == doc)
+                return false;
+
+            BLImageData data{};
+            if (target.makeMutable(&data) != BL_SUCCESS)
+                return false;
+
+            if (data.format != BL_FORMAT_PRGB32 && data.format != BL_FORMAT_XRGB32)
+            {
+                printf("TiledRenderer::render: ERROR - target must be a 32-bit image\n");
+                return false;
+            }
+
+            if (fPreparedDoc.lock() != doc)
+                prepare(doc);
+
+            for (int y = 0; y < data.size.h; y += fTileSize)
+            {
+                for (int x = 0; x < data.size.w; x += fTileSize)
+                {
+                    int tw = std::min(fTileSize, data.size.w - x);
+                    int th = std::min(fTileSize, data.size.h - y);
+
+                    fPool.submit([this, doc, data, transform, x, y, tw, th]() {
+                        renderTile(doc.get(), data, transform, x, y, tw, th);
+                        });
+                }
+            }
+
+            fPool.wait();
+
+            return true;
+        }
+
+    private:
+        void renderTile(SVGDocument* doc, const BLImageData& data, const BLMatrix2D& transform, int x, int y, int w, int h)
+        {
+            // An image that shares the target's pixels for this tile
+            uint8_t* pixels = (uint8_t*)data.pixelData + ((intptr_t)y * data.stride) + ((intptr_t)x * 4);
+
+            BLImage tile{};
+            if (tile.createFromData(w, h, (BLFormat)data.format, pixels, data.stride) != BL_SUCCESS)
+                return;
+
+            // The tile's origin is at (x,y) of the target
+            BLMatrix2D tm = transform;
+            tm.postTranslate(-x, -y);
+
+            IRenderSVG ctx(fFontHandler);
+            ctx.begin(tile);
+            ctx.setTransform(tm);
+
+            doc->draw(&ctx);
+
+            ctx.end();
+        }
+    };
+}
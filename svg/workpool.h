@@ -0,0 +1,184 @@
+#pragma once
+
+//
+// workpool
+// A small work stealing thread pool.
+//
+// Each worker thread has its own queue of tasks.  A worker takes
+// tasks from the back of its own queue, and when that runs dry, it
+// steals from the front of the other workers' queues.  Tasks that
+// are handed out round robin, but turn out to be uneven in cost,
+// like tiles of a drawing, get balanced out between the workers
+// without a single shared queue everyone has to fight over.
+//
+// The threads are created once, and sleep when there's no work.
+//
+// Usage:
+//   WorkStealingPool pool(4);
+//   pool.submit([]() { doSomething(); });
+//   pool.submit([]() { doSomethingElse(); });
+//   pool.wait();
+//
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace waavs
+{
+    struct WorkStealingPool
+    {
+        using Task = std::function<void()>;
+
+        struct WorkQueue {
+            std::mutex fLock{};
+            std::deque<Task> fTasks{};
+        };
+
+        std::vector<std::thread> fThreads{};
+        std::vector<std::unique_ptr<WorkQueue>> fQueues{};
+
+        std::mutex fLock{};
+        std::condition_variable fWorkReady{};
+        std::condition_variable fWorkDone{};
+
+        std::atomic<size_t> fQueued{ 0 };       // tasks sitting in queues
+        size_t fPending{ 0 };                   // tasks not yet finished, guarded by fLock
+        size_t fNextQueue{ 0 };
+        bool fStopping{ false };
+
+
+        // A thread count of 0 means one per hardware thread
+        WorkStealingPool(size_t threadCount = 0)
+        {
+            if (threadCount == 0)
+                threadCount = std::thread::hardware_concurrency();
+            if (threadCount == 0)
+                threadCount = 1;
+
+            for (size_t i = 0; i < threadCount; i++)
+                fQueues.push_back(std::make_unique<WorkQueue>());
+
+            for (size_t i = 0; i < threadCount; i++)
+                fThreads.emplace_back([this, i]() { workerLoop(i); });
+        }
+
+        WorkStealingPool(const WorkStealingPool&) = delete;
+        WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+        ~WorkStealingPool()
+        {
+            {
+                std::lock_guard<std::mutex> lk(fLock);
+                fStopping = true;
+            }
+            fWorkReady.notify_all();
+
+            for (auto& t : fThreads)
+                t.join();
+        }
+
+        size_t threadCount() const { return fThreads.size(); }
+
+        // submit()
+        // Queue up a task.  Tasks are spread across the
+        // worker queues round robin.
+        void submit(Task task)
+        {
+            size_t qIdx = 0;
+            {
+                std::lock_guard<std::mutex> lk(fLock);
+                fPending++;
+                qIdx = fNextQueue;
+                fNextQueue = (fNextQueue + 1) % fQueues.size();
+            }
+
+            WorkQueue& q = *fQueues[qIdx];
+
+            {
+                std::lock_guard<std::mutex> lk(q.fLock);
+                q.fTasks.push_back(std::move(task));
+            }
+
+            {
+                std::lock_guard<std::mutex> lk(fLock);
+                fQueued++;
+            }
+            fWorkReady.notify_one();
+        }
+
+        // wait()
+        // Block until every task that has been submitted has finished
+        // Tasks still queued when the pool is destroyed are dropped, 
+        // so wait() before letting the pool go.
+        void wait()
+        {
+            std::unique_lock<std::mutex> lk(fLock);
+            fWorkDone.wait(lk, [this]() { return fPending == 0; });
+        }
+
+    private:
+        bool popLocal(size_t idx, Task& task)
+        {
+            WorkQueue& q = *fQueues[idx];
+            std::lock_guard<std::mutex> lk(q.fLock);
+            if (q.fTasks.empty())
+                return false;
+
+            task = std::move(q.fTasks.back());
+            q.fTasks.pop_back();
+            fQueued--;
+
+            return true;
+        }
+
+        bool steal(size_t idx, Task& task)
+        {
+            for (size_t n = 1; n < fQueues.size(); n++)
+            {
+                WorkQueue& q = *fQueues[(idx + n) % fQueues.size()];
+                std::lock_guard<std::mutex> lk(q.fLock);
+                if (q.fTasks.empty())
+                    continue;
+
+                task = std::move(q.fTasks.front());
+                q.fTasks.pop_front();
+                fQueued--;
+
+                return true;
+            }
+
+            return false;
+        }
+
+        void workerLoop(size_t idx)
+        {
+            while (true)
+            {
+                Task task{};
+
+                if (popLocal(idx, task) || steal(idx, task))
+                {
+                    task();
+
+                    std::lock_guard<std::mutex> lk(fLock);
+                    if (--fPending == 0)
+                        fWorkDone.notify_all();
+
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lk(fLock);
+                fWorkReady.wait(lk, [this]() { return fStopping || fQueued > 0; });
+                if (fStopping)
+                    return;
+            }
+        }
+    };
+}
@@ -31,6 +31,7 @@
 
 
 #include <unordered_map>
+#include <vector>
 #include <string>
 #include <sstream>
 #include <optional>
@@ -314,8 +315,7 @@ namespace waavs {
         beginattrValue = (uint8_t*)src.fStart;
 
         // Skip until end of the value.
-        while (src && *src != quote)
-            src++;
+        src.fStart = memscan_byte(src.fStart, src.fEnd, quote);
 
         if (src)
         {
@@ -532,8 +532,8 @@ namespace waavs {
         dataChunk = src;
         dataChunk.fEnd = src.fStart;
 
-        while (src && *src != '>')
-            src++;
+        // Skip over the body of the tag in bulk, looking for the closing '>'
+        src.fStart = memscan_byte(src.fStart, src.fEnd, '>');
 
         dataChunk.fEnd = src.fStart;
         dataChunk = chunk_rtrim(dataChunk, xmlwsp);
@@ -557,7 +557,6 @@ namespace waavs {
         value = {};
 
         static charset equalChars("=");
-        static charset quoteChars("\"'");
 
         bool start = false;
         bool end = false;
@@ -583,9 +582,8 @@ namespace waavs {
         auto attrNameChunk = chunk_token(src, equalChars);
         key = chunk_trim(attrNameChunk, xmlwsp);
 
-        // Skip stuff past '=' until we see one of our quoteChars
-        while (src && !quoteChars[*src])
-            src++;
+        // Skip stuff past '=' until we see one of our quote characters
+        src.fStart = memscan_byte2(src.fStart, src.fEnd, '"', '\'');
 
         // If we've run out of input, return false
         if (!src)
@@ -601,10 +599,9 @@ namespace waavs {
 
         // Skip anything that is not the quote character
         // to mark the end of the value
-        // don't use quoteChars here, because it's valid to 
+        // don't look for both quotes here, because it's valid to 
         // embed the other quote within the value
-        while (src && *src != quote)
-            src++;
+        src.fStart = memscan_byte(src.fStart, src.fEnd, quote);
 
         // If we still have input, it means we found
         // the quote character, so mark the end of the
@@ -690,35 +687,78 @@ namespace waavs {
 	//============================================================
     // XmlAttributeCollection
     // A collection of the attibutes found on an XmlElement
+    // 
+    // Most elements only have a handful of attributes, so rather 
+    // than a hash map, the attributes are held as a flat list of
+    // key/value span pairs.  The first kInlineAttributes of them are 
+    // stored directly in the collection, so scanning a typical 
+    // element does no heap allocation at all.  Only when an element 
+    // has more attributes than that do they spill over into a vector.
+    // 
+    // Lookups are a linear search, which for a handful of short
+    // keys is faster than hashing the key.
     //============================================================
-    
+    using XmlAttribute = std::pair<ByteSpan, ByteSpan>;
+
     struct XmlAttributeCollection
     {
-        //std::unordered_map<std::string, ByteSpan> fAttributes{};
-        std::unordered_map<ByteSpan, ByteSpan, ByteSpanHash> fAttributes{};
+        static constexpr size_t kInlineAttributes = 8;
+
+        XmlAttribute fInlineAttributes[kInlineAttributes]{};
+        std::vector<XmlAttribute> fOverflowAttributes{};
+        size_t fCount{ 0 };
         
+        // A range over the attributes, so they can be used
+        // in a range based for loop
+        struct AttributeRange {
+            const XmlAttribute* fBegin{ nullptr };
+            const XmlAttribute* fEnd{ nullptr };
+
+            const XmlAttribute* begin() const { return fBegin; }
+            const XmlAttribute* end() const { return fEnd; }
+            size_t size() const { return fEnd - fBegin; }
+        };
+
         XmlAttributeCollection() = default;
         XmlAttributeCollection(const XmlAttributeCollection& other)
-            :fAttributes(other.fAttributes)
-        {}
+        {
+            mergeProperties(other);
+        }
         
         XmlAttributeCollection(const ByteSpan& inChunk)
         {
             scanAttributes(inChunk);
         }
         
+        virtual ~XmlAttributeCollection() = default;
+
+        XmlAttributeCollection& operator=(const XmlAttributeCollection& other)
+        {
+            if (this != &other)
+            {
+                XmlAttributeCollection::clear();
+                mergeProperties(other);
+            }
+            return *this;
+        }
+
         // Return a const attribute collection
-	    //const std::unordered_map<std::string, ByteSpan>& attributes() const { return fAttributes; }
-        const std::unordered_map<ByteSpan, ByteSpan, ByteSpanHash>& attributes() const { return fAttributes; }
+        AttributeRange attributes() const { return { data(), data() + fCount }; }
+        const XmlAttribute* begin() const { return data(); }
+        const XmlAttribute* end() const { return data() + fCount; }
 
-		size_t size() const { return fAttributes.size(); }
+		size_t size() const { return fCount; }
         
-		virtual void clear() { fAttributes.clear(); }
+		virtual void clear() 
+        { 
+            fCount = 0; 
+            fOverflowAttributes.clear();
+        }
         
         // scanAttributes()
         // Given a chunk that contains attribute key value pairs
         // separated by whitespace, parse them, and store the key/value pairs 
-        // in the fAttributes map
+        // in the collection
         bool scanAttributes(const ByteSpan& inChunk)
         {
             ByteSpan src = inChunk;
@@ -727,50 +767,94 @@ namespace waavs {
 
             while (nextAttributeKeyValue(src, key, value))
             {
-                //std::string keyStr((const char*)key.fStart, key.size());
-                //fAttributes[keyStr] = value;
-                fAttributes[key] = value;
+                addAttribute(key, value);
             }
 
             return true;
         }
         
-        //bool hasAttribute(const std::string& inName) const
 		bool hasAttribute(const ByteSpan& inName) const
 		{
-			return fAttributes.find(inName) != fAttributes.end();
+			return findAttribute(inName) != nullptr;
 		}
 
         
 		// Add a single attribute to our collection of attributes
         // if the attribute already exists, replace its value
         // with the new value
-        //void addAttribute(const std::string& name, const ByteSpan& valueChunk)
 		void addAttribute(const ByteSpan& name, const ByteSpan& valueChunk)
 		{
-			fAttributes[name] = valueChunk;
+            XmlAttribute* existing = findAttribute(name);
+            if (existing != nullptr)
+            {
+                existing->second = valueChunk;
+                return;
+            }
+
+            if (fCount < kInlineAttributes)
+            {
+                fInlineAttributes[fCount] = { name, valueChunk };
+            }
+            else {
+                // Spill over into the vector.  The first time we
+                // do this, carry the inline attributes along, so 
+                // the whole set remains contiguous
+                if (fOverflowAttributes.empty())
+                    fOverflowAttributes.assign(fInlineAttributes, fInlineAttributes + kInlineAttributes);
+
+                fOverflowAttributes.push_back({ name, valueChunk });
+            }
+            
+            fCount++;
 		}
 
 
-        //ByteSpan getAttribute(const std::string& name) const
 		ByteSpan getAttribute(const ByteSpan& name) const
 		{
-			auto it = fAttributes.find(name);
-			if (it != fAttributes.end())
-				return it->second;
+            const XmlAttribute* attr = findAttribute(name);
+            if (attr != nullptr)
+                return attr->second;
+            
 			return {};
 		}
 
 
         XmlAttributeCollection & mergeProperties(const XmlAttributeCollection & other)
         {
-            for (auto& attr : other.fAttributes)
+            for (auto& attr : other.attributes())
             {
-            	fAttributes[attr.first] = attr.second;
+                addAttribute(attr.first, attr.second);
             }
             return *this;
         }
         
+    private:
+        const XmlAttribute* data() const 
+        { 
+            return fCount > kInlineAttributes ? fOverflowAttributes.data() : fInlineAttributes; 
+        }
+
+        XmlAttribute* data()
+        {
+            return fCount > kInlineAttributes ? fOverflowAttributes.data() : fInlineAttributes;
+        }
+
+        const XmlAttribute* findAttribute(const ByteSpan& name) const
+        {
+            const XmlAttribute* attrs = data();
+            for (size_t i = 0; i < fCount; i++)
+            {
+                if (attrs[i].first == name)
+                    return &attrs[i];
+            }
+            
+            return nullptr;
+        }
+
+        XmlAttribute* findAttribute(const ByteSpan& name)
+        {
+            return const_cast<XmlAttribute*>(static_cast<const XmlAttributeCollection*>(this)->findAttribute(name));
+        }
     };
 }
 
@@ -958,7 +1042,10 @@ namespace waavs {
                     // for next turn through iteration
                     st.fState = XML_ITERATOR_STATE_START_TAG;
 
-                    if (st.fSource != st.fMark)
+                    // Compare positions, not contents, as comparing the
+                    // contents of the rest of the source, for every tag
+                    // that follows right after another, is quadratic
+                    if (st.fSource.fStart != st.fMark.fStart)
                     {
                         // Encapsulate the content in a chunk
                         ByteSpan content = { st.fMark.fStart, st.fSource.fStart };
@@ -982,7 +1069,9 @@ namespace waavs {
                     st.fMark = st.fSource;
                 }
                 else {
-                    st.fSource++;
+                    // Skip the run of content up to the next '<'
+                    // in bulk, rather than a byte at a time
+                    st.fSource.fStart = memscan_byte(st.fSource.fStart, st.fSource.fEnd, '<');
                 }
             }
             break;
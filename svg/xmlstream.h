@@ -0,0 +1,353 @@
+#pragma once
+
+//
+// xmlstream
+// A resumable version of the xml scanner, for when the whole document
+// is not available in a single chunk.
+//
+// The XmlElementIterator in xmlscan.h wants the entire document as one
+// contiguous span.  When the xml is coming from a pipe, a socket, or a
+// decompressor, we'd like to start parsing as soon as the first bytes
+// show up.  The XmlStreamIterator accepts the input as a sequence of
+// buffers.  When it reaches the end of what it has been given, and
+// can't tell whether the next element is complete, it reports
+// XML_STREAM_NEED_MORE_INPUT, and picks up where it left off when the
+// next buffer is fed to it.
+//
+// An element is never returned until all of its bytes are present.
+// If an element straddles the boundary between two buffers, the
+// unfinished tail of the first buffer is carried over into the front
+// of the next one, so the spans in an element are always contiguous.
+//
+// Buffers are held in a std::shared_ptr<MemBuff>.  The iterator only
+// holds on to the buffer it is currently scanning.  The spans in an
+// element point into the buffer returned by backing(), so a caller
+// that wants to hold onto spans past the next feed() should hold onto
+// that buffer as well.  Once nobody holds a buffer any longer, it is
+// released.
+//
+// Usage:
+//   XmlStreamIterator iter;
+//   XmlElement elem;
+//
+//   while (readSomeBytes(chunk))
+//   {
+//       iter.feed(chunk);
+//       while (iter.next(elem) == XML_STREAM_ELEMENT)
+//           printXmlElement(elem);
+//   }
+//
+//   iter.finish();
+//   while (iter.next(elem) == XML_STREAM_ELEMENT)
+//       printXmlElement(elem);
+//
+
+#include <memory>
+
+#include "xmlscan.h"
+
+
+namespace waavs {
+    enum XML_STREAM_RESULT {
+        XML_STREAM_ELEMENT = 0          // an element was returned
+        , XML_STREAM_NEED_MORE_INPUT    // feed() more data, then call next() again
+        , XML_STREAM_END                // finish() was called, and everything has been returned
+    };
+
+    //============================================================
+    // xmlMarkupEnd()
+    //
+    // src starts just past a '<'.  Figure out where the markup that
+    // starts there ends, using the same terminators the scanner
+    // uses.  Returns false if the terminator is not within src, in
+    // which case we need more input before the markup can be read.
+    //
+    // resumeAt is how far into src has already been searched without
+    // finding the terminator.  When false is returned, it is updated
+    // so the next call, with more bytes, doesn't search them again.
+    //============================================================
+    static bool xmlMarkupEnd(const ByteSpan& src, const uint8_t*& markupEnd, size_t& resumeAt) noexcept
+    {
+        const uint8_t* start = src.fStart;
+        const uint8_t* end = src.fEnd;
+        size_t sz = src.size();
+
+        if (resumeAt > sz)
+            resumeAt = 0;
+
+        if (sz < 1)
+            return false;
+
+        if (*start == '!')
+        {
+            // We need enough bytes to tell which kind of
+            // declaration this is, before we can find its end
+            static const char* cdataPrefix = "![CDATA[";
+            static const char* commentPrefix = "!--";
+
+            if ((sz < 8) && (memcmp(start, cdataPrefix, sz) == 0))
+                return false;
+            if ((sz < 3) && (memcmp(start, commentPrefix, sz) == 0))
+                return false;
+
+            const char* terminator = nullptr;
+            if (chunk_starts_with_cstr(src, commentPrefix))
+                terminator = "-->";
+            else if (chunk_starts_with_cstr(src, cdataPrefix))
+                terminator = "]]>";
+
+            if (terminator != nullptr)
+            {
+                // back up far enough to catch a terminator
+                // that was split across the previous end
+                const uint8_t* found = memscan_str(start + resumeAt, end, (const uint8_t*)terminator, 3);
+                if (found == end)
+                {
+                    resumeAt = sz > 2 ? sz - 2 : 0;
+                    return false;
+                }
+
+                markupEnd = found + 3;
+                return true;
+            }
+
+            // A DOCTYPE with an internal subset ends with "]>",
+            // otherwise it ends at the first '>'.  The subset is
+            // searched from its '[' each time, they're never large.
+            const uint8_t* gt = memscan_byte(start + resumeAt, end, '>');
+            const uint8_t* bracket = memscan_byte(start + resumeAt, gt, '[');
+            if (bracket != gt)
+            {
+                resumeAt = bracket - start;
+
+                const uint8_t* found = memscan_str(bracket, end, (const uint8_t*)"]>", 2);
+                if (found == end)
+                    return false;
+
+                markupEnd = found + 2;
+                return true;
+            }
+
+            if (gt == end)
+            {
+                resumeAt = sz;
+                return false;
+            }
+
+            markupEnd = gt + 1;
+            return true;
+        }
+
+        const uint8_t* gt = memscan_byte(start + resumeAt, end, '>');
+        if (gt == end)
+        {
+            resumeAt = sz;
+            return false;
+        }
+
+        markupEnd = gt + 1;
+        return true;
+    }
+
+    //============================================================
+    // XmlStreamGenerator
+    //
+    // The resumable version of XmlElementGenerator.  It only lets the
+    // regular generator see as much of the source as is known to hold
+    // complete elements.  If the state is sitting on an incomplete
+    // element, and isFinal is false, XML_STREAM_NEED_MORE_INPUT is
+    // returned, and the state is left so that the same call can be
+    // made again once more input has been appended to the source.
+    //
+    // st.fMark is the start of the bytes that still need to be kept
+    // for the next turn.  scanned is how far past the '<' the search
+    // for the end of the markup has already gone, so an element that
+    // arrives over many buffers is only searched once.
+    //============================================================
+    static int XmlStreamGenerator(const XmlIteratorParams& params, XmlIteratorState& st, bool isFinal, XmlElement& elem, size_t& scanned)
+    {
+        elem.clear();
+
+        while (st.fSource)
+        {
+            const uint8_t* limit = st.fSource.fEnd;
+
+            if (!isFinal)
+            {
+                const uint8_t* tagStart = st.fSource.fStart;
+
+                if (st.fState == XML_ITERATOR_STATE_CONTENT)
+                {
+                    // Find the '<' that ends the current run of content
+                    // if there isn't one, we can't know how long the
+                    // content is yet
+                    const uint8_t* lt = memscan_byte(st.fSource.fStart, st.fSource.fEnd, '<');
+                    if (lt == st.fSource.fEnd)
+                    {
+                        st.fSource.fStart = lt;
+                        return XML_STREAM_NEED_MORE_INPUT;
+                    }
+
+                    // skip the content we've already looked at
+                    st.fSource.fStart = lt;
+                    tagStart = lt + 1;
+                }
+
+                if (!xmlMarkupEnd({ tagStart, st.fSource.fEnd }, limit, scanned))
+                    return XML_STREAM_NEED_MORE_INPUT;
+
+                scanned = 0;
+            }
+
+            // Run the regular generator, but don't let
+            // it see beyond the end of the complete element
+            XmlIteratorState limited = st;
+            limited.fSource.fEnd = limit;
+
+            elem = XmlElementGenerator(params, limited);
+
+            st.fState = limited.fState;
+            st.fSource.fStart = limited.fSource.fStart;
+            st.fMark = limited.fMark;
+
+            if (!elem.isEmpty())
+                return XML_STREAM_ELEMENT;
+        }
+
+        if (isFinal)
+            return XML_STREAM_END;
+
+        return XML_STREAM_NEED_MORE_INPUT;
+    }
+
+
+    //============================================================
+    // XmlStreamIterator
+    // Feeds successive buffers through the XmlStreamGenerator
+    //============================================================
+    struct XmlStreamIterator {
+    private:
+        XmlIteratorParams fParams{};
+        XmlIteratorState fState{};
+        std::shared_ptr<MemBuff> fBuffer{};
+        size_t fScanned{ 0 };
+        bool fIsFinal{ false };
+
+        // Where left over bytes are carried between buffers.  Its
+        // size is its capacity, fCarryUsed is how much is filled.
+        std::shared_ptr<MemBuff> fCarry{};
+        size_t fCarryUsed{ 0 };
+
+    public:
+        XmlStreamIterator(bool autoScanAttributes = false)
+        {
+            fParams.fAutoScanAttributes = autoScanAttributes;
+        }
+
+        // The buffer that backs the spans of the elements
+        // most recently returned from next()
+        std::shared_ptr<MemBuff> backing() const { return fBuffer; }
+
+        // Whether finish() has been called
+        bool isFinal() const { return fIsFinal; }
+
+        // feed()
+        // Hand a buffer over to the iterator.  If there are no left over
+        // bytes from the previous buffer, the buffer is used as is,
+        // without copying.  Otherwise, the new bytes are appended to the
+        // left over ones in the carry buffer.  The carry buffer grows by
+        // doubling, so an element that spans many buffers is copied a
+        // bounded number of times, rather than once per feed().
+        bool feed(std::shared_ptr<MemBuff> buff)
+        {
+            if (fIsFinal || (buff == nullptr))
+                return false;
+
+            if (buff->size() == 0)
+                return true;
+
+            ByteSpan leftover = { fState.fMark.fStart, fState.fSource.fEnd };
+            if (!fBuffer || (leftover.size() == 0))
+            {
+                fBuffer = buff;
+                ByteSpan src = fBuffer->span();
+                fState.fSource = src;
+                fState.fMark = src;
+
+                return true;
+            }
+
+            // If the left over bytes are the tail of the carry buffer,
+            // and there's room, append right after them.  Nothing that
+            // was already handed out moves.
+            if ((fBuffer == fCarry) &&
+                (fState.fSource.fEnd == fCarry->data() + fCarryUsed) &&
+                (fCarry->size() - fCarryUsed >= buff->size()))
+            {
+                memcpy(fCarry->data() + fCarryUsed, buff->data(), buff->size());
+                fCarryUsed += buff->size();
+                fState.fSource.fEnd += buff->size();
+
+                return true;
+            }
+
+            // Otherwise, carry the unfinished bytes over to the front
+            // of a new carry buffer, with room to spare, followed by
+            // the new data
+            size_t scanned = fState.fSource.fStart - fState.fMark.fStart;
+            size_t needed = leftover.size() + buff->size();
+
+            fCarry = std::make_shared<MemBuff>(needed * 2);
+            memcpy(fCarry->data(), leftover.fStart, leftover.size());
+            memcpy(fCarry->data() + leftover.size(), buff->data(), buff->size());
+            fCarryUsed = needed;
+
+            fBuffer = fCarry;
+            ByteSpan src = { fCarry->data(), fCarry->data() + fCarryUsed };
+            fState.fMark = src;
+            fState.fSource = src;
+            fState.fSource.fStart += scanned;
+
+            return true;
+        }
+
+        // feed()
+        // Copy the bytes of the span into a buffer we own.
+        // The caller is free to reuse their memory after this call.
+        bool feed(const ByteSpan& chunk)
+        {
+            if (!chunk)
+                return true;
+
+            auto buff = std::make_shared<MemBuff>();
+            buff->initFromSpan(chunk);
+
+            return feed(buff);
+        }
+
+        // finish()
+        // Indicate there is no more input coming.  Whatever
+        // is left will be returned by subsequent calls to next()
+        void finish() { fIsFinal = true; }
+
+        // next()
+        // Return the next element, if there is a complete one
+        int next(XmlElement& elem)
+        {
+            int result = XmlStreamGenerator(fParams, fState, fIsFinal, elem, fScanned);
+
+            // Once we're at the end, there's no reason
+            // to keep the buffers alive
+            if (result == XML_STREAM_END)
+            {
+                fBuffer = nullptr;
+                fCarry = nullptr;
+                fCarryUsed = 0;
+                fScanned = 0;
+                fState = {};
+            }
+
+            return result;
+        }
+    };
+}
@@ -0,0 +1,280 @@
+//
+// loadbench
+// What loading a document costs, with and without the arena.
+//
+// Each file is loaded a number of times, once with the document's
+// arena, and once without.  For each, the best time to load, and
+// the best time to tear the document down again, are reported in
+// milliseconds, along with the number of trips to the heap the
+// load took.
+//
+// The heap is counted by replacing the global operator new, so it
+// sees everything the C++ side allocates: nodes, properties, and
+// the containers inside them.  What blend2d allocates, for paths
+// and images, goes through its own allocator, and isn't counted.
+// The arena's own counters say how many of the allocations it took.
+//
+// With -rss, the files are instead loaded once each, and kept, the
+// way a gallery would hold them, and the peak resident size of the
+// process is reported after each one.  'copy' loads from a copy of
+// the source, letting go of the mapped file once loaded.  'owner'
+// loads straight from the mapped file, which the document keeps.
+// The peak only ever goes up, so run each way as its own process.
+// The pages of a mapped file count as resident once they've been
+// read, so the private bytes, which the system can't just drop and
+// read again from the file, are reported as well.
+//
+// Usage: loadbench [-n runs] <svg file>...
+//        loadbench -rss copy|owner <svg file>...
+//   loadbench -n 10 ..\..\gallery\*.svg
+//   loadbench -rss owner ..\..\gallery\*.svg
+//
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+#include "svg.h"
+#include "mappedfile.h"
+
+using namespace waavs;
+
+
+//============================================================
+// Counting every trip to the heap
+//============================================================
+static std::atomic<size_t> gNewCount{ 0 };
+static std::atomic<size_t> gNewBytes{ 0 };
+
+void* operator new(size_t sz)
+{
+    gNewCount++;
+    gNewBytes += sz;
+
+    void* p = ::malloc(sz ? sz : 1);
+    if (p == nullptr)
+        throw std::bad_alloc();
+
+    return p;
+}
+
+void operator delete(void* p) noexcept { ::free(p); }
+void operator delete(void* p, size_t) noexcept { ::free(p); }
+
+
+// Create one of these first, so factory constructor will run
+SVGFactory gSVG;
+
+FontHandler gFontHandler{};
+
+
+// The most memory the process has had resident at once
+static size_t peakResidentBytes()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (!::GetProcessMemoryInfo(::GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+
+    return counters.PeakWorkingSetSize;
+#else
+    struct rusage usage {};
+    if (::getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+
+#if defined(__APPLE__)
+    return (size_t)usage.ru_maxrss;
+#else
+    return (size_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+// How much of the process' memory is its own, rather than
+// pages of a file it has mapped
+static size_t privateBytes()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS_EX counters{};
+    if (!::GetProcessMemoryInfo(::GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&counters, sizeof(counters)))
+        return 0;
+
+    return counters.PrivateUsage;
+#else
+    // Linux only, elsewhere it's reported as 0
+    size_t kb = 0;
+    FILE* f = fopen("/proc/self/status", "r");
+    if (f == nullptr)
+        return 0;
+
+    char line[256];
+    while (fgets(line, sizeof(line), f) != nullptr)
+    {
+        if (sscanf(line, "RssAnon: %zu", &kb) == 1)
+            break;
+    }
+    fclose(f);
+
+    return kb * 1024;
+#endif
+}
+
+static double nowMillis()
+{
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+struct LoadStats
+{
+    double fLoadMs{ 1e30 };
+    double fFreeMs{ 1e30 };
+    size_t fHeapCount{ 0 };
+    size_t fHeapBytes{ 0 };
+    size_t fArenaCount{ 0 };
+    size_t fArenaBytes{ 0 };
+};
+
+static LoadStats measure(const ByteSpan& src, bool withArena, int runs)
+{
+    LoadStats stats{};
+
+    for (int i = 0; i < runs; i++)
+    {
+        auto doc = std::make_shared<SVGDocument>(&gFontHandler, 1920, 1080, 96);
+        doc->useArena(withArena);
+
+        size_t startCount = gNewCount;
+        size_t startBytes = gNewBytes;
+        double startTime = nowMillis();
+
+        doc->loadFromChunk(src);
+
+        stats.fLoadMs = std::min(stats.fLoadMs, nowMillis() - startTime);
+        stats.fHeapCount = gNewCount - startCount;
+        stats.fHeapBytes = gNewBytes - startBytes;
+
+        if (doc->arena() != nullptr)
+        {
+            stats.fArenaCount = doc->arena()->fAllocationCount;
+            stats.fArenaBytes = doc->arena()->fBytesAllocated;
+        }
+
+        startTime = nowMillis();
+        doc.reset();
+        stats.fFreeMs = std::min(stats.fFreeMs, nowMillis() - startTime);
+    }
+
+    return stats;
+}
+
+// Load every file, and keep them all, reporting the peak 
+// resident size of the process as it grows
+static void measurePeak(int argc, char** argv, int argi, bool withOwner)
+{
+    std::vector<std::shared_ptr<SVGDocument>> docs{};
+    size_t sourceBytes = 0;
+    size_t startPeak = peakResidentBytes();
+    size_t startPrivate = privateBytes();
+
+    printf("%-50s %12s %12s %12s %14s\n", withOwner ? "owner" : "copy", "file bytes", "peak bytes", "peak growth", "private growth");
+
+    for (; argi < argc; argi++)
+    {
+        const char* filename = argv[argi];
+
+        auto mapped = MappedFile::create_shared(filename);
+        if (mapped == nullptr)
+        {
+            printf("File not found: %s\n", filename);
+            continue;
+        }
+
+        ByteSpan src(mapped->data(), mapped->size());
+        sourceBytes += src.size();
+
+        if (withOwner)
+            docs.push_back(SVGDocument::createFromChunk(src, mapped, &gFontHandler, 1920, 1080, 96));
+        else
+            docs.push_back(SVGDocument::createFromChunk(src, &gFontHandler, 1920, 1080, 96));
+
+        size_t peak = peakResidentBytes();
+        printf("%-50s %12zu %12zu %12zu %14zd\n", filename, src.size(), peak, peak - startPeak, (ptrdiff_t)(privateBytes() - startPrivate));
+    }
+
+    size_t peak = peakResidentBytes();
+    printf("%-50s %12zu %12zu %12zu %14zd\n", "total", sourceBytes, peak, peak - startPeak, (ptrdiff_t)(privateBytes() - startPrivate));
+}
+
+int main(int argc, char** argv)
+{
+    int runs = 5;
+    int argi = 1;
+    const char* rssMode = nullptr;
+
+    if (argi + 1 < argc && strcmp(argv[argi], "-n") == 0)
+    {
+        runs = atoi(argv[argi + 1]);
+        argi += 2;
+    }
+    else if (argi + 1 < argc && strcmp(argv[argi], "-rss") == 0)
+    {
+        rssMode = argv[argi + 1];
+        argi += 2;
+    }
+
+    bool badMode = (rssMode != nullptr) && (strcmp(rssMode, "copy") != 0) && (strcmp(rssMode, "owner") != 0);
+
+    if (argi >= argc || runs < 1 || badMode)
+    {
+        printf("Usage: loadbench [-n runs] <svg file>...\n");
+        printf("       loadbench -rss copy|owner <svg file>...\n");
+        return 1;
+    }
+
+    gFontHandler.loadDefaultFonts();
+
+    if (rssMode != nullptr)
+    {
+        measurePeak(argc, argv, argi, strcmp(rssMode, "owner") == 0);
+        return 0;
+    }
+
+    for (; argi < argc; argi++)
+    {
+        const char* filename = argv[argi];
+
+        auto mapped = MappedFile::create_shared(filename);
+        if (mapped == nullptr)
+        {
+            printf("File not found: %s\n", filename);
+            continue;
+        }
+
+        ByteSpan src(mapped->data(), mapped->size());
+
+        LoadStats heap = measure(src, false, runs);
+        LoadStats arena = measure(src, true, runs);
+
+        printf("%s\n", filename);
+        printf("  %-6s %9s %9s %10s %12s %10s %12s\n", "", "load ms", "free ms", "heap news", "heap bytes", "arena", "arena bytes");
+        printf("  %-6s %9.2f %9.2f %10zu %12zu %10s %12s\n", "heap", heap.fLoadMs, heap.fFreeMs, heap.fHeapCount, heap.fHeapBytes, "-", "-");
+        printf("  %-6s %9.2f %9.2f %10zu %12zu %10zu %12zu\n", "arena", arena.fLoadMs, arena.fFreeMs, arena.fHeapCount, arena.fHeapBytes, arena.fArenaCount, arena.fArenaBytes);
+    }
+
+    return 0;
+}
@@ -0,0 +1,273 @@
+//
+// numbench
+// How fast, and how exactly, the numbers in a set of files are parsed.
+//
+// The numbers are pulled out of all the files first, everything that
+// looks like an SVG number, other than the digits on the end of a name
+// or a hex color.  Then the whole set is parsed, a number of times, with
+// each of:
+//
+//  - chunk_parse_double(), what the library uses
+//  - the parser it replaced, kept here for comparison
+//  - strtod()
+//
+// The best time of the runs is reported, in nanoseconds per number,
+// along with how many of the results differ from strtod(), bit for bit.
+// Nothing here needs blend2d.
+//
+// Usage: numbench [-n runs] <svg file>...
+//   numbench -n 10 ..\..\gallery\*.svg
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "app/mappedfile.h"
+#include "svg/bspan.h"
+
+using namespace waavs;
+
+
+// The parser chunk_parse_double() replaced.  It builds the
+// number from its integer and fraction parts, with powd() for
+// the fraction and the exponent, so it is not correctly rounded.
+static double legacyParseDouble(const ByteSpan& inChunk) noexcept
+{
+    ByteSpan s = inChunk;
+
+    double sign = 1.0;
+    double res = 0.0;
+    bool hasIntPart = false;
+    bool hasFracPart = false;
+
+    if (*s == '+') {
+        s++;
+    }
+    else if (*s == '-') {
+        sign = -1;
+        s++;
+    }
+
+    if (chrDecDigits[*s]) {
+        res = (double)chunk_to_u64(s);
+        hasIntPart = true;
+    }
+
+    if (*s == '.') {
+        s++;
+        auto sentinel = s.fStart;
+
+        if (chrDecDigits(*s)) {
+            uint64_t fracPart = chunk_to_u64(s);
+            ptrdiff_t diff = s.fStart - sentinel;
+            res = res + ((double)fracPart) / (double)powd((double)10, double(diff));
+            hasFracPart = true;
+        }
+    }
+
+    if (!hasIntPart && !hasFracPart)
+        return 0.0;
+
+    if (*s == 'e' || *s == 'E') {
+        s++;
+
+        double expSign = 1.0;
+        if (*s == '+') {
+            s++;
+        }
+        else if (*s == '-') {
+            expSign = -1.0;
+            s++;
+        }
+
+        if (chrDecDigits[*s]) {
+            long long expPart = chunk_to_u64(s);
+            res = res * powd(10, double(expSign * double(expPart)));
+        }
+    }
+
+    return res * sign;
+}
+
+
+static bool isDigit(unsigned char c) { return (unsigned char)(c - '0') < 10; }
+static bool isNameChar(unsigned char c) { return isDigit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == '#'; }
+
+// Pull out everything in 's' that has the form of a number:
+// [sign] digits [. digits] [e [sign] digits]
+static void collectNumbers(const ByteSpan& s, std::vector<ByteSpan>& nums)
+{
+    const unsigned char* p = s.fStart;
+    const unsigned char* end = s.fEnd;
+
+    while (p < end)
+    {
+        const unsigned char* start = p;
+        const unsigned char* q = p;
+
+        if (*q == '+' || *q == '-')
+            q++;
+
+        const unsigned char* digitsStart = q;
+        while (q < end && isDigit(*q))
+            q++;
+        size_t intDigits = q - digitsStart;
+
+        size_t fracDigits = 0;
+        if (q < end && *q == '.')
+        {
+            const unsigned char* f = q + 1;
+            while (f < end && isDigit(*f))
+                f++;
+            fracDigits = f - (q + 1);
+            if (intDigits > 0 || fracDigits > 0)
+                q = f;
+        }
+
+        if (intDigits == 0 && fracDigits == 0)
+        {
+            p++;
+            continue;
+        }
+
+        // The exponent only counts when digits follow
+        if (q < end && (*q == 'e' || *q == 'E'))
+        {
+            const unsigned char* e = q + 1;
+            if (e < end && (*e == '+' || *e == '-'))
+                e++;
+            if (e < end && isDigit(*e))
+            {
+                while (e < end && isDigit(*e))
+                    e++;
+                q = e;
+            }
+        }
+
+        // Skip the digits that are part of a name, or a color
+        bool partOfName = (start > s.fStart) && isNameChar(start[-1]) && !(*start == '+' || *start == '-');
+        if (!partOfName)
+            nums.push_back(ByteSpan(start, q));
+
+        p = q;
+    }
+}
+
+static double bestOf(int runs, const std::vector<ByteSpan>& nums, double (*parse)(const ByteSpan&), std::vector<double>& out)
+{
+    double best = 1e30;
+
+    for (int i = 0; i < runs; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t n = 0; n < nums.size(); n++)
+            out[n] = parse(nums[n]);
+        auto stop = std::chrono::steady_clock::now();
+
+        best = std::min(best, std::chrono::duration<double, std::nano>(stop - start).count());
+    }
+
+    return best / (double)nums.size();
+}
+
+static double parseCurrent(const ByteSpan& num)
+{
+    ByteSpan s = num;
+    double value = 0;
+    chunk_parse_double(s, value);
+
+    return value;
+}
+
+// strtod needs the number on its own, null terminated.  The copies
+// are made before timing, so only the parse is timed.
+static std::vector<std::string> gTerminated{};
+static const std::string* gTerminatedBase = nullptr;
+static const ByteSpan* gNumsBase = nullptr;
+
+static double parseStrtod(const ByteSpan& num)
+{
+    return strtod(gTerminatedBase[&num - gNumsBase].c_str(), nullptr);
+}
+
+static size_t countDifferences(const std::vector<double>& a, const std::vector<double>& b)
+{
+    size_t diffs = 0;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        if (memcmp(&a[i], &b[i], sizeof(double)) != 0)
+            diffs++;
+    }
+
+    return diffs;
+}
+
+int main(int argc, char** argv)
+{
+    int runs = 10;
+    int argi = 1;
+
+    if (argc > 2 && strcmp(argv[1], "-n") == 0)
+    {
+        runs = atoi(argv[2]);
+        argi = 3;
+    }
+
+    if (argi >= argc || runs < 1)
+    {
+        printf("Usage: numbench [-n runs] <svg file>...\n");
+        return 1;
+    }
+
+    std::vector<std::shared_ptr<MappedFile>> files{};
+    std::vector<ByteSpan> nums{};
+    size_t totalBytes = 0;
+
+    for (; argi < argc; argi++)
+    {
+        auto mapped = MappedFile::create_shared(argv[argi]);
+        if (nullptr == mapped)
+        {
+            printf("could not open: %s\n", argv[argi]);
+            continue;
+        }
+
+        ByteSpan s(mapped->data(), mapped->size());
+        collectNumbers(s, nums);
+        totalBytes += s.size();
+
+        files.push_back(mapped);
+    }
+
+    if (nums.empty())
+    {
+        printf("no numbers found\n");
+        return 1;
+    }
+
+    gTerminated.reserve(nums.size());
+    for (const auto& n : nums)
+        gTerminated.emplace_back((const char*)n.fStart, n.size());
+    gTerminatedBase = gTerminated.data();
+    gNumsBase = nums.data();
+
+    std::vector<double> current(nums.size());
+    std::vector<double> legacy(nums.size());
+    std::vector<double> reference(nums.size());
+
+    double currentNs = bestOf(runs, nums, parseCurrent, current);
+    double legacyNs = bestOf(runs, nums, legacyParseDouble, legacy);
+    double strtodNs = bestOf(runs, nums, parseStrtod, reference);
+
+    printf("%zu numbers, from %zu files, %zu bytes\n", nums.size(), files.size(), totalBytes);
+    printf("  %-20s %8s %12s\n", "", "ns/num", "!= strtod");
+    printf("  %-20s %8.2f %12zu\n", "chunk_parse_double", currentNs, countDifferences(current, reference));
+    printf("  %-20s %8.2f %12zu\n", "legacy", legacyNs, countDifferences(legacy, reference));
+    printf("  %-20s %8.2f %12s\n", "strtod", strtodNs, "-");
+
+    return 0;
+}
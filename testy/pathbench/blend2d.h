@@ -0,0 +1,148 @@
+#pragma once
+
+//
+// A stand-in for blend2d, for pathbench
+//
+// Only as much of BLPath and BLPoint as the path parser uses.  Like
+// blend2d, the path keeps its commands and vertices in two arrays that
+// grow as needed, so the time to build a path is much the same, without
+// needing the library.  svgpath.h includes "blend2d.h", and finds this
+// one first, because it is next to pathbench.cpp.
+//
+// Each call also counts the segments it adds, and the path can be
+// hashed, so the output of two versions of the parser can be compared.
+//
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+typedef uint32_t BLResult;
+enum { BL_SUCCESS = 0, BL_ERROR_NO_MATCHING_VERTEX = 1 };
+
+struct BLPoint
+{
+    double x{ 0 };
+    double y{ 0 };
+
+    BLPoint() noexcept = default;
+    BLPoint(double ax, double ay) noexcept : x(ax), y(ay) {}
+
+    BLPoint& operator+=(const BLPoint& other) noexcept { x += other.x; y += other.y; return *this; }
+    BLPoint& operator-=(const BLPoint& other) noexcept { x -= other.x; y -= other.y; return *this; }
+};
+
+static inline BLPoint operator+(const BLPoint& a, const BLPoint& b) noexcept { return BLPoint(a.x + b.x, a.y + b.y); }
+static inline BLPoint operator-(const BLPoint& a, const BLPoint& b) noexcept { return BLPoint(a.x - b.x, a.y - b.y); }
+static inline BLPoint operator*(const BLPoint& a, double s) noexcept { return BLPoint(a.x * s, a.y * s); }
+
+struct BLPath
+{
+    // The same letters the SVG path data uses, one per vertex
+    std::vector<uint8_t> fCommands{};
+    std::vector<BLPoint> fVertices{};
+    BLPoint fFigureStart{};
+    size_t fSegments{ 0 };
+
+    size_t size() const noexcept { return fCommands.size(); }
+
+    BLResult reserve(size_t n)
+    {
+        fCommands.reserve(n);
+        fVertices.reserve(n);
+        return BL_SUCCESS;
+    }
+
+    BLResult getLastVertex(BLPoint* pt) const noexcept
+    {
+        if (fCommands.empty())
+            return BL_ERROR_NO_MATCHING_VERTEX;
+
+        *pt = (fCommands.back() == 'Z') ? fFigureStart : fVertices.back();
+        return BL_SUCCESS;
+    }
+
+    BLResult moveTo(double x, double y) { add('M', x, y); fFigureStart = BLPoint(x, y); fSegments++; return BL_SUCCESS; }
+    BLResult moveTo(const BLPoint& p) { return moveTo(p.x, p.y); }
+
+    BLResult lineTo(double x, double y) { add('L', x, y); fSegments++; return BL_SUCCESS; }
+    BLResult lineTo(const BLPoint& p) { return lineTo(p.x, p.y); }
+
+    BLResult cubicTo(double x1, double y1, double x2, double y2, double x3, double y3)
+    {
+        add('C', x1, y1);
+        add('C', x2, y2);
+        add('C', x3, y3);
+        fSegments++;
+        return BL_SUCCESS;
+    }
+    BLResult cubicTo(const BLPoint& p1, const BLPoint& p2, const BLPoint& p3) { return cubicTo(p1.x, p1.y, p2.x, p2.y, p3.x, p3.y); }
+
+    // blend2d works out the reflected control point, which takes
+    // about as long as storing it
+    BLResult smoothCubicTo(double x2, double y2, double x3, double y3)
+    {
+        add('S', 0, 0);
+        add('S', x2, y2);
+        add('S', x3, y3);
+        fSegments++;
+        return BL_SUCCESS;
+    }
+    BLResult smoothCubicTo(const BLPoint& p2, const BLPoint& p3) { return smoothCubicTo(p2.x, p2.y, p3.x, p3.y); }
+
+    BLResult quadTo(double x1, double y1, double x2, double y2)
+    {
+        add('Q', x1, y1);
+        add('Q', x2, y2);
+        fSegments++;
+        return BL_SUCCESS;
+    }
+    BLResult quadTo(const BLPoint& p1, const BLPoint& p2) { return quadTo(p1.x, p1.y, p2.x, p2.y); }
+
+    BLResult smoothQuadTo(double x2, double y2)
+    {
+        add('T', 0, 0);
+        add('T', x2, y2);
+        fSegments++;
+        return BL_SUCCESS;
+    }
+    BLResult smoothQuadTo(const BLPoint& p2) { return smoothQuadTo(p2.x, p2.y); }
+
+    // An arc becomes up to four cubics in blend2d.  Six vertices
+    // keep the arguments, and stand in for the work.
+    BLResult ellipticArcTo(const BLPoint& rp, double xAxisRotation, bool largeArcFlag, bool sweepFlag, const BLPoint& p1)
+    {
+        add('A', rp.x, rp.y);
+        add('A', xAxisRotation, (largeArcFlag ? 2 : 0) + (sweepFlag ? 1 : 0));
+        add('A', 0, 0);
+        add('A', 0, 0);
+        add('A', 0, 0);
+        add('A', p1.x, p1.y);
+        fSegments++;
+        return BL_SUCCESS;
+    }
+
+    BLResult close() { add('Z', 0, 0); fSegments++; return BL_SUCCESS; }
+
+    // FNV-1a over the commands and the vertices
+    uint64_t hash(uint64_t h = 0xcbf29ce484222325ull) const noexcept
+    {
+        auto mix = [&h](const void* data, size_t sz) {
+            const uint8_t* p = (const uint8_t*)data;
+            for (size_t i = 0; i < sz; i++)
+                h = (h ^ p[i]) * 0x100000001b3ull;
+        };
+
+        mix(fCommands.data(), fCommands.size());
+        mix(fVertices.data(), fVertices.size() * sizeof(BLPoint));
+
+        return h;
+    }
+
+private:
+    void add(uint8_t cmd, double x, double y)
+    {
+        fCommands.push_back(cmd);
+        fVertices.push_back(BLPoint(x, y));
+    }
+};
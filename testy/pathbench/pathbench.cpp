@@ -0,0 +1,135 @@
+//
+// pathbench
+// How fast the path data in a set of files is parsed.
+//
+// The 'd' attribute of every element in the files is collected first.
+// Then all of them are parsed into paths, a number of times, and the
+// best time is reported, in segments per second, and MB/s of path data.
+//
+// blend2d isn't needed.  The BLPath here is the stand-in in blend2d.h,
+// next to this file, which keeps its commands and vertices in growing
+// arrays, the way blend2d does.  So the numbers are for the parser,
+// and building the path, and not for what blend2d does after that.
+//
+// The hash printed at the end covers every command and vertex of
+// every path.  Build this against two versions of svgpath.h, and if
+// the hashes match, they parsed everything the same.
+//   git show 737ac27^:svg/svgpath.h > svgpath.h      (before the single switch)
+//   cl ... pathbench.cpp                              (picks up svgpath.h from here)
+//
+// Usage: pathbench [-n runs] <svg file>...
+//   pathbench -n 21 ..\..\gallery\*.svg ..\resources\Cherub_with_Chariot_Faberge_egg.svg ..\resources\cosh.svg
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "blend2d.h"
+#include "app/mappedfile.h"
+#include "svg/xmlscan.h"
+#include "svgpath.h"
+
+using namespace waavs;
+
+
+// Gather the 'd' attribute of every element in 's'
+static void collectPathData(const ByteSpan& s, std::vector<ByteSpan>& paths)
+{
+    XmlElementIterator iter(s);
+    while (iter.next())
+    {
+        const XmlElement& elem = *iter;
+        if (!elem.isStart() && !elem.isSelfClosing())
+            continue;
+
+        ByteSpan src = elem.data();
+        ByteSpan key{};
+        ByteSpan value{};
+        while (nextAttributeKeyValue(src, key, value))
+        {
+            if (key == "d" && value.size() > 0)
+                paths.push_back(value);
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int runs = 21;
+    int argi = 1;
+
+    if (argc > 2 && strcmp(argv[1], "-n") == 0)
+    {
+        runs = atoi(argv[2]);
+        argi = 3;
+    }
+
+    if (argi >= argc || runs < 1)
+    {
+        printf("Usage: pathbench [-n runs] <svg file>...\n");
+        return 1;
+    }
+
+    std::vector<std::shared_ptr<MappedFile>> files{};
+    std::vector<ByteSpan> paths{};
+
+    for (; argi < argc; argi++)
+    {
+        auto mapped = MappedFile::create_shared(argv[argi]);
+        if (nullptr == mapped)
+        {
+            printf("could not open: %s\n", argv[argi]);
+            continue;
+        }
+
+        collectPathData(ByteSpan(mapped->data(), mapped->size()), paths);
+        files.push_back(mapped);
+    }
+
+    if (paths.empty())
+    {
+        printf("no path data found\n");
+        return 1;
+    }
+
+    // One pass to count, check, and hash
+    size_t bytes = 0;
+    size_t segments = 0;
+    size_t failed = 0;
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    for (const auto& d : paths)
+    {
+        BLPath path;
+        if (!blpathparser::parsePath(d, path))
+            failed++;
+
+        bytes += d.size();
+        segments += path.fSegments;
+        hash = path.hash(hash);
+    }
+
+    double best = 1e30;
+    for (int i = 0; i < runs; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& d : paths)
+        {
+            BLPath path;
+            blpathparser::parsePath(d, path);
+        }
+        auto stop = std::chrono::steady_clock::now();
+
+        best = std::min(best, std::chrono::duration<double>(stop - start).count());
+    }
+
+    printf("%zu paths, from %zu files: %zu bytes, %zu segments, %zu failed\n", paths.size(), files.size(), bytes, segments, failed);
+    printf("best of %d: %.2f ms, %.2f M segments/s, %.0f MB/s\n", runs, best * 1e3, segments / best / 1e6, bytes / best / 1e6);
+    printf("hash: %016llx\n", (unsigned long long)hash);
+
+    return 0;
+}
@@ -0,0 +1,107 @@
+//
+// scanbench
+// How fast the XML scanner gets through a set of files.
+//
+// Each file is mapped, then scanned a number of times, iterating
+// over the elements, and the key/value pairs of their attributes.
+// The best time of the runs is reported, in MB/s, for each file,
+// and for all of them together.
+//
+// Usage: scanbench [-n runs] <xml file>...
+//   scanbench -n 20 ../../gallery/*.svg
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "app/mappedfile.h"
+#include "svg/xmlscan.h"
+
+using namespace waavs;
+
+
+// Scan the whole span once, returning the number of
+// attributes seen, so the work can't be optimized away
+static size_t scanOnce(const ByteSpan& s)
+{
+    size_t count = 0;
+
+    XmlElementIterator iter(s);
+    while (iter.next())
+    {
+        const XmlElement& elem = *iter;
+        count++;
+
+        if (!elem.isStart() && !elem.isSelfClosing())
+            continue;
+
+        ByteSpan src = elem.data();
+        ByteSpan key{};
+        ByteSpan value{};
+        while (nextAttributeKeyValue(src, key, value))
+            count++;
+    }
+
+    return count;
+}
+
+int main(int argc, char** argv)
+{
+    int runs = 10;
+    int argi = 1;
+
+    if (argc > 2 && strcmp(argv[1], "-n") == 0)
+    {
+        runs = atoi(argv[2]);
+        argi = 3;
+    }
+
+    if (argi >= argc || runs < 1)
+    {
+        printf("Usage: scanbench [-n runs] <xml file>...\n");
+        return 1;
+    }
+
+    size_t totalBytes = 0;
+    double totalSeconds = 0;
+    size_t check = 0;
+
+    for (; argi < argc; argi++)
+    {
+        auto mapped = MappedFile::create_shared(argv[argi]);
+        if (nullptr == mapped)
+        {
+            printf("could not open: %s\n", argv[argi]);
+            continue;
+        }
+
+        ByteSpan s(mapped->data(), mapped->size());
+
+        double best = 1e9;
+        for (int i = 0; i < runs; i++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            check += scanOnce(s);
+            auto stop = std::chrono::steady_clock::now();
+
+            double secs = std::chrono::duration<double>(stop - start).count();
+            if (secs < best)
+                best = secs;
+        }
+
+        totalBytes += s.size();
+        totalSeconds += best;
+
+        printf("%10zu bytes  %8.1f MB/s  %s\n", s.size(), (s.size() / 1e6) / best, argv[argi]);
+
+        mapped->close();
+    }
+
+    if (totalSeconds > 0)
+        printf("%10zu bytes  %8.1f MB/s  total  (%zu)\n", totalBytes, (totalBytes / 1e6) / totalSeconds, check);
+
+    return 0;
+}
@@ -0,0 +1,244 @@
+//
+// svgcompile
+// Check that a compiled document loads back as what was recorded.
+//
+// Each file is parsed, recorded into an SVGDisplayList, and written
+// in the compiled form.  The bytes are then loaded into a second
+// SVGDisplayList, and the two are compared, section by section:
+// the commands, numbers, matrices, paths, styles, images, fonts,
+// texts, and the frame.  Nothing is drawn.
+//
+// Then every shorter piece of the bytes is loaded, and each of
+// those has to be turned away, rather than loaded, or crash.
+//
+// With -o, the compiled bytes are also written next to the file,
+// as <file>.svgc
+//
+// Usage: svgcompile [-o] <svg file>...
+//   svgcompile ..\..\gallery\*.svg
+//
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "svg.h"
+#include "svgcompiled.h"
+#include "mappedfile.h"
+
+using namespace waavs;
+
+// Create one of these first, so factory constructor will run
+SVGFactory gSVG;
+
+FontHandler gFontHandler{};
+
+
+static bool sameFont(const BLFont& a, const BLFont& b)
+{
+    if (a.face().familyName().equals(b.face().familyName()) == false)
+        return false;
+
+    return a.size() == b.size();
+}
+
+// Compare the recorded list 'a' with the loaded list 'b'
+// Print the first difference in each section, and return the
+// number of sections that differ.
+static int compareLists(const SVGDisplayList& a, const SVGDisplayList& b)
+{
+    int diffs = 0;
+
+    auto report = [&diffs](const char* section, size_t idx) {
+        printf("  %s differ at %zu\n", section, idx);
+        diffs++;
+    };
+
+    // field by field, the padding in a command is whatever it was
+    if (a.fCommands.size() != b.fCommands.size())
+        report("commands", a.fCommands.size());
+    else {
+        for (size_t i = 0; i < a.fCommands.size(); i++)
+        {
+            const DisplayListCommand& ca = a.fCommands[i];
+            const DisplayListCommand& cb = b.fCommands[i];
+            if (ca.fOp != cb.fOp || ca.fImm != cb.fImm || ca.fA != cb.fA || ca.fB != cb.fB) {
+                report("commands", i);
+                break;
+            }
+        }
+    }
+
+    if (a.fNumbers.size() != b.fNumbers.size())
+        report("numbers", a.fNumbers.size());
+    else if (!a.fNumbers.empty() && memcmp(a.fNumbers.data(), b.fNumbers.data(), a.fNumbers.size() * sizeof(double)) != 0)
+        report("numbers", 0);
+
+    if (a.fMatrices.size() != b.fMatrices.size())
+        report("matrices", a.fMatrices.size());
+    else {
+        for (size_t i = 0; i < a.fMatrices.size(); i++)
+        {
+            if (memcmp(a.fMatrices[i].m, b.fMatrices[i].m, 6 * sizeof(double)) != 0) {
+                report("matrices", i);
+                break;
+            }
+        }
+    }
+
+    if (a.fPaths.size() != b.fPaths.size())
+        report("paths", a.fPaths.size());
+    else {
+        for (size_t i = 0; i < a.fPaths.size(); i++)
+        {
+            if (!a.fPaths[i].equals(b.fPaths[i])) {
+                report("paths", i);
+                break;
+            }
+        }
+    }
+
+    if (a.fStyles.size() != b.fStyles.size())
+        report("styles", a.fStyles.size());
+    else {
+        for (size_t i = 0; i < a.fStyles.size(); i++)
+        {
+            if (!a.fStyles[i].equals(b.fStyles[i])) {
+                report("styles", i);
+                break;
+            }
+        }
+    }
+
+    if (a.fImages.size() != b.fImages.size())
+        report("images", a.fImages.size());
+    else {
+        for (size_t i = 0; i < a.fImages.size(); i++)
+        {
+            if (!a.fImages[i].equals(b.fImages[i])) {
+                report("images", i);
+                break;
+            }
+        }
+    }
+
+    // A font only comes back if the FontHandler can find its family
+    if (a.fFonts.size() != b.fFonts.size())
+        report("fonts", a.fFonts.size());
+    else {
+        for (size_t i = 0; i < a.fFonts.size(); i++)
+        {
+            if (!b.fFonts[i].face().isValid())
+                continue;
+
+            if (!sameFont(a.fFonts[i], b.fFonts[i])) {
+                report("fonts", i);
+                break;
+            }
+        }
+    }
+
+    if (a.fTexts != b.fTexts)
+        report("texts", 0);
+
+    if (memcmp(&a.fFrame, &b.fFrame, sizeof(BLRect)) != 0)
+        report("frame", 0);
+
+    return diffs;
+}
+
+// Load every shorter piece of the bytes, past the magic and version,
+// none of which should load.  Long files are sampled, rather than
+// trying every length.
+static size_t countTruncatedLoads(const std::vector<uint8_t>& bytes)
+{
+    size_t loaded = 0;
+    size_t step = bytes.size() / 4096 + 1;
+
+    for (size_t len = 8; len < bytes.size(); len += step)
+    {
+        SVGDisplayList dl;
+        if (SVGCompiledDocument::load(ByteSpan(bytes.data(), len), &gFontHandler, dl))
+        {
+            printf("  loaded when cut to %zu of %zu bytes\n", len, bytes.size());
+            loaded++;
+        }
+    }
+
+    return loaded;
+}
+
+int main(int argc, char** argv)
+{
+    bool writeOut = false;
+    int argi = 1;
+
+    if (argi < argc && strcmp(argv[argi], "-o") == 0)
+    {
+        writeOut = true;
+        argi++;
+    }
+
+    if (argi >= argc)
+    {
+        printf("Usage: svgcompile [-o] <svg file>...\n");
+        return 1;
+    }
+
+    gFontHandler.loadDefaultFonts();
+
+    int failed = 0;
+
+    for (; argi < argc; argi++)
+    {
+        const char* filename = argv[argi];
+
+        auto mapped = MappedFile::create_shared(filename);
+        if (mapped == nullptr)
+        {
+            printf("File not found: %s\n", filename);
+            failed++;
+            continue;
+        }
+
+        ByteSpan mappedSpan(mapped->data(), mapped->size());
+        auto doc = SVGDocument::createFromChunk(mappedSpan, &gFontHandler, 1920, 1080, 96);
+        if (doc == nullptr)
+        {
+            printf("Could not parse: %s\n", filename);
+            failed++;
+            continue;
+        }
+
+        SVGDisplayList recorded;
+        SVGDisplayListRecorder::record(&gFontHandler, doc.get(), recorded);
+
+        std::vector<uint8_t> bytes;
+        SVGDisplayList loaded;
+        if (!SVGCompiledDocument::write(recorded, bytes) || !SVGCompiledDocument::load(ByteSpan(bytes.data(), bytes.size()), &gFontHandler, loaded))
+        {
+            printf("%s: FAILED to write, or load\n", filename);
+            failed++;
+            continue;
+        }
+
+        printf("%s: %zu commands, %zu bytes\n", filename, recorded.fCommands.size(), bytes.size());
+
+        int diffs = compareLists(recorded, loaded);
+        size_t truncated = countTruncatedLoads(bytes);
+
+        printf("  %s\n", (diffs == 0 && truncated == 0) ? "OK" : "FAILED");
+
+        if (diffs != 0 || truncated != 0)
+            failed++;
+
+        if (writeOut)
+        {
+            std::string outName = std::string(filename) + ".svgc";
+            SVGCompiledDocument::writeFile(outName.c_str(), bytes);
+        }
+    }
+
+    return failed == 0 ? 0 : 1;
+}
@@ -69,12 +69,18 @@ int main(int argc, char **argv)
 	}
     
 	ByteSpan mappedSpan(mapped->data(), mapped->size());
-    gDoc = SVGDocument::createFromChunk(mappedSpan, &gFontHandler);
+    // The document loads straight from the mapped file, and keeps it
+    gDoc = SVGDocument::createFromChunk(mappedSpan, mapped, &gFontHandler, 1920, 1080, 96);
 
 
     if (gDoc == nullptr)
         return 1;
 
+	// Paths shared between nodes with the same path data
+	auto& paths = gDoc->fPathCache;
+	printf("paths: %zu, shared: %zu (%3.1f%%), bytes not parsed: %zu\n",
+		paths.fLookups, paths.fHits, paths.hitRate() * 100.0, paths.fBytesSkipped);
+
 	auto rootNode = gDoc->documentElement();
     
     if (rootNode == nullptr)
@@ -112,6 +118,21 @@ int main(int argc, char **argv)
 	// Render the document into the context
 	gDoc->draw(&ctx);
 
+	// How much the state tracking saved
+	auto& stats = ctx.stateStats();
+	printf("pushes: %zu, saves: %zu, state changes: %zu, skipped: %zu\n", 
+		stats.fPushes, stats.fSaves, stats.fStateChanges, stats.fStateChangesSkipped);
+
+	// Groups drawn with opacity
+	auto& layers = SVGLayerCache::global();
+	printf("layers rendered: %zu, reused: %zu, over budget: %zu, bytes: %zu\n",
+		layers.fRenders, layers.fHits, layers.fOverBudget, layers.bytesUsed());
+
+	// Offscreen surfaces
+	auto& surfaces = SurfacePool::global();
+	printf("surfaces acquired: %zu, reused: %zu, peak bytes: %zu\n",
+		surfaces.fAcquires, surfaces.fReuses, surfaces.peakBytes());
+
 			
 	// Save the image from the drawing context out to a file
 	const char* outfilename = nullptr;
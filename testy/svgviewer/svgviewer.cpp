@@ -7,6 +7,8 @@
 
 #include "mappedfile.h"
 #include "svguiapp.h"
+#include "svgtiledrenderer.h"
+#include "svgtilecache.h"
 
 
 using namespace waavs;
@@ -24,6 +26,26 @@ static bool gIsDragging = false;
 static vec2f gDragPos{ 0,0 };
 static double gZoomFactor = 0.1;
 
+// Press 'T' to switch between drawing with blend2d's own
+// worker threads, and drawing with the tiled renderer
+static bool gUseTiledRenderer = false;
+static std::unique_ptr<TiledRenderer> gTiledRenderer{};
+
+// Press 'C' to switch the tile cache on and off
+// When it's on, panning and zooming draw from cached tiles
+static bool gUseTileCache = true;
+static std::unique_ptr<TileCache> gTileCache{};
+
+// Tiles only come in power of two scales, so they are a little
+// soft in between.  Once the view has stayed put for a moment, it
+// is drawn once more, directly, at its exact scale.
+static const double kViewSettleSeconds = 0.25;
+static double gViewChangedAt = 0;
+static bool gExactFrameDrawn = true;
+
+// Press 'P' to print how long each frame takes to draw
+static bool gPrintTimings = false;
+
 
 
 
@@ -44,8 +66,10 @@ static std::shared_ptr<SVGDocument> docFromFilename(const char* filename)
 	}
 
 	
+	// The document keeps the mapping alive, and parses
+	// straight out of it, rather than making a copy
 	ByteSpan aspan(mapped->data(), mapped->size());
-	std::shared_ptr<SVGDocument> aDoc = SVGDocument::createFromChunk(aspan, &gFontHandler, canvasWidth, canvasHeight, systemPpi);
+	std::shared_ptr<SVGDocument> aDoc = SVGDocument::createFromChunk(aspan, mapped, &gFontHandler, canvasWidth, canvasHeight, systemPpi);
 
 	
 	return aDoc;
@@ -61,6 +85,20 @@ static void drawDocument(std::shared_ptr<SVGDocument> doc)
 	if (rootNode == nullptr)
 		return ;
 	
+	if (gUseTiledRenderer)
+	{
+		if (nullptr == gTiledRenderer)
+			gTiledRenderer = std::make_unique<TiledRenderer>(&gFontHandler);
+
+		double startTime = seconds();
+		gTiledRenderer->render(doc, appFrameBuffer().image(), gViewPort.sceneToSurfaceTransform());
+		double endTime = seconds();
+		if (gPrintTimings)
+			printf("Tiled Drawing Duration (%d threads): %f\n", (int)gTiledRenderer->threadCount(), endTime - startTime);
+
+		return;
+	}
+
 	// Create a SvgDrawingContext for the canvas
 	SvgDrawingContext ctx(&gFontHandler);
 	BLContextCreateInfo ctxInfo{};
@@ -70,14 +108,28 @@ static void drawDocument(std::shared_ptr<SVGDocument> doc)
 	// setup any transform
 	ctx.setTransform(gViewPort.sceneToSurfaceTransform());
 
-	//double startTime = seconds();
+	double startTime = seconds();
 
 	// draw the document into the ctx
 	doc->draw(&ctx);
 	ctx.flush();
 	
-	//double endTime = seconds();
-	//printf("Drawing Duration: %f\n", endTime - startTime);
+	double endTime = seconds();
+	if (gPrintTimings)
+		printf("Drawing Duration (%d threads): %f\n", (int)ctxInfo.threadCount, endTime - startTime);
+}
+
+// Draw the document out of the tile cache
+// Tiles that aren't ready yet show up later
+static void drawFromTileCache()
+{
+	if (nullptr == gDoc)
+		return;
+
+	SvgDrawingContext ctx(&gFontHandler);
+	ctx.begin(appFrameBuffer().image());
+	gTileCache->draw(&ctx, gViewPort.sceneToSurfaceTransform(), canvasWidth, canvasHeight);
+	ctx.flush();
 }
 
 static void refreshDoc()
@@ -85,7 +137,14 @@ static void refreshDoc()
 	// Clear the background to white
 	appFrameBuffer().setAllPixels(vec4b{ 0xff,0xff,0xff,0xff });
 	
-	drawDocument(gDoc);
+	if (gUseTileCache)
+	{
+		drawFromTileCache();
+		gViewChangedAt = seconds();
+		gExactFrameDrawn = false;
+	}
+	else
+		drawDocument(gDoc);
 }
 
 static void resetView()
@@ -105,6 +164,7 @@ static void onFileDrop(const FileDropEvent& fde)
 		// And create a window to display each document
 		double startTime = seconds();
 		gDoc = docFromFilename(fde.filenames[i].c_str());
+		gTileCache->document(gDoc);
 
 
 		double endTime = seconds();
@@ -135,6 +195,23 @@ static void onFrameEvent(const FrameCountEvent& fe)
 	//printf("frameEvent: %d\n", (int)fe.frameCount);
 	//appFrameBuffer().setAllPixels(vec4b{ 0x00,0xff,0x00,0xff });
 	
+	// Show tiles that have finished rendering in the background,
+	// until the view settles, then draw it at its exact scale
+	if (gUseTileCache && !gExactFrameDrawn)
+	{
+		if (seconds() - gViewChangedAt >= kViewSettleSeconds)
+		{
+			appFrameBuffer().setAllPixels(vec4b{ 0xff,0xff,0xff,0xff });
+			drawDocument(gDoc);
+			gExactFrameDrawn = true;
+		}
+		else if (gTileCache->hasNewTiles())
+		{
+			appFrameBuffer().setAllPixels(vec4b{ 0xff,0xff,0xff,0xff });
+			drawFromTileCache();
+		}
+	}
+
 	screenRefresh();
 
 
@@ -266,6 +343,23 @@ static void onKeyboardEvent(const KeyboardEvent& ke)
 				gRecorder.toggleRecording();
 			break;			
 
+			case 'C':
+				gUseTileCache = !gUseTileCache;
+				printf("Tile Cache: %s\n", gUseTileCache ? "ON" : "OFF");
+				refreshDoc();
+			break;
+
+			case 'T':
+				gUseTiledRenderer = !gUseTiledRenderer;
+				printf("Tiled Renderer: %s\n", gUseTiledRenderer ? "ON" : "OFF");
+				refreshDoc();
+			break;
+
+			case 'P':
+				gPrintTimings = !gPrintTimings;
+				printf("Print Timings: %s\n", gPrintTimings ? "ON" : "OFF");
+			break;
+
 		}
 	}
 }
@@ -294,6 +388,9 @@ void onLoad()
 	
 	gRecorder.reset(&appFrameBuffer().image(), "frame", 15, 0);
 	
+	// Keep rendered tiles within a 256MB budget
+	gTileCache = std::make_unique<TileCache>(&gFontHandler, 256 * 1024 * 1024);
+	
 	// register to receive various events
 	subscribe(onFileDrop);
 	subscribe(onFrameEvent);
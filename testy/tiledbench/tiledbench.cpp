@@ -0,0 +1,206 @@
+//
+// tiledbench
+// Compare the two ways of using more than one core to draw a document.
+//
+//  - async: a single IRenderSVG, with blend2d's own worker threads
+//    doing the rasterization.  The traversal of the document stays on
+//    the calling thread.
+//  - tiled: the TiledRenderer, one traversal per tile, with the tiles
+//    spread across a pool of threads.
+//
+// Each file is fitted into an image of the given size, and drawn with
+// 1 to N threads both ways.  The best time of the runs is reported, in
+// milliseconds.  With 1 thread, 'async' is a plain synchronous context.
+//
+// With -native, each file is instead drawn on a single synchronous
+// context twice: once with rects, circles, ellipses, lines, and
+// polygons drawn as paths, and once with blend2d's own calls for
+// those shapes.  Files made of many small icons show the difference.
+//
+// Usage: tiledbench [-n runs] [-t maxthreads] [-s width height] [-native] <svg file>...
+//   tiledbench -n 5 -t 16 ..\..\gallery\*.svg
+//   tiledbench -n 10 -native ..\..\gallery\*.svg
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "svg.h"
+#include "svgtiledrenderer.h"
+#include "mappedfile.h"
+
+using namespace waavs;
+
+// Create one of these first, so factory constructor will run
+SVGFactory gSVG;
+
+FontHandler gFontHandler{};
+
+
+static double nowMillis()
+{
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Fit the document's frame into the image, keeping its aspect ratio
+static BLMatrix2D fitTransform(SVGDocument* doc, int w, int h)
+{
+    BLMatrix2D tm = BLMatrix2D::makeIdentity();
+    BLRect fr = doc->frame();
+    if (fr.w <= 0 || fr.h <= 0)
+        return tm;
+
+    double scale = std::min((double)w / fr.w, (double)h / fr.h);
+    tm.scale(scale, scale);
+    tm.translate(-fr.x, -fr.y);
+
+    return tm;
+}
+
+static double drawAsync(SVGDocument* doc, BLImage& img, const BLMatrix2D& tm, uint32_t threads)
+{
+    double startTime = nowMillis();
+
+    IRenderSVG ctx(&gFontHandler);
+    BLContextCreateInfo ctxInfo{};
+    ctxInfo.threadCount = threads > 1 ? threads : 0;
+    ctx.begin(img, &ctxInfo);
+    ctx.setTransform(tm);
+    doc->draw(&ctx);
+    ctx.end();
+
+    return nowMillis() - startTime;
+}
+
+static double drawSync(SVGDocument* doc, BLImage& img, const BLMatrix2D& tm, bool native)
+{
+    double startTime = nowMillis();
+
+    IRenderSVG ctx(&gFontHandler);
+    ctx.useNativeGeometry(native);
+    ctx.begin(img);
+    ctx.setTransform(tm);
+    doc->draw(&ctx);
+    ctx.end();
+
+    return nowMillis() - startTime;
+}
+
+static double drawTiled(TiledRenderer& tr, std::shared_ptr<SVGDocument> doc, BLImage& img, const BLMatrix2D& tm)
+{
+    double startTime = nowMillis();
+    tr.render(doc, img, tm);
+
+    return nowMillis() - startTime;
+}
+
+int main(int argc, char** argv)
+{
+    int runs = 5;
+    int maxThreads = (int)std::thread::hardware_concurrency();
+    int width = 1920;
+    int height = 1080;
+    bool compareNative = false;
+    int argi = 1;
+
+    while (argi < argc && argv[argi][0] == '-')
+    {
+        if (strcmp(argv[argi], "-n") == 0 && argi + 1 < argc)
+        {
+            runs = atoi(argv[argi + 1]);
+            argi += 2;
+        }
+        else if (strcmp(argv[argi], "-t") == 0 && argi + 1 < argc)
+        {
+            maxThreads = atoi(argv[argi + 1]);
+            argi += 2;
+        }
+        else if (strcmp(argv[argi], "-s") == 0 && argi + 2 < argc)
+        {
+            width = atoi(argv[argi + 1]);
+            height = atoi(argv[argi + 2]);
+            argi += 3;
+        }
+        else if (strcmp(argv[argi], "-native") == 0)
+        {
+            compareNative = true;
+            argi += 1;
+        }
+        else
+            break;
+    }
+
+    if (argi >= argc || runs < 1 || maxThreads < 1 || width < 1 || height < 1)
+    {
+        printf("Usage: tiledbench [-n runs] [-t maxthreads] [-s width height] [-native] <svg file>...\n");
+        return 1;
+    }
+
+    gFontHandler.loadDefaultFonts();
+
+    if (compareNative)
+        printf("%-40s %10s %10s %8s\n", "file", "path ms", "native ms", "speedup");
+    else
+        printf("%-40s %7s %10s %10s %8s\n", "file", "threads", "async ms", "tiled ms", "speedup");
+
+    for (; argi < argc; argi++)
+    {
+        const char* filename = argv[argi];
+
+        auto mapped = MappedFile::create_shared(filename);
+        if (mapped == nullptr)
+        {
+            printf("File not found: %s\n", filename);
+            continue;
+        }
+
+        ByteSpan mappedSpan(mapped->data(), mapped->size());
+        auto doc = SVGDocument::createFromChunk(mappedSpan, &gFontHandler, width, height, 96);
+        if (doc == nullptr)
+            continue;
+
+        BLImage img(width, height, BL_FORMAT_PRGB32);
+        BLMatrix2D tm = fitTransform(doc.get(), width, height);
+
+        // Get the lazy binding out of the way, so the first
+        // timed run isn't paying for it
+        TiledRenderer::prepareDocument(&gFontHandler, doc.get());
+
+        if (compareNative)
+        {
+            double bestPath = 1e30;
+            double bestNative = 1e30;
+            for (int i = 0; i < runs; i++)
+            {
+                bestPath = std::min(bestPath, drawSync(doc.get(), img, tm, false));
+                bestNative = std::min(bestNative, drawSync(doc.get(), img, tm, true));
+            }
+
+            printf("%-40s %10.2f %10.2f %7.2fx\n", filename, bestPath, bestNative, bestPath / bestNative);
+            continue;
+        }
+
+        for (int threads = 1; threads <= maxThreads; threads++)
+        {
+            TiledRenderer tr(&gFontHandler, threads);
+            tr.prepare(doc);
+
+            double bestAsync = 1e30;
+            double bestTiled = 1e30;
+            for (int i = 0; i < runs; i++)
+            {
+                bestAsync = std::min(bestAsync, drawAsync(doc.get(), img, tm, threads));
+                bestTiled = std::min(bestTiled, drawTiled(tr, doc, img, tm));
+            }
+
+            printf("%-40s %7d %10.2f %10.2f %7.2fx\n", filename, threads, bestAsync, bestTiled, bestAsync / bestTiled);
+        }
+    }
+
+    return 0;
+}